@@ -0,0 +1,59 @@
+#include <fmt/format.h>
+
+#include <chrono>
+#include <span>
+
+#include "core/sm83/cpu.hpp"
+#include "core/util.hpp"
+
+using namespace gb;
+
+namespace
+{
+#if defined(GBCXX_CPU_DISPATCH_TABLE)
+constexpr std::string_view kDispatchName = "table";
+#elif defined(GBCXX_CPU_DISPATCH_GOTO)
+constexpr std::string_view kDispatchName = "goto";
+#else
+constexpr std::string_view kDispatchName = "switch";
+#endif
+
+#ifdef GBCXX_DECODE_CACHE
+constexpr std::string_view kDecodeCacheName = " (decode cache)";
+#else
+constexpr std::string_view kDecodeCacheName = "";
+#endif
+
+constexpr uint64_t kCyclesPerFrame = 70224;
+}  // namespace
+
+int main(int argc, char* argv[])
+{
+    spdlog::set_level(spdlog::level::off);
+
+    const auto args{std::span(argv, static_cast<size_t>(argc))};
+    const std::filesystem::path rom_file{args.size() > 1 ? args[1] : BENCH_DEFAULT_ROM};
+    const uint64_t frames = args.size() > 2 ? std::stoull(args[2]) : 3000;
+
+    sm83::Cpu cpu{fs::ReadFile(rom_file)};
+    auto& bus = cpu.GetBus();
+
+    uint64_t instructions{};
+    uint64_t cycles{};
+
+    const auto start = std::chrono::steady_clock::now();
+    while (cycles < frames * kCyclesPerFrame)
+    {
+        instructions += !cpu.IsHalted();
+        const uint8_t tcycles = cpu.Step();
+        bus.Tick(tcycles);
+        cycles += tcycles;
+    }
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    fmt::println("{:>6} dispatch{}: {} instructions in {:.3f}s, {:.2f} MIPS ({:.1f} frames/s)",
+                 kDispatchName, kDecodeCacheName, instructions, elapsed.count(),
+                 static_cast<double>(instructions) / elapsed.count() / 1e6,
+                 static_cast<double>(frames) / elapsed.count());
+    return 0;
+}
@@ -28,6 +28,10 @@ constexpr uint16_t kIoEnd = 0xff7f;
 constexpr uint16_t kHighRamStart = 0xff80;
 constexpr uint16_t kHighRamEnd = 0xfffe;
 
+constexpr uint16_t kTileDataStart = 0x8000;
+constexpr uint16_t kTileDataEnd = 0x97ff;
+constexpr uint16_t kTileMapStart = 0x9800;
+
 constexpr uint16_t kRegJoyp = 0xff00;
 constexpr uint16_t kRegSb = 0xff01;
 constexpr uint16_t kRegSc = 0xff02;
@@ -1,9 +1,35 @@
 #include "core/core.hpp"
 
+#include <atomic>
+
+#include <spdlog/sinks/stdout_color_sinks.h>
+
 namespace gb
 {
-Core::Core(const std::filesystem::path& rom_path, DrawCallback draw_cb)
-    : cpu_(fs::ReadFile(rom_path)),
+namespace
+{
+// Cores running side by side in batch runs would contend on the default logger's sink, so each one
+// logs through its own, single-threaded one. It starts out with the level and pattern of the
+// default logger, which registering it applies, and is dropped right away so that the registry
+// doesn't keep it alive.
+std::shared_ptr<spdlog::logger> MakeInstanceLogger()
+{
+    static std::atomic<uint32_t> next_id{};
+    auto logger = std::make_shared<spdlog::logger>(
+        fmt::format("gbcxx_core_{}", next_id++),
+        std::make_shared<spdlog::sinks::stdout_color_sink_st>());
+    spdlog::initialize_logger(logger);
+    spdlog::drop(logger->name());
+    return logger;
+}
+}  // namespace
+
+Core::Core(const std::filesystem::path& rom_path, DrawCallback draw_cb,
+           sm83::TraceMode trace_mode, std::shared_ptr<spdlog::logger> logger)
+    : logger_(logger != nullptr ? std::move(logger) : MakeInstanceLogger()),
+      construction_logger_(std::in_place, logger_.get()),
+      cpu_(fs::ReadFile(rom_path)),
+      tracer_(sm83::MakeTracer(trace_mode, rom_path)),
       draw_cb_(std::move(draw_cb)),
       rom_path_(rom_path),
       save_path_(fs::kGbcxxDataDir / rom_path.filename().replace_extension(".sav"))
@@ -16,10 +42,21 @@ Core::Core(const std::filesystem::path& rom_path, DrawCallback draw_cb)
         cartridge.LoadRam(save_file);
     }
 #endif
+    construction_logger_.reset();
 }
 
 Core::~Core()
 {
+    const log::ScopedThreadLogger scoped_logger{logger_.get()};
+    LOG_DEBUG("Core: Skipped {} cycles in idle loops", cpu_.GetIdleCyclesSkipped());
+    LOG_DEBUG("Core: Ran {} cycles in fused loops", cpu_.GetFusedCycles());
+    LOG_DEBUG("Core: Ran {} cycles in precompiled code", cpu_.GetPrecompiledCycles());
+    LOG_DEBUG("Core: Ran {} cycles in JIT-compiled code", cpu_.GetJitCycles());
+    if (const auto* profiler = std::get_if<sm83::Profiler>(&tracer_))
+    {
+        profiler->WriteReport("gbcxx_profile.txt");
+        profiler->WriteFoldedStacks("gbcxx_profile.folded");
+    }
 #ifndef __EMSCRIPTEN__
     const auto& cartridge = cpu_.GetBus().cartridge;
     if (cartridge.HasBattery()) { SaveRam(); }
@@ -28,26 +65,38 @@ Core::~Core()
 
 void Core::RunFrame()
 {
-    constexpr int kCyclesPerFrame = 70224;
-    auto& bus = cpu_.GetBus();
-    auto& ppu = bus.ppu;
+    constexpr uint32_t kCyclesPerFrame = 70224;
+    const log::ScopedThreadLogger scoped_logger{logger_.get()};
+    // A DIE() on this thread while the CPU runs dumps the instructions leading up to it.
+    auto* ring_tracer = std::get_if<sm83::RingTracer>(&tracer_);
+    const ScopedDieHandler scoped_die_handler{
+        ring_tracer != nullptr ? &sm83::RingTracer::DumpOnDie : nullptr, ring_tracer};
+    auto& ppu = cpu_.GetBus().ppu;
 
-    int this_frame_cycles{};
+    uint32_t this_frame_cycles{};
     while (this_frame_cycles < kCyclesPerFrame)
     {
         ppu.SetShouldDrawFrame(false);
 
-        const uint8_t tcycles = cpu_.Step();
-        bus.Tick(tcycles);
+        // Dispatched once per Run() call, the untraced instantiation has no tracing code.
+        this_frame_cycles += std::visit(
+            [&](auto& tracer) { return cpu_.Run(kCyclesPerFrame - this_frame_cycles, tracer); },
+            tracer_);
 
         if (ppu.ShouldDrawFrame()) { draw_cb_(ppu.GetLcdBuffer()); }
-
-        this_frame_cycles += tcycles;
     }
 }
 
+void Core::DumpTrace() const
+{
+    const log::ScopedThreadLogger scoped_logger{logger_.get()};
+    if (const auto* tracer = std::get_if<sm83::RingTracer>(&tracer_)) { tracer->Dump(); }
+    else { LOG_WARN("Core: Trace dump requested, but the trace buffer isn't enabled"); }
+}
+
 void Core::SaveRam()
 {
+    const log::ScopedThreadLogger scoped_logger{logger_.get()};
     const auto& cartridge = cpu_.GetBus().cartridge;
     std::filesystem::create_directory(fs::kGbcxxDataDir);
     LOG_DEBUG("Core: Saving RAM to {}", save_path_.string());
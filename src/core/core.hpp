@@ -1,5 +1,8 @@
 #pragma once
 
+#include <memory>
+#include <optional>
+
 #include "core/sm83/cpu.hpp"
 
 namespace gb
@@ -9,17 +12,28 @@ class Core
 public:
     using DrawCallback = std::function<void(const std::array<video::Color, kLcdSize>&)>;
 
-    explicit Core(const std::filesystem::path& rom_path, DrawCallback draw_cb);
+    // Logs go to the given logger while the core runs. Without one, the core creates its own with a
+    // single-threaded sink, set up like spdlog's default logger when the core is constructed.
+    explicit Core(const std::filesystem::path& rom_path, DrawCallback draw_cb,
+                  sm83::TraceMode trace_mode = sm83::TraceMode::None,
+                  std::shared_ptr<spdlog::logger> logger = nullptr);
     ~Core();
 
     memory::Bus& GetBus() { return cpu_.GetBus(); }
 
     void RunFrame();
     void SaveRam();
+    // Writes the instructions recorded by a RingTracer to disk, see sm83::TraceMode::Ring.
+    void DumpTrace() const;
     void SetKeyState(Input btn, bool pressed) { GetBus().joypad.SetButton(btn, pressed); }
 
 private:
+    std::shared_ptr<spdlog::logger> logger_;
+    // Binds logger_ while the members below are constructed, as loading the ROM already logs.
+    // Released at the end of the constructor.
+    std::optional<log::ScopedThreadLogger> construction_logger_;
     sm83::Cpu cpu_;
+    sm83::AnyTracer tracer_;
     DrawCallback draw_cb_;
     std::filesystem::path rom_path_;
     std::filesystem::path save_path_;
@@ -36,7 +36,7 @@ public:
 
         if (select_buttons_ && select_dpad_) [[unlikely]]
         {
-            LOG_WARN("Joypad: Both button groups selected simultaneously (wtf)");
+            LOG_WARN_LIMITED("Joypad: Both button groups selected simultaneously (wtf)");
             return buttons;
         }
 
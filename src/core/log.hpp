@@ -0,0 +1,79 @@
+#pragma once
+
+#include <spdlog/spdlog.h>
+
+#include <bit>
+#include <cstdint>
+
+namespace gb::log
+{
+namespace detail
+{
+inline thread_local spdlog::logger* thread_logger = nullptr;
+}  // namespace detail
+
+// Logger used by the LOG_* macros on the calling thread, spdlog's default logger unless another
+// one is bound. Emulator instances bind their own while they run, so that instances running on
+// different threads don't contend on the mutex of a shared sink.
+[[nodiscard]] inline spdlog::logger* GetThreadLogger()
+{
+    spdlog::logger* logger = detail::thread_logger;
+    return logger != nullptr ? logger : spdlog::default_logger_raw();
+}
+
+// Binds a logger to the calling thread until destroyed, nullptr keeps the current one.
+class ScopedThreadLogger
+{
+public:
+    explicit ScopedThreadLogger(spdlog::logger* logger) : previous_(detail::thread_logger)
+    {
+        if (logger != nullptr) { detail::thread_logger = logger; }
+    }
+    ~ScopedThreadLogger() { detail::thread_logger = previous_; }
+
+    ScopedThreadLogger(const ScopedThreadLogger&) = delete;
+    ScopedThreadLogger& operator=(const ScopedThreadLogger&) = delete;
+    ScopedThreadLogger(ScopedThreadLogger&&) = delete;
+    ScopedThreadLogger& operator=(ScopedThreadLogger&&) = delete;
+
+private:
+    spdlog::logger* previous_;
+};
+
+// Rate limited log statements print their first few occurrences, then only the ones whose count
+// is a power of two.
+constexpr uint64_t kRateLimitBurst = 4;
+[[nodiscard]] constexpr bool ShouldLogOccurrence(uint64_t count)
+{
+    return count <= kRateLimitBurst || std::has_single_bit(count);
+}
+}  // namespace gb::log
+
+// Statements below SPDLOG_ACTIVE_LEVEL, set with GBCXX_LOG_LEVEL, are compiled out.
+#define LOG_TRACE(...) SPDLOG_LOGGER_TRACE(::gb::log::GetThreadLogger(), __VA_ARGS__)
+#define LOG_DEBUG(...) SPDLOG_LOGGER_DEBUG(::gb::log::GetThreadLogger(), __VA_ARGS__)
+#define LOG_INFO(...) SPDLOG_LOGGER_INFO(::gb::log::GetThreadLogger(), __VA_ARGS__)
+#define LOG_WARN(...) SPDLOG_LOGGER_WARN(::gb::log::GetThreadLogger(), __VA_ARGS__)
+#define LOG_ERROR(...) SPDLOG_LOGGER_ERROR(::gb::log::GetThreadLogger(), __VA_ARGS__)
+
+// For statements that may run on every emulated memory access or instruction. Occurrences are
+// counted per statement and thread, and logged with their count.
+#define LOG_LIMITED(log_macro, format, ...)                                              \
+    do {                                                                                 \
+        static thread_local uint64_t log_occurrences = 0;                                \
+        if (::gb::log::ShouldLogOccurrence(++log_occurrences))                           \
+        {                                                                                \
+            log_macro(format " (x{})", __VA_ARGS__ __VA_OPT__(, ) log_occurrences);      \
+        }                                                                                \
+    } while (0)
+
+#if SPDLOG_ACTIVE_LEVEL <= SPDLOG_LEVEL_WARN
+#define LOG_WARN_LIMITED(...) LOG_LIMITED(LOG_WARN, __VA_ARGS__)
+#else
+#define LOG_WARN_LIMITED(...) (void)0
+#endif
+#if SPDLOG_ACTIVE_LEVEL <= SPDLOG_LEVEL_ERROR
+#define LOG_ERROR_LIMITED(...) LOG_LIMITED(LOG_ERROR, __VA_ARGS__)
+#else
+#define LOG_ERROR_LIMITED(...) (void)0
+#endif
@@ -1,83 +1,371 @@
 #include "core/memory/bus.hpp"
 
+#include <array>
+#include <utility>
+
 #include "core/constants.hpp"
 
 namespace gb::memory
 {
-void Bus::Tick(uint8_t tcycles)
+namespace
+{
+constexpr uint32_t kOamDmaCycles = 640;
+// The first byte is copied an M-cycle after the register write.
+constexpr uint32_t kOamDmaStartDelay = 4;
+
+bool IsOnVramBus(uint16_t addr) { return addr >= kVramStart && addr <= kVramEnd; }
+
+// Bits of the registers held in io_shadow that read 1 whatever was written: unused bits, and all
+// of write-only registers, e.g. the low bytes of the sound channel frequencies.
+constexpr auto kIoReadMasks = []
+{
+    std::array<uint8_t, kIoEnd - kIoStart + 1> masks{};
+    const auto set = [&](uint16_t addr, uint8_t mask) { masks[addr - kIoStart] = mask; };
+    set(kRegSc, 0x7e);
+    set(kRegNr10, 0x80);
+    set(kRegNr11, 0x3f);
+    set(kRegNr13, 0xff);
+    set(kRegNr14, 0xbf);
+    // Unused, between the registers of channels 1 and 2.
+    set(0xff15, 0xff);
+    set(kRegNr21, 0x3f);
+    set(kRegNr23, 0xff);
+    set(kRegNr24, 0xbf);
+    set(kRegNr30, 0x7f);
+    set(kRegNr31, 0xff);
+    set(kRegNr32, 0x9f);
+    set(kRegNr33, 0xff);
+    set(kRegNr34, 0xbf);
+    // Unused, between the registers of channels 3 and 4.
+    set(0xff1f, 0xff);
+    set(kRegNr41, 0xff);
+    set(kRegNr44, 0xbf);
+    set(kRegNr52, 0x70);
+    return masks;
+}();
+}  // namespace
+
+void Bus::MapPages()
 {
-    timer.Tick(tcycles);
+    MapRomPages();
+
+    const auto map = [this](uint16_t start, uint16_t end, uint8_t* data)
+    {
+        for (size_t page = start >> 8; page <= end >> 8; ++page)
+        {
+            read_pages[page] = write_pages[page] = data + ((page - (start >> 8)) * 0x100);
+        }
+    };
+    map(kVramStart, kVramEnd, ppu.GetVram().data());
+    map(kWorkRamStart, kWorkRamEnd, wram.data());
+    // Echo RAM ends 512 bytes early, on a page boundary.
+    map(kEchoRamStart, kEchoRamEnd, wram.data());
+    // VRAM writes catch the PPU up first, so that scanlines rendered earlier don't see them, and
+    // update its decoded tiles and tile maps.
+    std::fill(write_pages.begin() + (kVramStart >> 8), write_pages.begin() + (kVramEnd >> 8) + 1,
+              nullptr);
+}
+
+void Bus::MapRomPages()
+{
+    constexpr size_t kPagesPerBank = 0x40;
+    const std::array banks = {cartridge.GetRomBankData(0), cartridge.GetRomBankData(0x4000)};
+    for (size_t page = 0; page < banks.size() * kPagesPerBank; ++page)
+    {
+        read_pages[page] = banks[page / kPagesPerBank] + ((page % kPagesPerBank) * 0x100);
+    }
+}
+
+void Bus::MapIoRegisters()
+{
+    const auto map = [this](uint16_t start, uint16_t end, IoRegister reg)
+    {
+        for (uint16_t addr = start; addr <= end; ++addr) { io_registers[addr - kIoStart] = reg; }
+    };
+
+    // Unused registers, including the boot ROM switch, read 0xff and ignore writes.
+    io_shadow.fill(0xff);
+    map(kIoStart, kIoEnd, {.write = [](Bus& /*bus*/, uint16_t /*addr*/, uint8_t /*val*/) {}});
+
+    // Serial and sound aren't emulated, their registers hold what was written, as far as it can
+    // be read back, see kIoReadMasks.
+    map(kRegSb, kRegSc, {});
+    map(kRegNr10, kRegNr51, {});
+    map(kWavePatternStart, kWavePatternEnd, {});
+    map(kRegNr52, kRegNr52,
+        {
+            // Only the APU enable bit is writable, the low bits tell which channels are on, i.e.
+            // none.
+            .write = [](Bus& bus, uint16_t addr, uint8_t val)
+            { bus.io_shadow[addr - kIoStart] = val & 0x80; },
+        });
+
+    map(kRegJoyp, kRegJoyp,
+        {
+            .read = [](const Bus& bus, uint16_t /*addr*/) { return bus.joypad.ReadButtons(); },
+            .write = [](Bus& bus, uint16_t /*addr*/, uint8_t val) { bus.joypad.Write(val); },
+        });
+    map(kRegDiv, kRegTac,
+        {
+            .read = [](const Bus& bus, uint16_t addr)
+            { return bus.timer.ReadByte(addr, bus.scheduler.GetTimestamp()); },
+            .write =
+                [](Bus& bus, uint16_t addr, uint8_t val)
+            {
+                // Writes may move the next overflow or increment TIMA, which can request an
+                // interrupt that reaches IF after the instruction.
+                bus.timer.WriteByte(addr, val, bus.scheduler.GetTimestamp());
+                bus.scheduler.Schedule(EventType::Timer, bus.scheduler.GetTimestamp() + 1);
+            },
+        });
+    map(kRegIf, kRegIf,
+        {
+            .read = [](const Bus& bus, uint16_t /*addr*/) { return bus.interrupt_flag; },
+            .write = [](Bus& bus, uint16_t /*addr*/, uint8_t val) { bus.interrupt_flag = val; },
+        });
+
+    const IoRegister ppu_register = {
+        .read =
+            [](const Bus& bus, uint16_t addr)
+        {
+            bus.CatchUpPpu();
+            return bus.ppu.ReadByte(addr);
+        },
+        .write =
+            [](Bus& bus, uint16_t addr, uint8_t val)
+        {
+            // Registers may move the next PPU event or request an interrupt, which reaches IF
+            // after the instruction.
+            bus.SyncPpu();
+            bus.ppu.WriteByte(addr, val);
+            bus.scheduler.Schedule(EventType::Ppu, bus.scheduler.GetTimestamp() + 1);
+        },
+    };
+    map(kRegLcdc, kRegLyc, ppu_register);
+    map(kRegBgp, kRegWx, ppu_register);
+    map(kRegOamDma, kRegOamDma,
+        {
+            .read = [](const Bus& bus, uint16_t /*addr*/) { return bus.oam_dma.source; },
+            .write = [](Bus& bus, uint16_t /*addr*/, uint8_t val) { bus.StartOamDma(val); },
+        });
+}
+
+void Bus::RunDueEvents()
+{
+    while (const auto type = scheduler.PopDueEvent())
+    {
+        switch (*type)
+        {
+        case EventType::Timer:
+            SyncTimer();
+            ScheduleTimer();
+            break;
+        case EventType::Ppu:
+            SyncPpu();
+            SchedulePpu();
+            break;
+        case EventType::OamDma:
+            if (oam_dma.active) { FinishOamDma(); }
+            break;
+        case EventType::Count: std::unreachable();
+        }
+    }
+}
+
+namespace
+{
+template <typename F>
+void TickInChunks(uint64_t& timestamp, uint64_t now, F tick)
+{
+    while (timestamp < now)
+    {
+        const auto tcycles = static_cast<uint32_t>(
+            std::min<uint64_t>(now - timestamp, std::numeric_limits<uint32_t>::max()));
+        tick(tcycles);
+        timestamp += tcycles;
+    }
+}
+
+// Deadlines that already passed are handled after the next instruction, as ticking after every
+// instruction did.
+uint64_t GetDeadline(uint64_t now, uint32_t cycles)
+{
+    if (cycles == std::numeric_limits<uint32_t>::max()) { return Scheduler::kNever; }
+    return now + std::max(cycles, 1U);
+}
+}  // namespace
+
+void Bus::SyncTimer()
+{
+    timer.Sync(scheduler.GetTimestamp());
     interrupt_flag |= timer.ConsumeInterrupts();
+}
 
-    ppu.Tick(tcycles);
+void Bus::SyncPpu()
+{
+    CatchUpPpu();
     interrupt_flag |= ppu.ConsumeInterrupts();
 }
 
-uint8_t Bus::ReadByte(uint16_t addr) const
+void Bus::CatchUpPpu() const
+{
+    TickInChunks(ppu_timestamp, scheduler.GetTimestamp(),
+                 [this](uint32_t tcycles) { ppu.Tick(tcycles); });
+}
+
+void Bus::ScheduleTimer()
+{
+    static_assert(sm83::Timer::kNever == Scheduler::kNever);
+    scheduler.Schedule(EventType::Timer, timer.GetNextOverflow());
+}
+
+void Bus::SchedulePpu()
+{
+    scheduler.Schedule(EventType::Ppu,
+                       GetDeadline(scheduler.GetTimestamp(), ppu.CyclesUntilNextEvent()));
+}
+
+void Bus::StartOamDma(uint8_t source)
+{
+    oam_dma = {
+        .start = scheduler.GetTimestamp() + kOamDmaStartDelay,
+        .source = source,
+        .active = true,
+    };
+    scheduler.Schedule(EventType::OamDma, oam_dma.start + kOamDmaCycles);
+
+    // Accesses to the bus the transfer uses take the slow path, which handles the conflicts. A
+    // transfer restarted from another bus frees the previous one.
+    MapPages();
+    for (size_t page = 0; page < kOamStart >> 8; ++page)
+    {
+        if (IsOnOamDmaBus(static_cast<uint16_t>(page << 8)))
+        {
+            read_pages[page] = write_pages[page] = nullptr;
+        }
+    }
+}
+
+void Bus::FinishOamDma()
+{
+    // The PPU scans OAM when it catches up, which has to see the sprites from before the copy.
+    SyncPpu();
+
+    oam_dma.active = false;
+    MapPages();
+
+    const uint16_t source = GetOamDmaSource();
+    std::array<uint8_t, kOamEnd - kOamStart + 1> oam;
+    if (const uint8_t* page = read_pages[source >> 8])
+    {
+        std::ranges::copy_n(page, oam.size(), oam.begin());
+    }
+    else
+    {
+        // Cartridge RAM
+        for (uint16_t i = 0; i < oam.size(); ++i) { oam[i] = ReadByteSlow(source + i); }
+    }
+    ppu.WriteOam(oam);
+}
+
+uint16_t Bus::GetOamDmaSource() const
+{
+    // Pages past WRAM read echo RAM, i.e. WRAM again.
+    const uint8_t page = oam_dma.source < 0xe0 ? oam_dma.source : oam_dma.source - 0x20;
+    return static_cast<uint16_t>(page << 8);
+}
+
+bool Bus::IsOnOamDmaBus(uint16_t addr) const
+{
+    return addr < kOamStart && IsOnVramBus(addr) == IsOnVramBus(GetOamDmaSource());
+}
+
+uint8_t Bus::ReadByteSlow(uint16_t addr) const
 {
 #ifdef GBCXX_TESTS
-    return wram[addr];
+    if (flat_memory) { return wram[addr]; }
 #endif
 
+    if (oam_dma.active) [[unlikely]]
+    {
+        if (addr >= kOamStart && addr <= kOamEnd) { return 0xff; }
+        if (IsOnOamDmaBus(addr))
+        {
+            const uint64_t now = scheduler.GetTimestamp();
+            const uint64_t elapsed = now > oam_dma.start ? now - oam_dma.start : 0;
+            const uint64_t idx = std::min<uint64_t>(elapsed / 4, kOamEnd - kOamStart);
+            addr = static_cast<uint16_t>(GetOamDmaSource() + idx);
+        }
+    }
+
+    if (addr >= kIoStart && addr <= kIoEnd)
+    {
+        const IoRegister& reg = io_registers[addr - kIoStart];
+        if (reg.read != nullptr) { return reg.read(*this, addr); }
+        return io_shadow[addr - kIoStart] | kIoReadMasks[addr - kIoStart];
+    }
+    if (addr >= kHighRamStart && addr <= kHighRamEnd) { return hram[addr - kHighRamStart]; }
+    if (addr == kRegIe) { return interrupt_enable; }
     if ((addr >= kCartridgeStart && addr <= kCartridgeEnd) ||
         (addr >= kExternalRamStart && addr <= kExternalRamEnd))
     {
         return cartridge.ReadByte(addr);
     }
-    if ((addr >= kVramStart && addr <= kVramEnd) || (addr >= kOamStart && addr <= kOamEnd) ||
-        (addr >= kRegLcdc && addr <= kRegLyc) || (addr >= kRegBgp && addr <= kRegWx))
+    if (addr >= kVramStart && addr <= kVramEnd) { return ppu.ReadByte(addr); }
+    if (addr >= kOamStart && addr <= kOamEnd)
     {
+        CatchUpPpu();
         return ppu.ReadByte(addr);
     }
     if (addr >= kWorkRamStart && addr <= kWorkRamEnd) { return wram[addr - kWorkRamStart]; }
     if (addr >= kEchoRamStart && addr <= kEchoRamEnd) { return wram[addr - kEchoRamStart]; }
-    if (addr >= kRegDiv && addr <= kRegTac) { return timer.ReadByte(addr); }
     if (addr >= kNotUsableStart && addr <= kNotUsableEnd) { return 0; }
-    if (addr >= kHighRamStart && addr <= kHighRamEnd) { return hram[addr - kHighRamStart]; }
-    if (addr == kRegJoyp) { return joypad.ReadButtons(); }
-    if (addr == kRegIf) { return interrupt_flag; }
-    if (addr == kRegIe) { return interrupt_enable; }
-    if (addr == kRegBootrom) { return 0xff; }
 
-    LOG_ERROR("Bus: Unmapped read {:X}", addr);
+    LOG_ERROR_LIMITED("Bus: Unmapped read {:X}", addr);
     return 0xff;
 }
 
-void Bus::WriteByte(uint16_t addr, uint8_t val)
+void Bus::WriteByteSlow(uint16_t addr, uint8_t val)
 {
 #ifdef GBCXX_TESTS
-    wram[addr] = val;
-    return;
+    if (flat_memory)
+    {
+        wram[addr] = val;
+        return;
+    }
 #endif
 
-    if ((addr >= kCartridgeStart && addr <= kCartridgeEnd) ||
-        (addr >= kExternalRamStart && addr <= kExternalRamEnd))
+    if (oam_dma.active) [[unlikely]]
+    {
+        if ((addr >= kOamStart && addr <= kOamEnd) || IsOnOamDmaBus(addr)) { return; }
+    }
+
+    if (addr >= kIoStart && addr <= kIoEnd)
+    {
+        const IoRegister& reg = io_registers[addr - kIoStart];
+        if (reg.write != nullptr) { reg.write(*this, addr, val); }
+        else { io_shadow[addr - kIoStart] = val; }
+    }
+    else if (addr >= kHighRamStart && addr <= kHighRamEnd) { hram[addr - kHighRamStart] = val; }
+    else if (addr == kRegIe) { interrupt_enable = val; }
+    else if (addr >= kCartridgeStart && addr <= kCartridgeEnd)
+    {
+        cartridge.WriteByte(addr, val);
+        MapRomPages();
+    }
+    else if (addr >= kExternalRamStart && addr <= kExternalRamEnd)
     {
         cartridge.WriteByte(addr, val);
     }
-    else if ((addr >= kVramStart && addr <= kVramEnd) || (addr >= kOamStart && addr <= kOamEnd) ||
-             (addr >= kRegLcdc && addr <= kRegLyc) || (addr >= kRegBgp && addr <= kRegWx))
+    else if ((addr >= kVramStart && addr <= kVramEnd) || (addr >= kOamStart && addr <= kOamEnd))
     {
+        SyncPpu();
         ppu.WriteByte(addr, val);
     }
     else if (addr >= kWorkRamStart && addr <= kWorkRamEnd) { wram[addr - kWorkRamStart] = val; }
     else if (addr >= kEchoRamStart && addr <= kEchoRamEnd) { wram[addr - kEchoRamStart] = val; }
-    else if (addr >= kRegDiv && addr <= kRegTac) { timer.WriteByte(addr, val); }
-    else if ((addr >= kNotUsableStart && addr <= kNotUsableEnd) || addr == kRegBootrom) { return; }
-    else if (addr == kRegJoyp) { joypad.Write(val); }
-    else if (addr >= kHighRamStart && addr <= kHighRamEnd) { hram[addr - kHighRamStart] = val; }
-    else if (addr == kRegOamDma)
-    {
-        const uint16_t source_address = val * 0x100;
-        constexpr auto kOamSize = 0xa0;
-        for (uint8_t i = 0; i < kOamSize; ++i)
-        {
-            WriteByte(kOamStart + i, ReadByte(source_address + i));
-        }
-    }
-    else if (addr == kRegIf) { interrupt_flag = val; }
-    else if (addr == kRegIe) { interrupt_enable = val; }
-    else { LOG_ERROR("Bus: Unmapped write {:X} <- {:X}", addr, val); }
+    else if (addr >= kNotUsableStart && addr <= kNotUsableEnd) { return; }
+    else { LOG_ERROR_LIMITED("Bus: Unmapped write {:X} <- {:X}", addr, val); }
 }
 
 }  // namespace gb::memory
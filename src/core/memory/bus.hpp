@@ -1,10 +1,14 @@
 #pragma once
 
 #include <algorithm>
+#include <array>
+#include <limits>
 #include <random>
 
+#include "core/constants.hpp"
 #include "core/joypad.hpp"
 #include "core/memory/cartridge.hpp"
+#include "core/scheduler.hpp"
 #include "core/sm83/timer.hpp"
 #include "core/video/ppu.hpp"
 
@@ -13,7 +17,9 @@ namespace gb::memory
 struct Bus
 {
     Cartridge cartridge{};
-    video::Ppu ppu;
+    // The PPU catches up lazily when it's accessed or its next event is due. Reads of its registers
+    // and OAM catch it up too, which doesn't change anything the CPU can observe, hence mutable.
+    mutable video::Ppu ppu;
     sm83::Timer timer;
     Joypad joypad;
     std::vector<uint8_t> wram;
@@ -21,30 +27,152 @@ struct Bus
     uint8_t interrupt_enable{0x00};
     uint8_t interrupt_flag{0xe1};
 
+    // OAM DMA copies 160 bytes from the page written to the register into OAM, one every 4
+    // cycles. Meanwhile the CPU can't access OAM, nor the bus the transfer reads from: the VRAM bus
+    // or the external bus, i.e. cartridge and WRAM. Reads from that bus see the byte being
+    // transferred. As only the PPU could observe OAM filling up, it's copied at once at the end.
+    struct OamDma
+    {
+        uint64_t start{};
+        uint8_t source{};
+        bool active{};
+    };
+    OamDma oam_dma;
+
+    Scheduler scheduler;
+    // When the PPU was last ticked.
+    mutable uint64_t ppu_timestamp{};
+
+    // Memory map in 256-byte pages. Pages of plain memory point straight at it: both ROM banks,
+    // VRAM, WRAM and echo RAM. nullptr pages, i.e. cartridge RAM, OAM, I/O registers and HRAM,
+    // and writes to MBC registers and VRAM go through ReadByteSlow() and WriteByteSlow(), which
+    // check the last page first.
+    std::array<const uint8_t*, 256> read_pages{};
+    std::array<uint8_t*, 256> write_pages{};
+
+    // Handlers of the I/O registers at 0xff00-0xff7f. Registers without a handler are plain bytes,
+    // read from and written to the shadow array.
+    struct IoRegister
+    {
+        uint8_t (*read)(const Bus& bus, uint16_t addr){};
+        void (*write)(Bus& bus, uint16_t addr, uint8_t val){};
+    };
+    std::array<IoRegister, kIoEnd - kIoStart + 1> io_registers{};
+    std::array<uint8_t, kIoEnd - kIoStart + 1> io_shadow{};
+
 #ifdef GBCXX_TESTS
-    // NOLINTNEXTLINE(performance-unnecessary-value-param)
-    explicit Bus(std::vector<uint8_t> /*rom_data*/) : wram(64_KiB) {}
-#else
+    // Set when the bus is 64KiB of flat RAM.
+    bool flat_memory{};
+#endif
+
     explicit Bus(std::vector<uint8_t> rom_data)
-        : cartridge(Cartridge::FromRom(std::move(rom_data))), wram(8_KiB)
     {
+#ifdef GBCXX_TESTS
+        // Without a ROM, the bus is flat RAM for the single-step CPU tests. Tests of the components
+        // on the bus pass a ROM and get the regular memory map.
+        if (rom_data.empty())
+        {
+            flat_memory = true;
+            wram.resize(64_KiB);
+            for (size_t page = 0; page < read_pages.size(); ++page)
+            {
+                read_pages[page] = write_pages[page] = wram.data() + (page * 0x100);
+            }
+            return;
+        }
+#endif
+        cartridge = Cartridge::FromRom(std::move(rom_data));
+        wram.resize(8_KiB);
+
         // Fill wram and hram with random values
         auto eng = std::default_random_engine{std::random_device{}()};
         auto dist = std::uniform_int_distribution<uint8_t>{0, 0xff};
         std::ranges::generate(wram, [&] { return dist(eng); });
         std::ranges::generate(hram, [&] { return dist(eng); });
+
+        MapPages();
+        MapIoRegisters();
+    }
+
+    // The page table points into the bus itself.
+    Bus(const Bus&) = delete;
+    Bus& operator=(const Bus&) = delete;
+    Bus(Bus&&) = delete;
+    Bus& operator=(Bus&&) = delete;
+    ~Bus() = default;
+
+    // Advances the clock after an instruction, which is when components whose deadline has passed
+    // catch up.
+    void Tick(uint16_t tcycles)
+    {
+        scheduler.Advance(tcycles);
+        if (scheduler.HasDueEvent()) [[unlikely]] { RunDueEvents(); }
     }
-#endif
 
-    void Tick(uint8_t tcycles);
+    // Cycles until the next PPU event, i.e. interrupt or frame, timer interrupt or end of OAM DMA.
+    [[nodiscard]] uint32_t CyclesUntilNextEvent() const
+    {
+        const uint64_t now = scheduler.GetTimestamp();
+        const uint64_t deadline = scheduler.GetNextDeadline();
+        if (deadline <= now) { return 0; }
+        return static_cast<uint32_t>(
+            std::min<uint64_t>(deadline - now, std::numeric_limits<uint32_t>::max()));
+    }
+    // Cycles until the next event or PPU mode or line change, i.e. until registers may read
+    // differently. Catches the PPU up to find the latter.
+    [[nodiscard]] uint32_t CyclesUntilStateChange()
+    {
+        SyncPpu();
+        return std::min(CyclesUntilNextEvent(), ppu.CyclesUntilModeChange());
+    }
 
-    [[nodiscard]] uint8_t ReadByte(uint16_t addr) const;
-    void WriteByte(uint16_t addr, uint8_t val);
+    [[nodiscard]] uint8_t ReadByte(uint16_t addr) const
+    {
+        if (const uint8_t* page = read_pages[addr >> 8]) [[likely]] { return page[addr & 0xff]; }
+        return ReadByteSlow(addr);
+    }
+    void WriteByte(uint16_t addr, uint8_t val)
+    {
+        if (uint8_t* page = write_pages[addr >> 8]) [[likely]]
+        {
+            page[addr & 0xff] = val;
+            return;
+        }
+        WriteByteSlow(addr, val);
+    }
 
     [[nodiscard]] uint8_t GetPendingInterrupts() const
     {
         return interrupt_enable & interrupt_flag & 0x1f;
     }
+
+    // Whether the address is on the bus used by the running OAM DMA, i.e. reads the byte being
+    // transferred while it's active.
+    [[nodiscard]] bool IsOnOamDmaBus(uint16_t addr) const;
+
+private:
+    [[nodiscard]] uint8_t ReadByteSlow(uint16_t addr) const;
+    void WriteByteSlow(uint16_t addr, uint8_t val);
+
+    void MapPages();
+    // Follows MBC bank switches.
+    void MapRomPages();
+    void MapIoRegisters();
+
+    void StartOamDma(uint8_t source);
+    void FinishOamDma();
+    [[nodiscard]] uint16_t GetOamDmaSource() const;
+
+    void RunDueEvents();
+    // Tick the component up to the current timestamp, i.e. the start of the instruction being
+    // executed, and compute its next deadline.
+    void SyncTimer();
+    void SyncPpu();
+    // Like SyncPpu(), but leaves interrupts in the PPU. Accesses never catch it up past an event,
+    // so it has none to request.
+    void CatchUpPpu() const;
+    void ScheduleTimer();
+    void SchedulePpu();
 };
 
 }  // namespace gb::memory
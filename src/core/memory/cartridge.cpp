@@ -57,21 +57,21 @@ Cartridge Cartridge::FromRom(std::vector<uint8_t> rom)
     LOG_INFO("Cartridge: {}", cart_name);
 
     Cartridge cart;
-    cart.mbc_ = [&]() -> std::unique_ptr<Mbc>
+    cart.mbc_ = [&]() -> decltype(mbc_)
     {
         switch (code)
         {
-        case 0x00: return std::make_unique<Mbc0>(std::move(rom));
+        case 0x00: return Mbc0{std::move(rom)};
         case 0x01:
         case 0x02:
-        case 0x03: return std::make_unique<Mbc1>(std::move(rom));
+        case 0x03: return Mbc1{std::move(rom)};
         case 0x05:
-        case 0x06: return std::make_unique<Mbc2>(std::move(rom));
+        case 0x06: return Mbc2{std::move(rom)};
         case 0x0f:
         case 0x10:
         case 0x11:
         case 0x12:
-        case 0x13: return std::make_unique<Mbc3>(std::move(rom));
+        case 0x13: return Mbc3{std::move(rom)};
         default: DIE("MBC: Unimplemented cartridge code {:X}", code);
         }
     }();
@@ -81,19 +81,35 @@ Cartridge Cartridge::FromRom(std::vector<uint8_t> rom)
 
 uint8_t Cartridge::ReadByte(uint16_t addr) const
 {
-    if (addr >= kCartridgeStart && addr <= kCartridgeEnd) { return mbc_->ReadRom(addr); }
-    if (addr >= kExternalRamStart && addr <= kExternalRamEnd) { return mbc_->ReadRam(addr); }
-    LOG_ERROR("Cartridge: Unmapped read {:X}", addr);
+    if (addr >= kCartridgeStart && addr <= kCartridgeEnd) { return GetRom().Read(addr); }
+    if (addr >= kExternalRamStart && addr <= kExternalRamEnd)
+    {
+        return std::visit([addr](const auto& mbc) { return mbc.ReadRam(addr); }, mbc_);
+    }
+    LOG_ERROR_LIMITED("Cartridge: Unmapped read {:X}", addr);
     return 0;
 }
 
-void Cartridge::WriteByte(uint16_t addr, uint8_t val) const
+void Cartridge::WriteByte(uint16_t addr, uint8_t val)
+{
+    if (addr >= kCartridgeStart && addr <= kCartridgeEnd)
+    {
+        std::visit([addr, val](auto& mbc) { mbc.WriteRom(addr, val); }, mbc_);
+    }
+    else if (addr >= kExternalRamStart && addr <= kExternalRamEnd)
+    {
+        std::visit([addr, val](auto& mbc) { mbc.WriteRam(addr, val); }, mbc_);
+    }
+    else { LOG_ERROR_LIMITED("Cartridge: Unmapped write {:X} <- {:X}", addr, val); }
+}
+
+void Cartridge::LoadRam(std::ifstream& save_file)
 {
-    if (addr >= kCartridgeStart && addr <= kCartridgeEnd) { mbc_->WriteRom(addr, val); }
-    else if (addr >= kExternalRamStart && addr <= kExternalRamEnd) { mbc_->WriteRam(addr, val); }
-    else { LOG_ERROR("Cartridge: Unmapped write {:X} <- {:X}", addr, val); }
+    std::visit([&](auto& mbc) { mbc.LoadRam(save_file); }, mbc_);
 }
 
-void Cartridge::LoadRam(std::ifstream& save_file) const { mbc_->LoadRam(save_file); }
-void Cartridge::SaveRam(std::ofstream& save_file) const { mbc_->SaveRam(save_file); }
+void Cartridge::SaveRam(std::ofstream& save_file) const
+{
+    std::visit([&](const auto& mbc) { mbc.SaveRam(save_file); }, mbc_);
+}
 }  // namespace gb::memory
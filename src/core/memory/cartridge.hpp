@@ -1,7 +1,7 @@
 #pragma once
 
 #include <cstdint>
-#include <memory>
+#include <variant>
 #include <vector>
 
 #include "core/memory/mbc.hpp"
@@ -16,13 +16,27 @@ public:
     [[nodiscard]] bool HasBattery() const { return has_battery_; }
 
     [[nodiscard]] uint8_t ReadByte(uint16_t addr) const;
-    void WriteByte(uint16_t addr, uint8_t val) const;
+    // Index of the ROM bank currently mapped at the given address (0x0000-0x7fff).
+    [[nodiscard]] size_t GetRomBank(uint16_t addr) const { return GetRom().GetBank(addr); }
+    // The 16 KiB ROM bank mapped at 0x0000 or 0x4000.
+    [[nodiscard]] const uint8_t* GetRomBankData(uint16_t addr) const
+    {
+        return GetRom().GetBankData(addr);
+    }
+    void WriteByte(uint16_t addr, uint8_t val);
 
-    void LoadRam(std::ifstream& save_file) const;
+    void LoadRam(std::ifstream& save_file);
     void SaveRam(std::ofstream& save_file) const;
 
 private:
-    std::unique_ptr<Mbc> mbc_;
+    [[nodiscard]] const BankedRom& GetRom() const
+    {
+        return std::visit([](const auto& mbc) -> const BankedRom& { return mbc.GetRom(); }, mbc_);
+    }
+
+    // Chosen once from the cartridge header, every access dispatches on the index instead of
+    // through a vtable, which lets the compiler inline the MBC.
+    std::variant<Mbc0, Mbc1, Mbc2, Mbc3> mbc_;
     bool has_battery_{};
 };
 }  // namespace gb::memory
@@ -1,5 +1,8 @@
 #include "core/memory/mbc.hpp"
 
+#include <algorithm>
+#include <utility>
+
 #include "core/util.hpp"
 
 namespace
@@ -26,39 +29,30 @@ size_t CountRomBanks(uint8_t val)
 
 namespace gb::memory
 {
+BankedRom::BankedRom(std::vector<uint8_t> rom) : rom_(std::move(rom))
+{
+    const size_t nr_banks = std::max<size_t>(2, (rom_.size() + kBankSize - 1) / kBankSize);
+    rom_.resize(nr_banks * kBankSize, 0xff);
+}
+
+void BankedRom::Map(size_t bank0, size_t bank1)
+{
+    const size_t nr_banks = rom_.size() / kBankSize;
+    bank_offsets_ = {(bank0 % nr_banks) * kBankSize, (bank1 % nr_banks) * kBankSize};
+}
+
 // MBC0
 Mbc0::Mbc0(std::vector<uint8_t> cartrom) : rom_(std::move(cartrom)) {}
-uint8_t Mbc0::ReadRom(uint16_t addr) const { return rom_[addr]; }
-uint8_t Mbc0::ReadRam(uint16_t /*address*/) const { return 0; }
-void Mbc0::WriteRom(uint16_t /*address*/, uint8_t /*value*/) {}
-void Mbc0::WriteRam(uint16_t /*address*/, uint8_t /*value*/) {}
-void Mbc0::LoadRam(std::ifstream& /*save_file*/) {}
-void Mbc0::SaveRam(std::ofstream& /*save_file*/) const {}
 
 Mbc1::Mbc1(std::vector<uint8_t> cartrom)
     : rom_(std::move(cartrom)),
-      nr_rom_banks_(CountRomBanks(rom_[0x148])),
-      nr_ram_banks_(CountRamBanks(rom_[0x149])),
+      nr_rom_banks_(CountRomBanks(rom_.Read(0x148))),
+      nr_ram_banks_(CountRamBanks(rom_.Read(0x149))),
       ram_(nr_rom_banks_ * 0x2000)
 {
 }
 
 // MBC1
-uint8_t Mbc1::ReadRom(uint16_t addr) const
-{
-    const auto bank = [&] -> size_t
-    {
-        if (addr < 0x4000)
-        {
-            if (banking_mode_ == 0) { return 0; }
-            return rom_bank_ & 0xe0;
-        }
-        return rom_bank_;
-    }();
-
-    return rom_[(bank * 0x4000) + (addr % 0x4000)];
-}
-
 uint8_t Mbc1::ReadRam(uint16_t addr) const
 {
     if (!ram_enabled_) { return 0xff; }
@@ -86,6 +80,8 @@ void Mbc1::WriteRom(uint16_t addr, uint8_t val)
     }
     else if (addr <= 0x7fff) { banking_mode_ = val & 1; }
     else { DIE("MBC1: Unmapped ROM write {:X} <- {:X}", addr, val); }
+
+    rom_.Map(banking_mode_ == 0 ? 0 : rom_bank_ & 0xe0, rom_bank_);
 }
 
 void Mbc1::WriteRam(uint16_t addr, uint8_t val)
@@ -109,13 +105,6 @@ void Mbc1::SaveRam(std::ofstream& save_file) const
 // MBC2
 Mbc2::Mbc2(std::vector<uint8_t> cartrom) : rom_(std::move(cartrom)) {}
 
-uint8_t Mbc2::ReadRom(uint16_t addr) const
-{
-    if (addr <= 0x3fff) { return rom_[addr]; }
-    if (addr <= 0x7fff) { return rom_[(rom_bank_ * 0x4000) + (addr - 0x4000)]; }
-    DIE("MBC2: Unmapped ROM read {:X}", addr);
-}
-
 uint8_t Mbc2::ReadRam(uint16_t addr) const
 {
     if (!ram_enabled_) { return 0xff; }
@@ -136,6 +125,8 @@ void Mbc2::WriteRom(uint16_t addr, uint8_t val)
     }
     else if (addr <= 0x7fff) {}
     else { DIE("MBC2: Unmapped ROM write {:X} <- {:X}", addr, val); }
+
+    rom_.Map(0, rom_bank_);
 }
 
 void Mbc2::WriteRam(uint16_t addr, uint8_t val)
@@ -158,13 +149,6 @@ void Mbc2::SaveRam(std::ofstream& save_file) const
 // MBC3
 Mbc3::Mbc3(std::vector<uint8_t> cartrom) : rom_(std::move(cartrom)), ram_(32_KiB) {}
 
-uint8_t Mbc3::ReadRom(uint16_t addr) const
-{
-    if (addr <= 0x3fff) { return rom_[addr]; }
-    if (addr <= 0x7fff) { return rom_[(rom_bank_ * 0x4000) | (addr % 0x4000)]; }
-    DIE("MBC3: Unmapped ROM read {:X}", addr);
-}
-
 uint8_t Mbc3::ReadRam(uint16_t addr) const
 {
     if (!ram_enabled_) { return 0xff; }
@@ -183,6 +167,8 @@ void Mbc3::WriteRom(uint16_t addr, uint8_t val)
         return;
     }
     else { DIE("MBC3: Unmapped register write {:X} <- {:X}", addr, val); }
+
+    rom_.Map(0, rom_bank_);
 }
 
 void Mbc3::WriteRam(uint16_t addr, uint8_t val)
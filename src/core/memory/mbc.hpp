@@ -7,55 +7,75 @@
 
 namespace gb::memory
 {
-class Mbc
+// Cartridge ROM together with the banks mapped at 0x0000 and 0x4000. MBCs remap the banks when
+// their bank registers are written, so that a read is a single indexed load.
+class BankedRom
 {
 public:
-    virtual ~Mbc() = default;
+    static constexpr size_t kBankSize = 0x4000;
+
+    // Pads the ROM to a whole number of banks, but at least two, with 0xff.
+    explicit BankedRom(std::vector<uint8_t> rom);
+
+    [[nodiscard]] uint8_t Read(uint16_t addr) const
+    {
+        return rom_[bank_offsets_[(addr >> 14) & 1] + (addr % kBankSize)];
+    }
+    // Index of the ROM bank mapped at the given address (0x0000-0x7fff).
+    [[nodiscard]] size_t GetBank(uint16_t addr) const
+    {
+        return bank_offsets_[(addr >> 14) & 1] / kBankSize;
+    }
+    [[nodiscard]] const uint8_t* GetBankData(uint16_t addr) const
+    {
+        return rom_.data() + bank_offsets_[(addr >> 14) & 1];
+    }
+
+    // Banks past the end of the ROM wrap around, like the unused upper bank bits on hardware.
+    void Map(size_t bank0, size_t bank1);
 
-    [[nodiscard]] virtual uint8_t ReadRom(uint16_t addr) const = 0;
-    [[nodiscard]] virtual uint8_t ReadRam(uint16_t addr) const = 0;
-
-    virtual void WriteRom(uint16_t addr, uint8_t val) = 0;
-    virtual void WriteRam(uint16_t addr, uint8_t val) = 0;
-
-    virtual void LoadRam(std::ifstream& save_file) = 0;
-    virtual void SaveRam(std::ofstream& save_file) const = 0;
+private:
+    std::vector<uint8_t> rom_;
+    std::array<size_t, 2> bank_offsets_{0, kBankSize};
 };
 
-class Mbc0 final : public Mbc
+// MBCs aren't polymorphic, the cartridge holds one of them in a std::variant.
+class Mbc0
 {
 public:
-    explicit Mbc0(std::vector<uint8_t> cartrom);
+    explicit Mbc0(std::vector<uint8_t> cartrom = {});
 
-    [[nodiscard]] uint8_t ReadRom(uint16_t addr) const override;
-    [[nodiscard]] uint8_t ReadRam(uint16_t addr) const override;
+    [[nodiscard]] uint8_t ReadRom(uint16_t addr) const { return rom_.Read(addr); }
+    [[nodiscard]] uint8_t ReadRam(uint16_t /*address*/) const { return 0; }
+    [[nodiscard]] const BankedRom& GetRom() const { return rom_; }
 
-    void WriteRom(uint16_t addr, uint8_t val) override;
-    void WriteRam(uint16_t addr, uint8_t val) override;
+    void WriteRom(uint16_t /*address*/, uint8_t /*value*/) {}
+    void WriteRam(uint16_t /*address*/, uint8_t /*value*/) {}
 
-    void LoadRam(std::ifstream& save_file) override;
-    void SaveRam(std::ofstream& save_file) const override;
+    void LoadRam(std::ifstream& /*save_file*/) {}
+    void SaveRam(std::ofstream& /*save_file*/) const {}
 
 private:
-    std::vector<uint8_t> rom_;
+    BankedRom rom_;
 };
 
-class Mbc1 final : public Mbc
+class Mbc1
 {
 public:
     explicit Mbc1(std::vector<uint8_t> cartrom);
 
-    [[nodiscard]] uint8_t ReadRom(uint16_t addr) const override;
-    [[nodiscard]] uint8_t ReadRam(uint16_t addr) const override;
+    [[nodiscard]] uint8_t ReadRom(uint16_t addr) const { return rom_.Read(addr); }
+    [[nodiscard]] uint8_t ReadRam(uint16_t addr) const;
+    [[nodiscard]] const BankedRom& GetRom() const { return rom_; }
 
-    void WriteRom(uint16_t addr, uint8_t val) override;
-    void WriteRam(uint16_t addr, uint8_t val) override;
+    void WriteRom(uint16_t addr, uint8_t val);
+    void WriteRam(uint16_t addr, uint8_t val);
 
-    void LoadRam(std::ifstream& save_file) override;
-    void SaveRam(std::ofstream& save_file) const override;
+    void LoadRam(std::ifstream& save_file);
+    void SaveRam(std::ofstream& save_file) const;
 
 private:
-    std::vector<uint8_t> rom_;
+    BankedRom rom_;
     size_t nr_rom_banks_{0};
     size_t nr_ram_banks_{0};
     std::vector<uint8_t> ram_;
@@ -65,43 +85,45 @@ private:
     bool ram_enabled_{false};
 };
 
-class Mbc2 : public Mbc
+class Mbc2
 {
 public:
     explicit Mbc2(std::vector<uint8_t> cartrom);
 
-    [[nodiscard]] uint8_t ReadRom(uint16_t addr) const override;
-    [[nodiscard]] uint8_t ReadRam(uint16_t addr) const override;
+    [[nodiscard]] uint8_t ReadRom(uint16_t addr) const { return rom_.Read(addr); }
+    [[nodiscard]] uint8_t ReadRam(uint16_t addr) const;
+    [[nodiscard]] const BankedRom& GetRom() const { return rom_; }
 
-    void WriteRom(uint16_t addr, uint8_t val) override;
-    void WriteRam(uint16_t addr, uint8_t val) override;
+    void WriteRom(uint16_t addr, uint8_t val);
+    void WriteRam(uint16_t addr, uint8_t val);
 
-    void LoadRam(std::ifstream& save_file) override;
-    void SaveRam(std::ofstream& save_file) const override;
+    void LoadRam(std::ifstream& save_file);
+    void SaveRam(std::ofstream& save_file) const;
 
 private:
-    std::vector<uint8_t> rom_;
+    BankedRom rom_;
     std::array<uint8_t, 512> ram_;
     size_t rom_bank_{1};
     bool ram_enabled_{false};
 };
 
-class Mbc3 : public Mbc
+class Mbc3
 {
 public:
     explicit Mbc3(std::vector<uint8_t> cartrom);
 
-    [[nodiscard]] uint8_t ReadRom(uint16_t addr) const override;
-    [[nodiscard]] uint8_t ReadRam(uint16_t addr) const override;
+    [[nodiscard]] uint8_t ReadRom(uint16_t addr) const { return rom_.Read(addr); }
+    [[nodiscard]] uint8_t ReadRam(uint16_t addr) const;
+    [[nodiscard]] const BankedRom& GetRom() const { return rom_; }
 
-    void WriteRom(uint16_t addr, uint8_t val) override;
-    void WriteRam(uint16_t addr, uint8_t val) override;
+    void WriteRom(uint16_t addr, uint8_t val);
+    void WriteRam(uint16_t addr, uint8_t val);
 
-    void LoadRam(std::ifstream& save_file) override;
-    void SaveRam(std::ofstream& save_file) const override;
+    void LoadRam(std::ifstream& save_file);
+    void SaveRam(std::ofstream& save_file) const;
 
 private:
-    std::vector<uint8_t> rom_;
+    BankedRom rom_;
     std::vector<uint8_t> ram_;
     size_t rom_bank_{1};
     size_t ram_bank_{0};
@@ -0,0 +1,53 @@
+#include "core/scheduler.hpp"
+
+#include <algorithm>
+#include <functional>
+
+namespace gb
+{
+Scheduler::Scheduler()
+{
+    deadlines_.fill(kNever);
+    for (uint8_t type = 0; type < std::to_underlying(EventType::Count); ++type)
+    {
+        Schedule(static_cast<EventType>(type), 0);
+    }
+}
+
+void Scheduler::Schedule(EventType type, uint64_t deadline)
+{
+    uint64_t& current = deadlines_[std::to_underlying(type)];
+    if (current == deadline) { return; }
+
+    current = deadline;
+    if (deadline != kNever)
+    {
+        heap_.push_back({.deadline = deadline, .type = type});
+        std::ranges::push_heap(heap_, std::greater{}, &Entry::deadline);
+    }
+    DropStaleEntries();
+}
+
+std::optional<EventType> Scheduler::PopDueEvent()
+{
+    if (!HasDueEvent()) { return std::nullopt; }
+
+    const EventType type = heap_.front().type;
+    deadlines_[std::to_underlying(type)] = kNever;
+    PopHeap();
+    DropStaleEntries();
+    return type;
+}
+
+void Scheduler::PopHeap()
+{
+    std::ranges::pop_heap(heap_, std::greater{}, &Entry::deadline);
+    heap_.pop_back();
+}
+
+void Scheduler::DropStaleEntries()
+{
+    while (!heap_.empty() && IsStale(heap_.front())) { PopHeap(); }
+    next_deadline_ = heap_.empty() ? kNever : heap_.front().deadline;
+}
+}  // namespace gb
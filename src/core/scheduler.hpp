@@ -0,0 +1,67 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace gb
+{
+// Components with state that changes on its own as emulated time passes.
+enum class EventType : uint8_t
+{
+    Timer,
+    Ppu,
+    OamDma,
+
+    Count
+};
+
+// The emulated clock, in T-cycles since power-on, and the deadline of every component, i.e. the
+// next time it has to run to change state visibly. Components are only ticked when their deadline
+// has passed or when the CPU accesses them, so advancing the clock is an addition and a compare.
+//
+// Deadlines are kept in a min-heap. Rescheduling an event leaves its previous entry in the heap,
+// where it's recognised as stale and dropped once it reaches the top.
+class Scheduler
+{
+public:
+    static constexpr uint64_t kNever = std::numeric_limits<uint64_t>::max();
+
+    // Every event starts out due, so that components compute their first deadline on the first
+    // tick.
+    Scheduler();
+
+    [[nodiscard]] uint64_t GetTimestamp() const { return timestamp_; }
+    void Advance(uint32_t tcycles) { timestamp_ += tcycles; }
+
+    [[nodiscard]] uint64_t GetNextDeadline() const { return next_deadline_; }
+    [[nodiscard]] bool HasDueEvent() const { return timestamp_ >= next_deadline_; }
+
+    // Replaces the deadline of the event, kNever cancels it.
+    void Schedule(EventType type, uint64_t deadline);
+    // Removes the earliest event whose deadline has passed.
+    std::optional<EventType> PopDueEvent();
+
+private:
+    struct Entry
+    {
+        uint64_t deadline;
+        EventType type;
+    };
+
+    [[nodiscard]] bool IsStale(const Entry& entry) const
+    {
+        return entry.deadline != deadlines_[std::to_underlying(entry.type)];
+    }
+    void PopHeap();
+    void DropStaleEntries();
+
+    uint64_t timestamp_{};
+    uint64_t next_deadline_{kNever};
+    std::vector<Entry> heap_;
+    std::array<uint64_t, std::to_underlying(EventType::Count)> deadlines_{};
+};
+}  // namespace gb
@@ -1,19 +1,45 @@
 #include "core/sm83/cpu.hpp"
 
+#include <algorithm>
+#include <array>
+#include <type_traits>
+
+#include "core/constants.hpp"
+#include "core/sm83/cpu_execute.hpp"
+#include "core/sm83/opcode_info.hpp"
+
 namespace gb::sm83
 {
 uint8_t Cpu::Step()
 {
+    NullTracer tracer;
+    return Step(tracer);
+}
+
+template <Tracer T>
+uint8_t Cpu::Step(T& tracer)
+{
+    [[maybe_unused]] constexpr bool kTraced = !std::is_same_v<T, NullTracer>;
+
     cycles_ = 0;
 
+    [[maybe_unused]] const uint16_t sp = sp_;
     HandleInterrupts();
+    // Dispatching an interrupt is the only way for HandleInterrupts() to change SP.
+    if constexpr (requires { tracer.OnInterrupt(*this); })
+    {
+        if (sp_ != sp) { tracer.OnInterrupt(*this); }
+    }
 
     if (halt_) [[unlikely]] { return 4; }
 
-#ifndef NDEBUG
-    LogForGameBoyDoctor();
-#endif
+    tracer.OnInstruction(*this);
+#ifdef GBCXX_DECODE_CACHE
+    // Traced runs fetch every instruction from the bus, so that they can serve as a reference.
+    if (kTraced || !TryExecuteCachedInstruction()) { InterpretInstruction(); }
+#else
     InterpretInstruction();
+#endif
 
     ime_ |= ime_next_;
     ime_next_ = false;
@@ -21,43 +47,343 @@ uint8_t Cpu::Step()
     return cycles_;
 }
 
-void Cpu::Tick4() { cycles_ += 4; }
+uint32_t Cpu::Run(uint32_t cycle_budget)
+{
+    NullTracer tracer;
+    return Run(cycle_budget, tracer);
+}
+
+template <Tracer T>
+uint32_t Cpu::Run(uint32_t cycle_budget, T& tracer)
+{
+    constexpr bool kTraced = !std::is_same_v<T, NullTracer>;
+
+    run_cycles_ = 0;
+    run_budget_ = cycle_budget;
+#ifdef GBCXX_IDLE_LOOP_SKIP
+    idle_loop_.armed = false;
+#endif
 
-#ifndef NDEBUG
-// void Cpu::LogForGameBoyDoctor()
-// {
-//     log_file_ << fmt::format(
-//         "A:{:02X} F:{:02X} B:{:02X} C:{:02X} D:{:02X} E:{:02X} "
-//         "H:{:02X} L:{:02X} SP:{:04X} PC:{:04X} "
-//         "PCMEM:{:02X},{:02X},{:02X},{:02X}\n",
-//         a_, GetReg(R8::F), b_, c_, d_, e_, h_, l_, sp_, pc_,
-//         bus_.ReadByte(pc_), bus_.ReadByte(pc_ + 1), bus_.ReadByte(pc_ + 2),
-//         bus_.ReadByte(pc_ + 3));
-// }
-
-void Cpu::LogForGameBoyDoctor()
-{
-    log_file_ << fmt::format(
-        "A: {:02X} F: {:02X} B: {:02X} C: {:02X} D: {:02X} E: {:02X} "
-        "H: {:02X} L: {:02X} SP: {:04X} PC: 00:{:04X} ({:02X} {:02X} {:02X} "
-        "{:02X})\n",
-        a_, GetReg(R8::F), b_, c_, d_, e_, h_, l_, sp_, pc_, bus_.ReadByte(pc_),
-        bus_.ReadByte(pc_ + 1), bus_.ReadByte(pc_ + 2), bus_.ReadByte(pc_ + 3));
+    do
+    {
+        if (halt_ && !bus_.GetPendingInterrupts()) [[unlikely]]
+        {
+            const uint16_t tcycles = GetHaltCycles();
+            bus_.Tick(tcycles);
+            run_cycles_ += tcycles;
+            continue;
+        }
+        if constexpr (!kTraced)
+        {
+            if (TryRunPrecompiled()) { continue; }
+        }
+        [[maybe_unused]] uint16_t pc = pc_;
+#ifdef GBCXX_JIT
+        // A block jumping back to its start may still be an idle or fused loop.
+        if (kTraced || !TryRunCompiled())
+#endif
+        {
+#ifdef GBCXX_CPU_DISPATCH_GOTO
+            if (!kTraced && !halt_ && !halt_bug_ && !(ime_ && bus_.GetPendingInterrupts()))
+            {
+                pc = RunThreaded();
+            }
+            else
+#endif
+            {
+                const uint8_t tcycles = Step(tracer);
+                bus_.Tick(tcycles);
+                run_cycles_ += tcycles;
+            }
+        }
+#if defined(GBCXX_IDLE_LOOP_SKIP) || defined(GBCXX_SUPERINSTRUCTIONS)
+        if (!kTraced && pc_ <= pc && !halt_) [[unlikely]]
+        {
+#ifdef GBCXX_SUPERINSTRUCTIONS
+            if (TryRunFusedLoop()) { continue; }
+#endif
+#ifdef GBCXX_IDLE_LOOP_SKIP
+            TrySkipIdleLoop();
+#endif
+        }
+#endif
+    } while (run_cycles_ < run_budget_ && !bus_.ppu.ShouldDrawFrame());
+
+    return run_cycles_;
+}
+
+template uint8_t Cpu::Step(NullTracer&);
+template uint8_t Cpu::Step(DoctorTracer&);
+template uint32_t Cpu::Run(uint32_t, NullTracer&);
+template uint32_t Cpu::Run(uint32_t, DoctorTracer&);
+template uint8_t Cpu::Step(RingTracer&);
+template uint32_t Cpu::Run(uint32_t, RingTracer&);
+template uint8_t Cpu::Step(Profiler&);
+template uint32_t Cpu::Run(uint32_t, Profiler&);
+
+uint16_t Cpu::GetHaltCycles() const
+{
+    // Only an interrupt requested by the timer or the PPU can end HALT, and neither requests one
+    // between its events. Ticking the bus to the next event at once is equivalent to
+    // stepping 4 cycles at a time, as long as the chunk is rounded up to the same 4-cycle boundary.
+    const uint32_t budget = run_cycles_ < run_budget_ ? run_budget_ - run_cycles_ : 0;
+    const uint32_t cycles =
+        std::min({bus_.CyclesUntilNextEvent(), budget, uint32_t{kMaxHaltCycles}});
+    return static_cast<uint16_t>(std::max((cycles + 3) & ~3U, 4U));
+}
+
+#ifdef GBCXX_IDLE_LOOP_SKIP
+Cpu::IdleLoopState Cpu::GetIdleLoopState() const
+{
+    return {
+        .regs = regs_,
+        .a = a_,
+        .f = flags_.Get(),
+        .sp = sp_,
+        .ime = ime_,
+        .ime_next = ime_next_,
+        .halt_bug = halt_bug_,
+    };
+}
+
+void Cpu::TrySkipIdleLoop()
+{
+    // If an iteration started and ended in the same state, didn't write memory and saw no PPU or
+    // timer state change, every following iteration reads the same values and does the same thing
+    // until the next one. Those iterations are skipped by ticking the bus for their combined
+    // length. DIV and TIMA change between events, so loops reading them are never skipped, and
+    // neither are loops during OAM DMA, which may read the byte being transferred.
+    const IdleLoopState state = GetIdleLoopState();
+    if (idle_loop_.armed && idle_loop_.start == pc_ && idle_loop_.state == state &&
+        idle_loop_.writes == write_count_ && !idle_loop_.reads_timer && !bus_.oam_dma.active)
+    {
+        const uint32_t length = run_cycles_ - idle_loop_.cycles;
+        if (length > 0 && length < idle_loop_.until_event)
+        {
+            const uint32_t until_event = idle_loop_.until_event - length;
+            const uint32_t budget = run_cycles_ < run_budget_ ? run_budget_ - run_cycles_ : 0;
+            const uint32_t skipped = std::min((until_event - 1) / length, budget / length) * length;
+            TickBus(skipped);
+            run_cycles_ += skipped;
+            idle_cycles_skipped_ += skipped;
+        }
+    }
+
+    idle_loop_ = {
+        .armed = true,
+        .start = pc_,
+        .state = state,
+        .cycles = run_cycles_,
+        .until_event = bus_.CyclesUntilStateChange(),
+        .writes = write_count_,
+        .reads_timer = false,
+    };
 }
 #endif
 
+#ifdef GBCXX_SUPERINSTRUCTIONS
+uint32_t Cpu::GetFusedCycleLimit()
+{
+    // Like TrySkipIdleLoop(), fused loops stop short of the next state change, so the PPU and timer
+    // don't change state while they run and the bus can be ticked for all of their cycles at once.
+    // Stopping within the budget leaves Run() exactly where the interpreter would have.
+    const uint32_t until_event = bus_.CyclesUntilStateChange();
+    const uint32_t budget = run_cycles_ < run_budget_ ? run_budget_ - run_cycles_ : 0;
+    return std::min(until_event > 0 ? until_event - 1 : 0, budget);
+}
+
+bool Cpu::TryRunFusedLoop()
+{
+    // Recognises a few loops games spend much of their time in, at the target of the backward jump
+    // closing them, and runs as many iterations as fit before the next event in one handler.
+    // Nothing else may happen between their instructions, i.e. no interrupt can be dispatched and
+    // no EI or HALT bug be pending. Run() returns before the next instruction once the PPU has a
+    // frame ready.
+    using enum R8;
+    if (halt_bug_ || ime_next_ || (ime_ && bus_.GetPendingInterrupts()) ||
+        bus_.ppu.ShouldDrawFrame())
+    {
+        return false;
+    }
+
+    const auto read = [this](int offset)
+    { return bus_.ReadByte(static_cast<uint16_t>(pc_ + offset)); };
+    const uint8_t opcode = read(0);
+    uint32_t tcycles = 0;
+    switch (opcode)
+    {
+    // LD A,(HL+); LD (DE),A; INC DE; DEC BC; LD A,B; OR C; JR NZ,-8
+    case 0x2a:
+        if (read(1) == 0x12 && read(2) == 0x13 && read(3) == 0x0b && read(4) == 0x78 &&
+            read(5) == 0xb1 && read(6) == 0x20 && read(7) == 0xf8)
+        {
+            tcycles = RunFusedCopyLoop(GetFusedCycleLimit());
+        }
+        break;
+    // LDH A,(n); CP m; JR NZ,-6
+    case 0xf0:
+        if (read(2) == 0xfe && read(4) == 0x20 && read(5) == 0xfa)
+        {
+            tcycles = RunFusedPollLoop(GetFusedCycleLimit());
+        }
+        break;
+    // DEC r; JR NZ,-3
+    case 0x05:
+    case 0x0d:
+    case 0x15:
+    case 0x1d:
+    case 0x25:
+    case 0x2d:
+    case 0x3d:
+        if (read(1) == 0x20 && read(2) == 0xfd)
+        {
+            const uint32_t limit = GetFusedCycleLimit();
+            switch (opcode)
+            {
+            case 0x05: tcycles = RunFusedDecLoop<B>(limit); break;
+            case 0x0d: tcycles = RunFusedDecLoop<C>(limit); break;
+            case 0x15: tcycles = RunFusedDecLoop<D>(limit); break;
+            case 0x1d: tcycles = RunFusedDecLoop<E>(limit); break;
+            case 0x25: tcycles = RunFusedDecLoop<H>(limit); break;
+            case 0x2d: tcycles = RunFusedDecLoop<L>(limit); break;
+            default: tcycles = RunFusedDecLoop<A>(limit); break;
+            }
+        }
+        break;
+    default: break;
+    }
+    if (tcycles == 0) { return false; }
+
+    TickBus(tcycles);
+    run_cycles_ += tcycles;
+    fused_cycles_ += tcycles;
+#ifdef GBCXX_IDLE_LOOP_SKIP
+    // The iteration being observed now spans the fused cycles.
+    idle_loop_.armed = false;
+#endif
+    return true;
+}
+
+uint32_t Cpu::RunFusedCopyLoop(uint32_t limit)
+{
+    // 44 cycles per iteration as timed by the interpreter, where INC rr and DEC rr take 4, and 4
+    // less for the last one as JR NZ falls through.
+    constexpr uint32_t kIterationCycles = 44;
+    const uint16_t bc = GetReg<R16::Bc>();
+    const uint32_t remaining = bc != 0 ? bc : 0x10000;
+    const uint32_t full_cycles = (remaining * kIterationCycles) - 4;
+    const uint32_t count =
+        full_cycles <= limit ? remaining : std::min(remaining - 1, limit / kIterationCycles);
+    if (count == 0) { return 0; }
+
+    // During OAM DMA, reads from the bus it uses see the byte being transferred.
+    if (bus_.oam_dma.active) { return 0; }
+
+    // Only plain memory is copied in bulk: no I/O registers, MBC registers or cartridge RAM, and no
+    // writes to the loop itself. The copy still goes byte by byte, so overlapping regions behave
+    // as they would in the loop, and through WriteByte(), which keeps the decode cache coherent.
+    const uint16_t src = GetReg<R16::Hl>();
+    const uint16_t dst = GetReg<R16::De>();
+    const auto in_region = [count](uint16_t addr, uint16_t start, uint16_t end)
+    { return addr >= start && addr + count - 1 <= end; };
+    const bool src_plain = in_region(src, kCartridgeStart, kVramEnd) ||
+                           in_region(src, kWorkRamStart, kOamEnd) ||
+                           in_region(src, kHighRamStart, kHighRamEnd);
+    const bool dst_plain = in_region(dst, kVramStart, kVramEnd) ||
+                           in_region(dst, kWorkRamStart, kWorkRamEnd) ||
+                           in_region(dst, kOamStart, kOamEnd) ||
+                           in_region(dst, kHighRamStart, kHighRamEnd);
+    const bool in_echo_ram = pc_ >= kEchoRamStart && pc_ <= kEchoRamEnd;
+    const bool overwrites_loop = in_echo_ram || (dst < pc_ + 8 && pc_ < dst + count);
+    if (!src_plain || !dst_plain || overwrites_loop) { return 0; }
+
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        WriteByte(static_cast<uint16_t>(dst + i), bus_.ReadByte(static_cast<uint16_t>(src + i)));
+    }
+    SetReg<R16::Hl>(static_cast<uint16_t>(src + count));
+    SetReg<R16::De>(static_cast<uint16_t>(dst + count));
+    SetReg<R16::Bc>(static_cast<uint16_t>(bc - count));
+
+    // LD A,B; OR C
+    const uint16_t new_bc = GetReg<R16::Bc>();
+    a_ = static_cast<uint8_t>((new_bc >> 8) | (new_bc & 0xff));
+    flags_.Set(!a_, false, false, false);
+    if (count == remaining)
+    {
+        pc_ += 8;
+        return full_cycles;
+    }
+    return count * kIterationCycles;
+}
+
+uint32_t Cpu::RunFusedPollLoop(uint32_t limit)
+{
+    // 32 cycles per iteration. The register read doesn't change before the next event, unless it's
+    // DIV or TIMA, so the loop either exits in the first iteration, which is left to the
+    // interpreter, or spins until the event.
+    constexpr uint32_t kIterationCycles = 32;
+    const auto addr = static_cast<uint16_t>(0xff00 + bus_.ReadByte(static_cast<uint16_t>(pc_ + 1)));
+    const uint8_t expected = bus_.ReadByte(static_cast<uint16_t>(pc_ + 3));
+    if (addr == kRegDiv || addr == kRegTima) { return 0; }
+
+    const uint8_t val = bus_.ReadByte(addr);
+    const uint32_t count = limit / kIterationCycles;
+    if (val == expected || count == 0) { return 0; }
+
+    a_ = val;
+    flags_.Sub(val, expected);
+    return count * kIterationCycles;
+}
+
+template <R8 R>
+uint32_t Cpu::RunFusedDecLoop(uint32_t limit)
+{
+    // 16 cycles per iteration, 4 less for the last one as JR NZ falls through.
+    constexpr uint32_t kIterationCycles = 16;
+    const uint8_t val = GetReg<R>();
+    const uint32_t remaining = val != 0 ? val : 0x100;
+    const uint32_t full_cycles = (remaining * kIterationCycles) - 4;
+    const uint32_t count =
+        full_cycles <= limit ? remaining : std::min(remaining - 1, limit / kIterationCycles);
+    if (count == 0) { return 0; }
+
+    // Flags as left by the last DEC.
+    SetReg<R>(flags_.Dec(static_cast<uint8_t>(val - count + 1)));
+    if (count == remaining)
+    {
+        pc_ += 3;
+        return full_cycles;
+    }
+    return count * kIterationCycles;
+}
+#endif
+
+void Cpu::TickBus(uint32_t tcycles)
+{
+    for (uint32_t ticked = 0; ticked < tcycles;)
+    {
+        const auto chunk =
+            static_cast<uint16_t>(std::min<uint32_t>(tcycles - ticked, kMaxHaltCycles));
+        bus_.Tick(chunk);
+        ticked += chunk;
+    }
+}
+
+void Cpu::Tick4() { cycles_ += 4; }
+
 uint8_t Cpu::GetReg(R8 r) const
 {
     switch (r)
     {
-    case R8::B: return b_;
-    case R8::C: return c_;
-    case R8::D: return d_;
-    case R8::E: return e_;
-    case R8::H: return h_;
-    case R8::L: return l_;
-    case R8::A: return a_;
-    case R8::F: return static_cast<uint8_t>((zf_ << 7) | (nf_ << 6) | (hf_ << 5) | (cf_ << 4));
+    case R8::B: return GetReg<R8::B>();
+    case R8::C: return GetReg<R8::C>();
+    case R8::D: return GetReg<R8::D>();
+    case R8::E: return GetReg<R8::E>();
+    case R8::H: return GetReg<R8::H>();
+    case R8::L: return GetReg<R8::L>();
+    case R8::A: return GetReg<R8::A>();
+    case R8::F: return GetReg<R8::F>();
     }
 }
 
@@ -65,12 +391,12 @@ uint16_t Cpu::GetReg(R16 r) const
 {
     switch (r)
     {
-    case R16::Af: return static_cast<uint16_t>(GetReg(R8::A) << 8) | GetReg(R8::F);
-    case R16::Bc: return static_cast<uint16_t>(GetReg(R8::B) << 8) | GetReg(R8::C);
-    case R16::De: return static_cast<uint16_t>(GetReg(R8::D) << 8) | GetReg(R8::E);
-    case R16::Hl: return static_cast<uint16_t>(GetReg(R8::H) << 8) | GetReg(R8::L);
-    case R16::Sp: return sp_;
-    case R16::Pc: return pc_;
+    case R16::Af: return GetReg<R16::Af>();
+    case R16::Bc: return GetReg<R16::Bc>();
+    case R16::De: return GetReg<R16::De>();
+    case R16::Hl: return GetReg<R16::Hl>();
+    case R16::Sp: return GetReg<R16::Sp>();
+    case R16::Pc: return GetReg<R16::Pc>();
     }
 }
 
@@ -78,19 +404,14 @@ void Cpu::SetReg(R8 r, uint8_t v)
 {
     switch (r)
     {
-    case R8::B: b_ = v; break;
-    case R8::C: c_ = v; break;
-    case R8::D: d_ = v; break;
-    case R8::E: e_ = v; break;
-    case R8::H: h_ = v; break;
-    case R8::L: l_ = v; break;
-    case R8::A: a_ = v; break;
-    case R8::F:
-        zf_ = GetBit<7>(v);
-        nf_ = GetBit<6>(v);
-        hf_ = GetBit<5>(v);
-        cf_ = GetBit<4>(v);
-        break;
+    case R8::B: SetReg<R8::B>(v); break;
+    case R8::C: SetReg<R8::C>(v); break;
+    case R8::D: SetReg<R8::D>(v); break;
+    case R8::E: SetReg<R8::E>(v); break;
+    case R8::H: SetReg<R8::H>(v); break;
+    case R8::L: SetReg<R8::L>(v); break;
+    case R8::A: SetReg<R8::A>(v); break;
+    case R8::F: SetReg<R8::F>(v); break;
     }
 }
 
@@ -98,28 +419,25 @@ void Cpu::SetReg(R16 r, uint16_t v)
 {
     switch (r)
     {
-    case R16::Af:
-        SetReg(R8::A, v >> 8);
-        SetReg(R8::F, v & 0xf0);
-        break;
-    case R16::Bc:
-        SetReg(R8::B, v >> 8);
-        SetReg(R8::C, v & 0xff);
-        break;
-    case R16::De:
-        SetReg(R8::D, v >> 8);
-        SetReg(R8::E, v & 0xff);
-        break;
-    case R16::Hl:
-        SetReg(R8::H, v >> 8);
-        SetReg(R8::L, v & 0xff);
-        break;
-    case R16::Sp: sp_ = v; break;
-    case R16::Pc: pc_ = v; break;
+    case R16::Af: SetReg<R16::Af>(v); break;
+    case R16::Bc: SetReg<R16::Bc>(v); break;
+    case R16::De: SetReg<R16::De>(v); break;
+    case R16::Hl: SetReg<R16::Hl>(v); break;
+    case R16::Sp: SetReg<R16::Sp>(v); break;
+    case R16::Pc: SetReg<R16::Pc>(v); break;
     }
 }
 
-uint8_t Cpu::ReadOperand() { return ReadByte(pc_++); }
+uint8_t Cpu::ReadOperand()
+{
+    if (prefetched_operands_ != nullptr)
+    {
+        Tick4();
+        ++pc_;
+        return *prefetched_operands_++;
+    }
+    return ReadByte(pc_++);
+}
 
 uint16_t Cpu::ReadOperands()
 {
@@ -131,6 +449,14 @@ uint16_t Cpu::ReadOperands()
 uint8_t Cpu::ReadByte(uint16_t addr)
 {
     Tick4();
+    return LoadByte(addr);
+}
+
+uint8_t Cpu::LoadByte(uint16_t addr)
+{
+#ifdef GBCXX_IDLE_LOOP_SKIP
+    idle_loop_.reads_timer |= addr == kRegDiv || addr == kRegTima;
+#endif
     return bus_.ReadByte(addr);
 }
 
@@ -144,7 +470,24 @@ uint16_t Cpu::ReadWord(uint16_t addr)
 void Cpu::WriteByte(uint16_t addr, uint8_t val)
 {
     Tick4();
+    StoreByte(addr, val);
+}
+
+void Cpu::StoreByte(uint16_t addr, uint8_t val)
+{
+#ifdef GBCXX_IDLE_LOOP_SKIP
+    ++write_count_;
+#endif
     bus_.WriteByte(addr, val);
+#ifdef GBCXX_DECODE_CACHE
+    decode_cache_.OnWrite(addr);
+#endif
+#ifdef GBCXX_JIT
+    if (jit_.OnWrite(addr)) [[unlikely]] { leave_compiled_code_ = true; }
+#endif
+
+    // MBC register writes may remap the code being executed.
+    if (addr <= kCartridgeEnd) { leave_compiled_code_ = true; }
 }
 
 void Cpu::WriteWord(uint16_t addr, uint16_t val)
@@ -197,21 +540,241 @@ bool Cpu::EvaluateCondition(Condition cond) const
 {
     switch (cond)
     {
-    case Condition::NotZero: return !zf_;
-    case Condition::Zero: return zf_;
-    case Condition::NotCarry: return !cf_;
-    case Condition::Carry: return cf_;
+    case Condition::NotZero: return !flags_.Z();
+    case Condition::Zero: return flags_.Z();
+    case Condition::NotCarry: return !flags_.C();
+    case Condition::Carry: return flags_.C();
+    }
+}
+
+bool Cpu::CanEnterCompiledCode() const
+{
+    // Compiled code would run the ROM bytes hidden by the byte an OAM DMA is transferring.
+    return !halt_ && !halt_bug_ && !(ime_ && bus_.GetPendingInterrupts()) && !bus_.oam_dma.active;
+}
+
+void Cpu::LoadPrecompiledCode()
+{
+#ifdef GBCXX_TESTS
+    // The flat test bus has no cartridge header.
+    if (bus_.flat_memory) { return; }
+#endif
+    const auto global_checksum =
+        static_cast<uint16_t>((bus_.ReadByte(kGlobalChecksumAddress) << 8) |
+                              bus_.ReadByte(kGlobalChecksumAddress + 1));
+    const PrecompiledRom* rom =
+        FindPrecompiledRom(bus_.ReadByte(kHeaderChecksumAddress), global_checksum);
+    if (rom == nullptr) { return; }
+
+    LOG_INFO("CPU: Using {} precompiled entry points for {}", rom->entries.size(), rom->title);
+    for (const PrecompiledEntry& entry : rom->entries)
+    {
+        precompiled_entries_.emplace((static_cast<uint32_t>(entry.bank) << 16) | entry.pc, &entry);
+    }
+}
+
+bool Cpu::TryRunPrecompiled()
+{
+    if (precompiled_entries_.empty() || pc_ > kCartridgeEnd || !CanEnterCompiledCode())
+    {
+        return false;
     }
+
+    const auto key = static_cast<uint32_t>((bus_.cartridge.GetRomBank(pc_) << 16) | pc_);
+    const auto it = precompiled_entries_.find(key);
+    if (it == precompiled_entries_.end()) { return false; }
+
+    leave_compiled_code_ = false;
+    const uint32_t run_cycles = run_cycles_;
+    it->second->block(*this, it->second->index);
+    precompiled_cycles_ += run_cycles_ - run_cycles;
+    return true;
+}
+
+#ifdef GBCXX_JIT
+bool Cpu::TryRunCompiled()
+{
+    if (!CanEnterCompiledCode() || bus_.ppu.ShouldDrawFrame()) { return false; }
+    const Jit::Block block = jit_.Lookup(*this, pc_);
+    if (block == nullptr) { return false; }
+
+    leave_compiled_code_ = false;
+    const uint32_t run_cycles = run_cycles_;
+    block(this);
+    jit_cycles_ += run_cycles_ - run_cycles;
+    return true;
+}
+#endif
+
+#ifdef GBCXX_DECODE_CACHE
+bool Cpu::TryExecuteCachedInstruction()
+{
+    if (halt_bug_) { return false; }
+    const DecodedInstruction* cached = FetchCachedInstruction();
+    if (cached == nullptr) { return false; }
+
+    // Copied, a write performed by the instruction may invalidate its block.
+    const DecodedInstruction instr = *cached;
+    Tick4();
+    ++pc_;
+
+    prefetched_operands_ = instr.operands.data();
+    ExecuteInstruction(instr.opcode);
+    prefetched_operands_ = nullptr;
+    return true;
 }
 
+const DecodedInstruction* Cpu::FetchCachedInstruction()
+{
+    // Code on the bus of an OAM DMA reads the byte being transferred, which is never decoded.
+    if (bus_.oam_dma.active && bus_.IsOnOamDmaBus(pc_)) { return nullptr; }
+    return decode_cache_.Fetch(bus_, pc_);
+}
+#endif
+
 void Cpu::InterpretInstruction()
 {
-    uint8_t opcode = ReadByte(pc_);
+    const uint8_t opcode = ReadByte(pc_);
     pc_ += !halt_bug_;
     halt_bug_ = false;
 
-    if (opcode != 0xcb) { LOG_TRACE("CPU: opcode {:X}", opcode); }
+    ExecuteInstruction(opcode);
+}
+
+#if defined(GBCXX_CPU_DISPATCH_TABLE)
+void Cpu::ExecuteInstruction(uint8_t opcode)
+{
+    using Handler = void (Cpu::*)();
+    static constexpr auto kHandlers = []<size_t... Opcodes>(std::index_sequence<Opcodes...>)
+    {
+        return std::array<Handler, 256>{&Cpu::ExecuteOpcode<Opcodes>...};
+    }(std::make_index_sequence<256>{});
+
+    (this->*kHandlers[opcode])();
+}
+
+void Cpu::InterpretCbInstruction()
+{
+    using Handler = void (Cpu::*)();
+    static constexpr auto kHandlers = []<size_t... Opcodes>(std::index_sequence<Opcodes...>)
+    {
+        return std::array<Handler, 256>{&Cpu::ExecuteCbOpcode<Opcodes>...};
+    }(std::make_index_sequence<256>{});
+
+    const uint8_t cb_opcode = ReadOperand();
+    (this->*kHandlers[cb_opcode])();
+}
+#elif defined(GBCXX_CPU_DISPATCH_GOTO)
+// Expands X(0x00) ... X(0xff) to generate one label per opcode.
+#define GBCXX_OPCODE_ROW(X, hi)                                                                  \
+    X(0x##hi##0) X(0x##hi##1) X(0x##hi##2) X(0x##hi##3) X(0x##hi##4) X(0x##hi##5) X(0x##hi##6) \
+    X(0x##hi##7) X(0x##hi##8) X(0x##hi##9) X(0x##hi##a) X(0x##hi##b) X(0x##hi##c) X(0x##hi##d) \
+    X(0x##hi##e) X(0x##hi##f)
+#define GBCXX_OPCODES(X)                                                                          \
+    GBCXX_OPCODE_ROW(X, 0) GBCXX_OPCODE_ROW(X, 1) GBCXX_OPCODE_ROW(X, 2) GBCXX_OPCODE_ROW(X, 3) \
+    GBCXX_OPCODE_ROW(X, 4) GBCXX_OPCODE_ROW(X, 5) GBCXX_OPCODE_ROW(X, 6) GBCXX_OPCODE_ROW(X, 7) \
+    GBCXX_OPCODE_ROW(X, 8) GBCXX_OPCODE_ROW(X, 9) GBCXX_OPCODE_ROW(X, a) GBCXX_OPCODE_ROW(X, b) \
+    GBCXX_OPCODE_ROW(X, c) GBCXX_OPCODE_ROW(X, d) GBCXX_OPCODE_ROW(X, e) GBCXX_OPCODE_ROW(X, f)
+
+ALWAYS_INLINE uint8_t Cpu::FetchThreadedOpcode()
+{
+#ifdef GBCXX_DECODE_CACHE
+    if (const DecodedInstruction* cached = FetchCachedInstruction())
+    {
+        threaded_instr_ = *cached;
+        Tick4();
+        ++pc_;
+        prefetched_operands_ = threaded_instr_.operands.data();
+        return threaded_instr_.opcode;
+    }
+#endif
+    return ReadByte(pc_++);
+}
+
+template <uint8_t Opcode>
+ALWAYS_INLINE bool Cpu::FinishThreadedInstruction(uint16_t pc)
+{
+    prefetched_operands_ = nullptr;
+    ime_ |= ime_next_;
+    ime_next_ = false;
+
+    bus_.Tick(cycles_);
+    run_cycles_ += cycles_;
+
+    // Run() checks for the end of the budget and frame, and for HALT and interrupts, which Step()
+    // handles. Backward branches may enter a fused or idle loop, control flow precompiled or
+    // JIT-compiled code.
+#ifdef GBCXX_JIT
+    constexpr bool kJit = true;
+#else
+    constexpr bool kJit = false;
+#endif
+    return run_cycles_ >= run_budget_ || bus_.ppu.ShouldDrawFrame() || halt_ || halt_bug_ ||
+           (ime_ && bus_.GetPendingInterrupts()) || pc_ <= pc ||
+           (kEndsBasicBlock[Opcode] && (kJit || !precompiled_entries_.empty()));
+}
+
+// Labels as values are a GNU extension.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+
+void Cpu::ExecuteInstruction(uint8_t opcode)
+{
+#define GBCXX_OPCODE_ADDRESS(op) &&op_##op,
+    static void* const kLabels[256] = {GBCXX_OPCODES(GBCXX_OPCODE_ADDRESS)};
+#undef GBCXX_OPCODE_ADDRESS
+
+    goto *kLabels[opcode];
+
+#define GBCXX_OPCODE_LABEL(op) \
+    op_##op : ExecuteOpcode<op>(); \
+    return;
+    GBCXX_OPCODES(GBCXX_OPCODE_LABEL)
+#undef GBCXX_OPCODE_LABEL
+}
+
+void Cpu::InterpretCbInstruction()
+{
+#define GBCXX_OPCODE_ADDRESS(op) &&op_##op,
+    static void* const kLabels[256] = {GBCXX_OPCODES(GBCXX_OPCODE_ADDRESS)};
+#undef GBCXX_OPCODE_ADDRESS
+
+    const uint8_t cb_opcode = ReadOperand();
+    goto *kLabels[cb_opcode];
+
+#define GBCXX_OPCODE_LABEL(op) \
+    op_##op : ExecuteCbOpcode<op>(); \
+    return;
+    GBCXX_OPCODES(GBCXX_OPCODE_LABEL)
+#undef GBCXX_OPCODE_LABEL
+}
 
+uint16_t Cpu::RunThreaded()
+{
+#define GBCXX_OPCODE_ADDRESS(op) &&op_##op,
+    static void* const kLabels[256] = {GBCXX_OPCODES(GBCXX_OPCODE_ADDRESS)};
+#undef GBCXX_OPCODE_ADDRESS
+
+    uint16_t pc = pc_;
+    cycles_ = 0;
+    goto *kLabels[FetchThreadedOpcode()];
+
+#define GBCXX_OPCODE_LABEL(op)                                     \
+    op_##op : ExecuteOpcode<op>();                                 \
+    if (FinishThreadedInstruction<op>(pc)) { return pc; }          \
+    pc = pc_;                                                      \
+    cycles_ = 0;                                                   \
+    goto *kLabels[FetchThreadedOpcode()];
+    GBCXX_OPCODES(GBCXX_OPCODE_LABEL)
+#undef GBCXX_OPCODE_LABEL
+}
+
+#pragma GCC diagnostic pop
+#undef GBCXX_OPCODES
+#undef GBCXX_OPCODE_ROW
+#else
+void Cpu::ExecuteInstruction(uint8_t opcode)
+{
     switch (opcode)
     {
     // 8-bit loads
@@ -486,284 +1049,286 @@ void Cpu::InterpretInstruction()
     case 0xfd: return;
 
     // CB prefixed
-    case 0xcb:
-    {
-        const uint8_t cb_opcode = ReadOperand();
-        LOG_TRACE("CPU: opcode CB{:X}", cb_opcode);
-        switch (cb_opcode)
-        {
-        case 0x07: Instr_RLC_R<R8::A>(); break;
-        case 0x00: Instr_RLC_R<R8::B>(); break;
-        case 0x01: Instr_RLC_R<R8::C>(); break;
-        case 0x02: Instr_RLC_R<R8::D>(); break;
-        case 0x03: Instr_RLC_R<R8::E>(); break;
-        case 0x04: Instr_RLC_R<R8::H>(); break;
-        case 0x05: Instr_RLC_R<R8::L>(); break;
-        case 0x06: Instr_RLC_MEM_HL(); break;
-
-        case 0x0f: Instr_RRC_R<R8::A>(); break;
-        case 0x08: Instr_RRC_R<R8::B>(); break;
-        case 0x09: Instr_RRC_R<R8::C>(); break;
-        case 0x0a: Instr_RRC_R<R8::D>(); break;
-        case 0x0b: Instr_RRC_R<R8::E>(); break;
-        case 0x0c: Instr_RRC_R<R8::H>(); break;
-        case 0x0d: Instr_RRC_R<R8::L>(); break;
-        case 0x0e: Instr_RRC_MEM_HL(); break;
-
-        case 0x17: Instr_RL_R<R8::A>(); break;
-        case 0x10: Instr_RL_R<R8::B>(); break;
-        case 0x11: Instr_RL_R<R8::C>(); break;
-        case 0x12: Instr_RL_R<R8::D>(); break;
-        case 0x13: Instr_RL_R<R8::E>(); break;
-        case 0x14: Instr_RL_R<R8::H>(); break;
-        case 0x15: Instr_RL_R<R8::L>(); break;
-        case 0x16: Instr_RL_MEM_HL(); break;
-
-        case 0x1f: Instr_RR_R<R8::A>(); break;
-        case 0x18: Instr_RR_R<R8::B>(); break;
-        case 0x19: Instr_RR_R<R8::C>(); break;
-        case 0x1a: Instr_RR_R<R8::D>(); break;
-        case 0x1b: Instr_RR_R<R8::E>(); break;
-        case 0x1c: Instr_RR_R<R8::H>(); break;
-        case 0x1d: Instr_RR_R<R8::L>(); break;
-        case 0x1e: Instr_RR_MEM_HL(); break;
-
-        case 0x27: Instr_SLA_R<R8::A>(); break;
-        case 0x20: Instr_SLA_R<R8::B>(); break;
-        case 0x21: Instr_SLA_R<R8::C>(); break;
-        case 0x22: Instr_SLA_R<R8::D>(); break;
-        case 0x23: Instr_SLA_R<R8::E>(); break;
-        case 0x24: Instr_SLA_R<R8::H>(); break;
-        case 0x25: Instr_SLA_R<R8::L>(); break;
-        case 0x26: Instr_SLA_MEM_HL(); break;
-
-        case 0x2f: Instr_SRA_R<R8::A>(); break;
-        case 0x28: Instr_SRA_R<R8::B>(); break;
-        case 0x29: Instr_SRA_R<R8::C>(); break;
-        case 0x2a: Instr_SRA_R<R8::D>(); break;
-        case 0x2b: Instr_SRA_R<R8::E>(); break;
-        case 0x2c: Instr_SRA_R<R8::H>(); break;
-        case 0x2d: Instr_SRA_R<R8::L>(); break;
-        case 0x2e: Instr_SRA_MEM_HL(); break;
-
-        case 0x37: Instr_SWAP_R<R8::A>(); break;
-        case 0x30: Instr_SWAP_R<R8::B>(); break;
-        case 0x31: Instr_SWAP_R<R8::C>(); break;
-        case 0x32: Instr_SWAP_R<R8::D>(); break;
-        case 0x33: Instr_SWAP_R<R8::E>(); break;
-        case 0x34: Instr_SWAP_R<R8::H>(); break;
-        case 0x35: Instr_SWAP_R<R8::L>(); break;
-        case 0x36: Instr_SWAP_MEM_HL(); break;
-
-        case 0x3f: Instr_SRL_R<R8::A>(); break;
-        case 0x38: Instr_SRL_R<R8::B>(); break;
-        case 0x39: Instr_SRL_R<R8::C>(); break;
-        case 0x3a: Instr_SRL_R<R8::D>(); break;
-        case 0x3b: Instr_SRL_R<R8::E>(); break;
-        case 0x3c: Instr_SRL_R<R8::H>(); break;
-        case 0x3d: Instr_SRL_R<R8::L>(); break;
-        case 0x3e: Instr_SRL_MEM_HL(); break;
-
-        case 0x47: Instr_BIT_B_R<0, R8::A>(); break;
-        case 0x4f: Instr_BIT_B_R<1, R8::A>(); break;
-        case 0x57: Instr_BIT_B_R<2, R8::A>(); break;
-        case 0x5f: Instr_BIT_B_R<3, R8::A>(); break;
-        case 0x67: Instr_BIT_B_R<4, R8::A>(); break;
-        case 0x6f: Instr_BIT_B_R<5, R8::A>(); break;
-        case 0x77: Instr_BIT_B_R<6, R8::A>(); break;
-        case 0x7f: Instr_BIT_B_R<7, R8::A>(); break;
-        case 0x40: Instr_BIT_B_R<0, R8::B>(); break;
-        case 0x48: Instr_BIT_B_R<1, R8::B>(); break;
-        case 0x50: Instr_BIT_B_R<2, R8::B>(); break;
-        case 0x58: Instr_BIT_B_R<3, R8::B>(); break;
-        case 0x60: Instr_BIT_B_R<4, R8::B>(); break;
-        case 0x68: Instr_BIT_B_R<5, R8::B>(); break;
-        case 0x70: Instr_BIT_B_R<6, R8::B>(); break;
-        case 0x78: Instr_BIT_B_R<7, R8::B>(); break;
-        case 0x41: Instr_BIT_B_R<0, R8::C>(); break;
-        case 0x49: Instr_BIT_B_R<1, R8::C>(); break;
-        case 0x51: Instr_BIT_B_R<2, R8::C>(); break;
-        case 0x59: Instr_BIT_B_R<3, R8::C>(); break;
-        case 0x61: Instr_BIT_B_R<4, R8::C>(); break;
-        case 0x69: Instr_BIT_B_R<5, R8::C>(); break;
-        case 0x71: Instr_BIT_B_R<6, R8::C>(); break;
-        case 0x79: Instr_BIT_B_R<7, R8::C>(); break;
-        case 0x42: Instr_BIT_B_R<0, R8::D>(); break;
-        case 0x4a: Instr_BIT_B_R<1, R8::D>(); break;
-        case 0x52: Instr_BIT_B_R<2, R8::D>(); break;
-        case 0x5a: Instr_BIT_B_R<3, R8::D>(); break;
-        case 0x62: Instr_BIT_B_R<4, R8::D>(); break;
-        case 0x6a: Instr_BIT_B_R<5, R8::D>(); break;
-        case 0x72: Instr_BIT_B_R<6, R8::D>(); break;
-        case 0x7a: Instr_BIT_B_R<7, R8::D>(); break;
-        case 0x43: Instr_BIT_B_R<0, R8::E>(); break;
-        case 0x4b: Instr_BIT_B_R<1, R8::E>(); break;
-        case 0x53: Instr_BIT_B_R<2, R8::E>(); break;
-        case 0x5b: Instr_BIT_B_R<3, R8::E>(); break;
-        case 0x63: Instr_BIT_B_R<4, R8::E>(); break;
-        case 0x6b: Instr_BIT_B_R<5, R8::E>(); break;
-        case 0x73: Instr_BIT_B_R<6, R8::E>(); break;
-        case 0x7b: Instr_BIT_B_R<7, R8::E>(); break;
-        case 0x44: Instr_BIT_B_R<0, R8::H>(); break;
-        case 0x4c: Instr_BIT_B_R<1, R8::H>(); break;
-        case 0x54: Instr_BIT_B_R<2, R8::H>(); break;
-        case 0x5c: Instr_BIT_B_R<3, R8::H>(); break;
-        case 0x64: Instr_BIT_B_R<4, R8::H>(); break;
-        case 0x6c: Instr_BIT_B_R<5, R8::H>(); break;
-        case 0x74: Instr_BIT_B_R<6, R8::H>(); break;
-        case 0x7c: Instr_BIT_B_R<7, R8::H>(); break;
-        case 0x45: Instr_BIT_B_R<0, R8::L>(); break;
-        case 0x4d: Instr_BIT_B_R<1, R8::L>(); break;
-        case 0x55: Instr_BIT_B_R<2, R8::L>(); break;
-        case 0x5d: Instr_BIT_B_R<3, R8::L>(); break;
-        case 0x65: Instr_BIT_B_R<4, R8::L>(); break;
-        case 0x6d: Instr_BIT_B_R<5, R8::L>(); break;
-        case 0x75: Instr_BIT_B_R<6, R8::L>(); break;
-        case 0x7d: Instr_BIT_B_R<7, R8::L>(); break;
-        case 0x46: Instr_BIT_B_MEM_HL<0>(); break;
-        case 0x4e: Instr_BIT_B_MEM_HL<1>(); break;
-        case 0x56: Instr_BIT_B_MEM_HL<2>(); break;
-        case 0x5e: Instr_BIT_B_MEM_HL<3>(); break;
-        case 0x66: Instr_BIT_B_MEM_HL<4>(); break;
-        case 0x6e: Instr_BIT_B_MEM_HL<5>(); break;
-        case 0x76: Instr_BIT_B_MEM_HL<6>(); break;
-        case 0x7e: Instr_BIT_B_MEM_HL<7>(); break;
-
-        case 0x87: Instr_RES_B_R<0, R8::A>(); break;
-        case 0x8f: Instr_RES_B_R<1, R8::A>(); break;
-        case 0x97: Instr_RES_B_R<2, R8::A>(); break;
-        case 0x9f: Instr_RES_B_R<3, R8::A>(); break;
-        case 0xa7: Instr_RES_B_R<4, R8::A>(); break;
-        case 0xaf: Instr_RES_B_R<5, R8::A>(); break;
-        case 0xb7: Instr_RES_B_R<6, R8::A>(); break;
-        case 0xbf: Instr_RES_B_R<7, R8::A>(); break;
-        case 0x80: Instr_RES_B_R<0, R8::B>(); break;
-        case 0x88: Instr_RES_B_R<1, R8::B>(); break;
-        case 0x90: Instr_RES_B_R<2, R8::B>(); break;
-        case 0x98: Instr_RES_B_R<3, R8::B>(); break;
-        case 0xa0: Instr_RES_B_R<4, R8::B>(); break;
-        case 0xa8: Instr_RES_B_R<5, R8::B>(); break;
-        case 0xb0: Instr_RES_B_R<6, R8::B>(); break;
-        case 0xb8: Instr_RES_B_R<7, R8::B>(); break;
-        case 0x81: Instr_RES_B_R<0, R8::C>(); break;
-        case 0x89: Instr_RES_B_R<1, R8::C>(); break;
-        case 0x91: Instr_RES_B_R<2, R8::C>(); break;
-        case 0x99: Instr_RES_B_R<3, R8::C>(); break;
-        case 0xa1: Instr_RES_B_R<4, R8::C>(); break;
-        case 0xa9: Instr_RES_B_R<5, R8::C>(); break;
-        case 0xb1: Instr_RES_B_R<6, R8::C>(); break;
-        case 0xb9: Instr_RES_B_R<7, R8::C>(); break;
-        case 0x82: Instr_RES_B_R<0, R8::D>(); break;
-        case 0x8a: Instr_RES_B_R<1, R8::D>(); break;
-        case 0x92: Instr_RES_B_R<2, R8::D>(); break;
-        case 0x9a: Instr_RES_B_R<3, R8::D>(); break;
-        case 0xa2: Instr_RES_B_R<4, R8::D>(); break;
-        case 0xaa: Instr_RES_B_R<5, R8::D>(); break;
-        case 0xb2: Instr_RES_B_R<6, R8::D>(); break;
-        case 0xba: Instr_RES_B_R<7, R8::D>(); break;
-        case 0x83: Instr_RES_B_R<0, R8::E>(); break;
-        case 0x8b: Instr_RES_B_R<1, R8::E>(); break;
-        case 0x93: Instr_RES_B_R<2, R8::E>(); break;
-        case 0x9b: Instr_RES_B_R<3, R8::E>(); break;
-        case 0xa3: Instr_RES_B_R<4, R8::E>(); break;
-        case 0xab: Instr_RES_B_R<5, R8::E>(); break;
-        case 0xb3: Instr_RES_B_R<6, R8::E>(); break;
-        case 0xbb: Instr_RES_B_R<7, R8::E>(); break;
-        case 0x84: Instr_RES_B_R<0, R8::H>(); break;
-        case 0x8c: Instr_RES_B_R<1, R8::H>(); break;
-        case 0x94: Instr_RES_B_R<2, R8::H>(); break;
-        case 0x9c: Instr_RES_B_R<3, R8::H>(); break;
-        case 0xa4: Instr_RES_B_R<4, R8::H>(); break;
-        case 0xac: Instr_RES_B_R<5, R8::H>(); break;
-        case 0xb4: Instr_RES_B_R<6, R8::H>(); break;
-        case 0xbc: Instr_RES_B_R<7, R8::H>(); break;
-        case 0x85: Instr_RES_B_R<0, R8::L>(); break;
-        case 0x8d: Instr_RES_B_R<1, R8::L>(); break;
-        case 0x95: Instr_RES_B_R<2, R8::L>(); break;
-        case 0x9d: Instr_RES_B_R<3, R8::L>(); break;
-        case 0xa5: Instr_RES_B_R<4, R8::L>(); break;
-        case 0xad: Instr_RES_B_R<5, R8::L>(); break;
-        case 0xb5: Instr_RES_B_R<6, R8::L>(); break;
-        case 0xbd: Instr_RES_B_R<7, R8::L>(); break;
-        case 0x86: Instr_RES_B_MEM_HL<0>(); break;
-        case 0x8e: Instr_RES_B_MEM_HL<1>(); break;
-        case 0x96: Instr_RES_B_MEM_HL<2>(); break;
-        case 0x9e: Instr_RES_B_MEM_HL<3>(); break;
-        case 0xa6: Instr_RES_B_MEM_HL<4>(); break;
-        case 0xae: Instr_RES_B_MEM_HL<5>(); break;
-        case 0xb6: Instr_RES_B_MEM_HL<6>(); break;
-        case 0xbe: Instr_RES_B_MEM_HL<7>(); break;
-
-        case 0xc7: Instr_SET_B_R<0, R8::A>(); break;
-        case 0xcf: Instr_SET_B_R<1, R8::A>(); break;
-        case 0xd7: Instr_SET_B_R<2, R8::A>(); break;
-        case 0xdf: Instr_SET_B_R<3, R8::A>(); break;
-        case 0xe7: Instr_SET_B_R<4, R8::A>(); break;
-        case 0xef: Instr_SET_B_R<5, R8::A>(); break;
-        case 0xf7: Instr_SET_B_R<6, R8::A>(); break;
-        case 0xff: Instr_SET_B_R<7, R8::A>(); break;
-        case 0xc0: Instr_SET_B_R<0, R8::B>(); break;
-        case 0xc8: Instr_SET_B_R<1, R8::B>(); break;
-        case 0xd0: Instr_SET_B_R<2, R8::B>(); break;
-        case 0xd8: Instr_SET_B_R<3, R8::B>(); break;
-        case 0xe0: Instr_SET_B_R<4, R8::B>(); break;
-        case 0xe8: Instr_SET_B_R<5, R8::B>(); break;
-        case 0xf0: Instr_SET_B_R<6, R8::B>(); break;
-        case 0xf8: Instr_SET_B_R<7, R8::B>(); break;
-        case 0xc1: Instr_SET_B_R<0, R8::C>(); break;
-        case 0xc9: Instr_SET_B_R<1, R8::C>(); break;
-        case 0xd1: Instr_SET_B_R<2, R8::C>(); break;
-        case 0xd9: Instr_SET_B_R<3, R8::C>(); break;
-        case 0xe1: Instr_SET_B_R<4, R8::C>(); break;
-        case 0xe9: Instr_SET_B_R<5, R8::C>(); break;
-        case 0xf1: Instr_SET_B_R<6, R8::C>(); break;
-        case 0xf9: Instr_SET_B_R<7, R8::C>(); break;
-        case 0xc2: Instr_SET_B_R<0, R8::D>(); break;
-        case 0xca: Instr_SET_B_R<1, R8::D>(); break;
-        case 0xd2: Instr_SET_B_R<2, R8::D>(); break;
-        case 0xda: Instr_SET_B_R<3, R8::D>(); break;
-        case 0xe2: Instr_SET_B_R<4, R8::D>(); break;
-        case 0xea: Instr_SET_B_R<5, R8::D>(); break;
-        case 0xf2: Instr_SET_B_R<6, R8::D>(); break;
-        case 0xfa: Instr_SET_B_R<7, R8::D>(); break;
-        case 0xc3: Instr_SET_B_R<0, R8::E>(); break;
-        case 0xcb: Instr_SET_B_R<1, R8::E>(); break;
-        case 0xd3: Instr_SET_B_R<2, R8::E>(); break;
-        case 0xdb: Instr_SET_B_R<3, R8::E>(); break;
-        case 0xe3: Instr_SET_B_R<4, R8::E>(); break;
-        case 0xeb: Instr_SET_B_R<5, R8::E>(); break;
-        case 0xf3: Instr_SET_B_R<6, R8::E>(); break;
-        case 0xfb: Instr_SET_B_R<7, R8::E>(); break;
-        case 0xc4: Instr_SET_B_R<0, R8::H>(); break;
-        case 0xcc: Instr_SET_B_R<1, R8::H>(); break;
-        case 0xd4: Instr_SET_B_R<2, R8::H>(); break;
-        case 0xdc: Instr_SET_B_R<3, R8::H>(); break;
-        case 0xe4: Instr_SET_B_R<4, R8::H>(); break;
-        case 0xec: Instr_SET_B_R<5, R8::H>(); break;
-        case 0xf4: Instr_SET_B_R<6, R8::H>(); break;
-        case 0xfc: Instr_SET_B_R<7, R8::H>(); break;
-        case 0xc5: Instr_SET_B_R<0, R8::L>(); break;
-        case 0xcd: Instr_SET_B_R<1, R8::L>(); break;
-        case 0xd5: Instr_SET_B_R<2, R8::L>(); break;
-        case 0xdd: Instr_SET_B_R<3, R8::L>(); break;
-        case 0xe5: Instr_SET_B_R<4, R8::L>(); break;
-        case 0xed: Instr_SET_B_R<5, R8::L>(); break;
-        case 0xf5: Instr_SET_B_R<6, R8::L>(); break;
-        case 0xfd: Instr_SET_B_R<7, R8::L>(); break;
-        case 0xc6: Instr_SET_B_MEM_HL<0>(); break;
-        case 0xce: Instr_SET_B_MEM_HL<1>(); break;
-        case 0xd6: Instr_SET_B_MEM_HL<2>(); break;
-        case 0xde: Instr_SET_B_MEM_HL<3>(); break;
-        case 0xe6: Instr_SET_B_MEM_HL<4>(); break;
-        case 0xee: Instr_SET_B_MEM_HL<5>(); break;
-        case 0xf6: Instr_SET_B_MEM_HL<6>(); break;
-        case 0xfe: Instr_SET_B_MEM_HL<7>(); break;
-        default: LOG_ERROR("CPU: Unknown prefixed opcode {:X}", cb_opcode); break;
-        }
-        break;
+    case 0xcb: InterpretCbInstruction(); break;
+    default: LOG_ERROR_LIMITED("CPU: Unknown opcode {:X}", opcode);
     }
-    default: LOG_ERROR("CPU: Unknown opcode {:X}", opcode);
+}
+
+void Cpu::InterpretCbInstruction()
+{
+    const uint8_t cb_opcode = ReadOperand();
+
+    switch (cb_opcode)
+    {
+    case 0x07: Instr_RLC_R<R8::A>(); break;
+    case 0x00: Instr_RLC_R<R8::B>(); break;
+    case 0x01: Instr_RLC_R<R8::C>(); break;
+    case 0x02: Instr_RLC_R<R8::D>(); break;
+    case 0x03: Instr_RLC_R<R8::E>(); break;
+    case 0x04: Instr_RLC_R<R8::H>(); break;
+    case 0x05: Instr_RLC_R<R8::L>(); break;
+    case 0x06: Instr_RLC_MEM_HL(); break;
+
+    case 0x0f: Instr_RRC_R<R8::A>(); break;
+    case 0x08: Instr_RRC_R<R8::B>(); break;
+    case 0x09: Instr_RRC_R<R8::C>(); break;
+    case 0x0a: Instr_RRC_R<R8::D>(); break;
+    case 0x0b: Instr_RRC_R<R8::E>(); break;
+    case 0x0c: Instr_RRC_R<R8::H>(); break;
+    case 0x0d: Instr_RRC_R<R8::L>(); break;
+    case 0x0e: Instr_RRC_MEM_HL(); break;
+
+    case 0x17: Instr_RL_R<R8::A>(); break;
+    case 0x10: Instr_RL_R<R8::B>(); break;
+    case 0x11: Instr_RL_R<R8::C>(); break;
+    case 0x12: Instr_RL_R<R8::D>(); break;
+    case 0x13: Instr_RL_R<R8::E>(); break;
+    case 0x14: Instr_RL_R<R8::H>(); break;
+    case 0x15: Instr_RL_R<R8::L>(); break;
+    case 0x16: Instr_RL_MEM_HL(); break;
+
+    case 0x1f: Instr_RR_R<R8::A>(); break;
+    case 0x18: Instr_RR_R<R8::B>(); break;
+    case 0x19: Instr_RR_R<R8::C>(); break;
+    case 0x1a: Instr_RR_R<R8::D>(); break;
+    case 0x1b: Instr_RR_R<R8::E>(); break;
+    case 0x1c: Instr_RR_R<R8::H>(); break;
+    case 0x1d: Instr_RR_R<R8::L>(); break;
+    case 0x1e: Instr_RR_MEM_HL(); break;
+
+    case 0x27: Instr_SLA_R<R8::A>(); break;
+    case 0x20: Instr_SLA_R<R8::B>(); break;
+    case 0x21: Instr_SLA_R<R8::C>(); break;
+    case 0x22: Instr_SLA_R<R8::D>(); break;
+    case 0x23: Instr_SLA_R<R8::E>(); break;
+    case 0x24: Instr_SLA_R<R8::H>(); break;
+    case 0x25: Instr_SLA_R<R8::L>(); break;
+    case 0x26: Instr_SLA_MEM_HL(); break;
+
+    case 0x2f: Instr_SRA_R<R8::A>(); break;
+    case 0x28: Instr_SRA_R<R8::B>(); break;
+    case 0x29: Instr_SRA_R<R8::C>(); break;
+    case 0x2a: Instr_SRA_R<R8::D>(); break;
+    case 0x2b: Instr_SRA_R<R8::E>(); break;
+    case 0x2c: Instr_SRA_R<R8::H>(); break;
+    case 0x2d: Instr_SRA_R<R8::L>(); break;
+    case 0x2e: Instr_SRA_MEM_HL(); break;
+
+    case 0x37: Instr_SWAP_R<R8::A>(); break;
+    case 0x30: Instr_SWAP_R<R8::B>(); break;
+    case 0x31: Instr_SWAP_R<R8::C>(); break;
+    case 0x32: Instr_SWAP_R<R8::D>(); break;
+    case 0x33: Instr_SWAP_R<R8::E>(); break;
+    case 0x34: Instr_SWAP_R<R8::H>(); break;
+    case 0x35: Instr_SWAP_R<R8::L>(); break;
+    case 0x36: Instr_SWAP_MEM_HL(); break;
+
+    case 0x3f: Instr_SRL_R<R8::A>(); break;
+    case 0x38: Instr_SRL_R<R8::B>(); break;
+    case 0x39: Instr_SRL_R<R8::C>(); break;
+    case 0x3a: Instr_SRL_R<R8::D>(); break;
+    case 0x3b: Instr_SRL_R<R8::E>(); break;
+    case 0x3c: Instr_SRL_R<R8::H>(); break;
+    case 0x3d: Instr_SRL_R<R8::L>(); break;
+    case 0x3e: Instr_SRL_MEM_HL(); break;
+
+    case 0x47: Instr_BIT_B_R<0, R8::A>(); break;
+    case 0x4f: Instr_BIT_B_R<1, R8::A>(); break;
+    case 0x57: Instr_BIT_B_R<2, R8::A>(); break;
+    case 0x5f: Instr_BIT_B_R<3, R8::A>(); break;
+    case 0x67: Instr_BIT_B_R<4, R8::A>(); break;
+    case 0x6f: Instr_BIT_B_R<5, R8::A>(); break;
+    case 0x77: Instr_BIT_B_R<6, R8::A>(); break;
+    case 0x7f: Instr_BIT_B_R<7, R8::A>(); break;
+    case 0x40: Instr_BIT_B_R<0, R8::B>(); break;
+    case 0x48: Instr_BIT_B_R<1, R8::B>(); break;
+    case 0x50: Instr_BIT_B_R<2, R8::B>(); break;
+    case 0x58: Instr_BIT_B_R<3, R8::B>(); break;
+    case 0x60: Instr_BIT_B_R<4, R8::B>(); break;
+    case 0x68: Instr_BIT_B_R<5, R8::B>(); break;
+    case 0x70: Instr_BIT_B_R<6, R8::B>(); break;
+    case 0x78: Instr_BIT_B_R<7, R8::B>(); break;
+    case 0x41: Instr_BIT_B_R<0, R8::C>(); break;
+    case 0x49: Instr_BIT_B_R<1, R8::C>(); break;
+    case 0x51: Instr_BIT_B_R<2, R8::C>(); break;
+    case 0x59: Instr_BIT_B_R<3, R8::C>(); break;
+    case 0x61: Instr_BIT_B_R<4, R8::C>(); break;
+    case 0x69: Instr_BIT_B_R<5, R8::C>(); break;
+    case 0x71: Instr_BIT_B_R<6, R8::C>(); break;
+    case 0x79: Instr_BIT_B_R<7, R8::C>(); break;
+    case 0x42: Instr_BIT_B_R<0, R8::D>(); break;
+    case 0x4a: Instr_BIT_B_R<1, R8::D>(); break;
+    case 0x52: Instr_BIT_B_R<2, R8::D>(); break;
+    case 0x5a: Instr_BIT_B_R<3, R8::D>(); break;
+    case 0x62: Instr_BIT_B_R<4, R8::D>(); break;
+    case 0x6a: Instr_BIT_B_R<5, R8::D>(); break;
+    case 0x72: Instr_BIT_B_R<6, R8::D>(); break;
+    case 0x7a: Instr_BIT_B_R<7, R8::D>(); break;
+    case 0x43: Instr_BIT_B_R<0, R8::E>(); break;
+    case 0x4b: Instr_BIT_B_R<1, R8::E>(); break;
+    case 0x53: Instr_BIT_B_R<2, R8::E>(); break;
+    case 0x5b: Instr_BIT_B_R<3, R8::E>(); break;
+    case 0x63: Instr_BIT_B_R<4, R8::E>(); break;
+    case 0x6b: Instr_BIT_B_R<5, R8::E>(); break;
+    case 0x73: Instr_BIT_B_R<6, R8::E>(); break;
+    case 0x7b: Instr_BIT_B_R<7, R8::E>(); break;
+    case 0x44: Instr_BIT_B_R<0, R8::H>(); break;
+    case 0x4c: Instr_BIT_B_R<1, R8::H>(); break;
+    case 0x54: Instr_BIT_B_R<2, R8::H>(); break;
+    case 0x5c: Instr_BIT_B_R<3, R8::H>(); break;
+    case 0x64: Instr_BIT_B_R<4, R8::H>(); break;
+    case 0x6c: Instr_BIT_B_R<5, R8::H>(); break;
+    case 0x74: Instr_BIT_B_R<6, R8::H>(); break;
+    case 0x7c: Instr_BIT_B_R<7, R8::H>(); break;
+    case 0x45: Instr_BIT_B_R<0, R8::L>(); break;
+    case 0x4d: Instr_BIT_B_R<1, R8::L>(); break;
+    case 0x55: Instr_BIT_B_R<2, R8::L>(); break;
+    case 0x5d: Instr_BIT_B_R<3, R8::L>(); break;
+    case 0x65: Instr_BIT_B_R<4, R8::L>(); break;
+    case 0x6d: Instr_BIT_B_R<5, R8::L>(); break;
+    case 0x75: Instr_BIT_B_R<6, R8::L>(); break;
+    case 0x7d: Instr_BIT_B_R<7, R8::L>(); break;
+    case 0x46: Instr_BIT_B_MEM_HL<0>(); break;
+    case 0x4e: Instr_BIT_B_MEM_HL<1>(); break;
+    case 0x56: Instr_BIT_B_MEM_HL<2>(); break;
+    case 0x5e: Instr_BIT_B_MEM_HL<3>(); break;
+    case 0x66: Instr_BIT_B_MEM_HL<4>(); break;
+    case 0x6e: Instr_BIT_B_MEM_HL<5>(); break;
+    case 0x76: Instr_BIT_B_MEM_HL<6>(); break;
+    case 0x7e: Instr_BIT_B_MEM_HL<7>(); break;
+
+    case 0x87: Instr_RES_B_R<0, R8::A>(); break;
+    case 0x8f: Instr_RES_B_R<1, R8::A>(); break;
+    case 0x97: Instr_RES_B_R<2, R8::A>(); break;
+    case 0x9f: Instr_RES_B_R<3, R8::A>(); break;
+    case 0xa7: Instr_RES_B_R<4, R8::A>(); break;
+    case 0xaf: Instr_RES_B_R<5, R8::A>(); break;
+    case 0xb7: Instr_RES_B_R<6, R8::A>(); break;
+    case 0xbf: Instr_RES_B_R<7, R8::A>(); break;
+    case 0x80: Instr_RES_B_R<0, R8::B>(); break;
+    case 0x88: Instr_RES_B_R<1, R8::B>(); break;
+    case 0x90: Instr_RES_B_R<2, R8::B>(); break;
+    case 0x98: Instr_RES_B_R<3, R8::B>(); break;
+    case 0xa0: Instr_RES_B_R<4, R8::B>(); break;
+    case 0xa8: Instr_RES_B_R<5, R8::B>(); break;
+    case 0xb0: Instr_RES_B_R<6, R8::B>(); break;
+    case 0xb8: Instr_RES_B_R<7, R8::B>(); break;
+    case 0x81: Instr_RES_B_R<0, R8::C>(); break;
+    case 0x89: Instr_RES_B_R<1, R8::C>(); break;
+    case 0x91: Instr_RES_B_R<2, R8::C>(); break;
+    case 0x99: Instr_RES_B_R<3, R8::C>(); break;
+    case 0xa1: Instr_RES_B_R<4, R8::C>(); break;
+    case 0xa9: Instr_RES_B_R<5, R8::C>(); break;
+    case 0xb1: Instr_RES_B_R<6, R8::C>(); break;
+    case 0xb9: Instr_RES_B_R<7, R8::C>(); break;
+    case 0x82: Instr_RES_B_R<0, R8::D>(); break;
+    case 0x8a: Instr_RES_B_R<1, R8::D>(); break;
+    case 0x92: Instr_RES_B_R<2, R8::D>(); break;
+    case 0x9a: Instr_RES_B_R<3, R8::D>(); break;
+    case 0xa2: Instr_RES_B_R<4, R8::D>(); break;
+    case 0xaa: Instr_RES_B_R<5, R8::D>(); break;
+    case 0xb2: Instr_RES_B_R<6, R8::D>(); break;
+    case 0xba: Instr_RES_B_R<7, R8::D>(); break;
+    case 0x83: Instr_RES_B_R<0, R8::E>(); break;
+    case 0x8b: Instr_RES_B_R<1, R8::E>(); break;
+    case 0x93: Instr_RES_B_R<2, R8::E>(); break;
+    case 0x9b: Instr_RES_B_R<3, R8::E>(); break;
+    case 0xa3: Instr_RES_B_R<4, R8::E>(); break;
+    case 0xab: Instr_RES_B_R<5, R8::E>(); break;
+    case 0xb3: Instr_RES_B_R<6, R8::E>(); break;
+    case 0xbb: Instr_RES_B_R<7, R8::E>(); break;
+    case 0x84: Instr_RES_B_R<0, R8::H>(); break;
+    case 0x8c: Instr_RES_B_R<1, R8::H>(); break;
+    case 0x94: Instr_RES_B_R<2, R8::H>(); break;
+    case 0x9c: Instr_RES_B_R<3, R8::H>(); break;
+    case 0xa4: Instr_RES_B_R<4, R8::H>(); break;
+    case 0xac: Instr_RES_B_R<5, R8::H>(); break;
+    case 0xb4: Instr_RES_B_R<6, R8::H>(); break;
+    case 0xbc: Instr_RES_B_R<7, R8::H>(); break;
+    case 0x85: Instr_RES_B_R<0, R8::L>(); break;
+    case 0x8d: Instr_RES_B_R<1, R8::L>(); break;
+    case 0x95: Instr_RES_B_R<2, R8::L>(); break;
+    case 0x9d: Instr_RES_B_R<3, R8::L>(); break;
+    case 0xa5: Instr_RES_B_R<4, R8::L>(); break;
+    case 0xad: Instr_RES_B_R<5, R8::L>(); break;
+    case 0xb5: Instr_RES_B_R<6, R8::L>(); break;
+    case 0xbd: Instr_RES_B_R<7, R8::L>(); break;
+    case 0x86: Instr_RES_B_MEM_HL<0>(); break;
+    case 0x8e: Instr_RES_B_MEM_HL<1>(); break;
+    case 0x96: Instr_RES_B_MEM_HL<2>(); break;
+    case 0x9e: Instr_RES_B_MEM_HL<3>(); break;
+    case 0xa6: Instr_RES_B_MEM_HL<4>(); break;
+    case 0xae: Instr_RES_B_MEM_HL<5>(); break;
+    case 0xb6: Instr_RES_B_MEM_HL<6>(); break;
+    case 0xbe: Instr_RES_B_MEM_HL<7>(); break;
+
+    case 0xc7: Instr_SET_B_R<0, R8::A>(); break;
+    case 0xcf: Instr_SET_B_R<1, R8::A>(); break;
+    case 0xd7: Instr_SET_B_R<2, R8::A>(); break;
+    case 0xdf: Instr_SET_B_R<3, R8::A>(); break;
+    case 0xe7: Instr_SET_B_R<4, R8::A>(); break;
+    case 0xef: Instr_SET_B_R<5, R8::A>(); break;
+    case 0xf7: Instr_SET_B_R<6, R8::A>(); break;
+    case 0xff: Instr_SET_B_R<7, R8::A>(); break;
+    case 0xc0: Instr_SET_B_R<0, R8::B>(); break;
+    case 0xc8: Instr_SET_B_R<1, R8::B>(); break;
+    case 0xd0: Instr_SET_B_R<2, R8::B>(); break;
+    case 0xd8: Instr_SET_B_R<3, R8::B>(); break;
+    case 0xe0: Instr_SET_B_R<4, R8::B>(); break;
+    case 0xe8: Instr_SET_B_R<5, R8::B>(); break;
+    case 0xf0: Instr_SET_B_R<6, R8::B>(); break;
+    case 0xf8: Instr_SET_B_R<7, R8::B>(); break;
+    case 0xc1: Instr_SET_B_R<0, R8::C>(); break;
+    case 0xc9: Instr_SET_B_R<1, R8::C>(); break;
+    case 0xd1: Instr_SET_B_R<2, R8::C>(); break;
+    case 0xd9: Instr_SET_B_R<3, R8::C>(); break;
+    case 0xe1: Instr_SET_B_R<4, R8::C>(); break;
+    case 0xe9: Instr_SET_B_R<5, R8::C>(); break;
+    case 0xf1: Instr_SET_B_R<6, R8::C>(); break;
+    case 0xf9: Instr_SET_B_R<7, R8::C>(); break;
+    case 0xc2: Instr_SET_B_R<0, R8::D>(); break;
+    case 0xca: Instr_SET_B_R<1, R8::D>(); break;
+    case 0xd2: Instr_SET_B_R<2, R8::D>(); break;
+    case 0xda: Instr_SET_B_R<3, R8::D>(); break;
+    case 0xe2: Instr_SET_B_R<4, R8::D>(); break;
+    case 0xea: Instr_SET_B_R<5, R8::D>(); break;
+    case 0xf2: Instr_SET_B_R<6, R8::D>(); break;
+    case 0xfa: Instr_SET_B_R<7, R8::D>(); break;
+    case 0xc3: Instr_SET_B_R<0, R8::E>(); break;
+    case 0xcb: Instr_SET_B_R<1, R8::E>(); break;
+    case 0xd3: Instr_SET_B_R<2, R8::E>(); break;
+    case 0xdb: Instr_SET_B_R<3, R8::E>(); break;
+    case 0xe3: Instr_SET_B_R<4, R8::E>(); break;
+    case 0xeb: Instr_SET_B_R<5, R8::E>(); break;
+    case 0xf3: Instr_SET_B_R<6, R8::E>(); break;
+    case 0xfb: Instr_SET_B_R<7, R8::E>(); break;
+    case 0xc4: Instr_SET_B_R<0, R8::H>(); break;
+    case 0xcc: Instr_SET_B_R<1, R8::H>(); break;
+    case 0xd4: Instr_SET_B_R<2, R8::H>(); break;
+    case 0xdc: Instr_SET_B_R<3, R8::H>(); break;
+    case 0xe4: Instr_SET_B_R<4, R8::H>(); break;
+    case 0xec: Instr_SET_B_R<5, R8::H>(); break;
+    case 0xf4: Instr_SET_B_R<6, R8::H>(); break;
+    case 0xfc: Instr_SET_B_R<7, R8::H>(); break;
+    case 0xc5: Instr_SET_B_R<0, R8::L>(); break;
+    case 0xcd: Instr_SET_B_R<1, R8::L>(); break;
+    case 0xd5: Instr_SET_B_R<2, R8::L>(); break;
+    case 0xdd: Instr_SET_B_R<3, R8::L>(); break;
+    case 0xe5: Instr_SET_B_R<4, R8::L>(); break;
+    case 0xed: Instr_SET_B_R<5, R8::L>(); break;
+    case 0xf5: Instr_SET_B_R<6, R8::L>(); break;
+    case 0xfd: Instr_SET_B_R<7, R8::L>(); break;
+    case 0xc6: Instr_SET_B_MEM_HL<0>(); break;
+    case 0xce: Instr_SET_B_MEM_HL<1>(); break;
+    case 0xd6: Instr_SET_B_MEM_HL<2>(); break;
+    case 0xde: Instr_SET_B_MEM_HL<3>(); break;
+    case 0xe6: Instr_SET_B_MEM_HL<4>(); break;
+    case 0xee: Instr_SET_B_MEM_HL<5>(); break;
+    case 0xf6: Instr_SET_B_MEM_HL<6>(); break;
+    case 0xfe: Instr_SET_B_MEM_HL<7>(); break;
+    default: LOG_ERROR_LIMITED("CPU: Unknown prefixed opcode {:X}", cb_opcode); break;
     }
 }
+#endif
 
 }  // namespace gb::sm83
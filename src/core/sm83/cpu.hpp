@@ -1,12 +1,22 @@
 #pragma once
 
+#include <array>
+#include <bit>
 #include <cstdint>
-#ifndef NDEBUG
-#include <fstream>
-#endif
+#include <cstring>
+#include <unordered_map>
 #include <utility>
 
 #include "core/memory/bus.hpp"
+#include "core/sm83/flags.hpp"
+#ifdef GBCXX_JIT
+#include "core/sm83/jit.hpp"
+#endif
+#include "core/sm83/precompiled.hpp"
+#include "core/sm83/tracer.hpp"
+#ifdef GBCXX_DECODE_CACHE
+#include "core/sm83/decode_cache.hpp"
+#endif
 #include "core/util.hpp"
 
 namespace gb::sm83
@@ -39,17 +49,84 @@ enum class Condition : uint8_t
     Carry
 };
 
+namespace detail
+{
+// B, C, D, E, H and L are stored as the pairs BC, DE and HL in host byte order, so that a pair can
+// be read or written as a single uint16_t.
+constexpr size_t kHighByte = std::endian::native == std::endian::little ? 1 : 0;
+
+constexpr size_t GetRegIndex(R8 r)
+{
+    switch (r)
+    {
+    case R8::B: return 0 + kHighByte;
+    case R8::C: return 1 - kHighByte;
+    case R8::D: return 2 + kHighByte;
+    case R8::E: return 3 - kHighByte;
+    case R8::H: return 4 + kHighByte;
+    case R8::L: return 5 - kHighByte;
+    default: std::unreachable();
+    }
+}
+
+constexpr size_t GetRegIndex(R16 rr)
+{
+    switch (rr)
+    {
+    case R16::Bc: return 0;
+    case R16::De: return 2;
+    case R16::Hl: return 4;
+    default: std::unreachable();
+    }
+}
+
+constexpr std::array<uint8_t, 6> kInitialRegs = []
+{
+    std::array<uint8_t, 6> regs{};
+    regs[GetRegIndex(R8::B)] = 0x00;
+    regs[GetRegIndex(R8::C)] = 0x13;
+    regs[GetRegIndex(R8::D)] = 0x00;
+    regs[GetRegIndex(R8::E)] = 0xd8;
+    regs[GetRegIndex(R8::H)] = 0x01;
+    regs[GetRegIndex(R8::L)] = 0x4d;
+    return regs;
+}();
+}  // namespace detail
+
 class Cpu
 {
 public:
     explicit Cpu(std::vector<uint8_t> rom_data) : bus_(std::move(rom_data))
     {
-#ifndef NDEBUG
-        log_file_ << "";
-#endif
+        LoadPrecompiledCode();
     }
 
     uint8_t Step();
+    template <Tracer T>
+    uint8_t Step(T& tracer);
+
+    // Executes instructions and ticks the bus after each of them, until at least cycle_budget
+    // cycles have elapsed or the PPU has a frame ready. Returns the number of elapsed cycles.
+    uint32_t Run(uint32_t cycle_budget);
+    template <Tracer T>
+    uint32_t Run(uint32_t cycle_budget, T& tracer);
+
+    [[nodiscard]] bool IsHalted() const { return halt_; }
+
+    // Cycles elapsed on the bus clock, including the instruction being executed.
+    [[nodiscard]] uint64_t GetCycleCount() const
+    {
+        return bus_.scheduler.GetTimestamp() + cycles_;
+    }
+
+    // Cycles fast-forwarded through polling loops, see TrySkipIdleLoop().
+    [[nodiscard]] uint64_t GetIdleCyclesSkipped() const { return idle_cycles_skipped_; }
+    // Cycles spent in loops executed as superinstructions, see TryRunFusedLoop().
+    [[nodiscard]] uint64_t GetFusedCycles() const { return fused_cycles_; }
+    // Cycles spent in code recompiled ahead of time, see TryRunPrecompiled().
+    [[nodiscard]] uint64_t GetPrecompiledCycles() const { return precompiled_cycles_; }
+    // Cycles spent in code compiled at runtime, see TryRunCompiled().
+    [[nodiscard]] uint64_t GetJitCycles() const { return jit_cycles_; }
 
     [[nodiscard]] uint8_t GetReg(R8 r) const;
     [[nodiscard]] uint16_t GetReg(R16 r) const;
@@ -63,9 +140,77 @@ public:
     void SetReg(R8 r, uint8_t v);
     void SetReg(R16 r, uint16_t v);
 
+    // Entry point for ROMs recompiled by gbcxx_recompile, see cpu_execute.hpp. Executes one
+    // instruction at pc, ticks the bus and returns true when control has to go back to Run().
+    template <uint8_t Opcode>
+    bool StepCompiled(uint32_t operands);
+
 private:
+#ifdef GBCXX_JIT
+    // Generated code accesses registers and the bus in place and calls back for the rest.
+    friend class Jit;
+#endif
+
+    // Register accessors for instruction handlers, resolved at compile time to a single load or
+    // store of a_, flags_, regs_, sp_ or pc_.
+    template <R8 R>
+    [[nodiscard]] uint8_t GetReg() const;
+    template <R16 RR>
+    [[nodiscard]] uint16_t GetReg() const;
+    template <R8 R>
+    void SetReg(uint8_t v);
+    template <R16 RR>
+    void SetReg(uint16_t v);
+
+    // Cycles to tick the bus for while halted without an interrupt pending.
+    [[nodiscard]] uint16_t GetHaltCycles() const;
+
+#ifdef GBCXX_IDLE_LOOP_SKIP
+    // Everything besides memory and the bus that decides what an instruction does.
+    struct IdleLoopState
+    {
+        std::array<uint8_t, 6> regs;
+        uint8_t a;
+        uint8_t f;
+        uint16_t sp;
+        bool ime;
+        bool ime_next;
+        bool halt_bug;
+
+        bool operator==(const IdleLoopState&) const = default;
+    };
+
+    // A loop iteration being observed, starting at the target of a backward jump.
+    struct IdleLoop
+    {
+        bool armed{};
+        uint16_t start{};
+        IdleLoopState state{};
+        uint32_t cycles{};
+        uint32_t until_event{};
+        uint32_t writes{};
+        bool reads_timer{};
+    };
+
+    [[nodiscard]] IdleLoopState GetIdleLoopState() const;
+    void TrySkipIdleLoop();
+#endif
+
+#ifdef GBCXX_SUPERINSTRUCTIONS
+    // Cycles a fused loop may take without reaching the next bus event or the end of the budget.
+    [[nodiscard]] uint32_t GetFusedCycleLimit();
+    bool TryRunFusedLoop();
+    // Return the cycles taken, or 0 when the loop has to be interpreted.
+    uint32_t RunFusedCopyLoop(uint32_t limit);
+    uint32_t RunFusedPollLoop(uint32_t limit);
+    template <R8 R>
+    uint32_t RunFusedDecLoop(uint32_t limit);
+#endif
+
+    // Ticks the bus in chunks it accepts, for skipped or fused cycles.
+    void TickBus(uint32_t tcycles);
+
     void Tick4();
-    void LogForGameBoyDoctor();
 
     uint8_t ReadOperand();
     uint16_t ReadOperands();
@@ -74,6 +219,9 @@ private:
     uint16_t ReadWord(uint16_t addr);
 
     void WriteByte(uint16_t addr, uint8_t val);
+    // ReadByte() and WriteByte() without ticking, for code that counts cycles itself.
+    uint8_t LoadByte(uint16_t addr);
+    void StoreByte(uint16_t addr, uint8_t val);
     void WriteWord(uint16_t addr, uint16_t val);
 
     void StackPush(uint16_t val);
@@ -83,29 +231,89 @@ private:
 
     [[nodiscard]] bool EvaluateCondition(Condition cond) const;
 
+#ifdef GBCXX_DECODE_CACHE
+    // Executes the instruction at pc from the decode cache, returns false when it has to be
+    // fetched from the bus instead.
+    bool TryExecuteCachedInstruction();
+    // The cached instruction at pc, nullptr when it has to be fetched from the bus.
+    const DecodedInstruction* FetchCachedInstruction();
+#endif
     void InterpretInstruction();
+    void InterpretCbInstruction();
+    void ExecuteInstruction(uint8_t opcode);
+
+#ifdef GBCXX_CPU_DISPATCH_GOTO
+    // Threaded code: every handler fetches the next opcode and jumps straight to its handler.
+    // Entered by Run() when HandleInterrupts() would have nothing to do, returns to it as soon as
+    // it would check something between instructions, see FinishThreadedInstruction(). Returns the
+    // PC of the last instruction executed.
+    uint16_t RunThreaded();
+    uint8_t FetchThreadedOpcode();
+    // Ends an instruction like Step() and Run() do, returns whether RunThreaded() has to return.
+    template <uint8_t Opcode>
+    bool FinishThreadedInstruction(uint16_t pc);
+#endif
+
+    // Decodes an opcode at compile time into the matching Instr_* handler. Used to build the
+    // handler tables of the table and computed-goto dispatch engines.
+    template <uint8_t Opcode>
+    void ExecuteOpcode();
+    template <uint8_t Opcode>
+    void ExecuteCbOpcode();
+
+    // Compiled code is only entered when HandleInterrupts() would have nothing to do, and left when
+    // an OAM DMA starts.
+    [[nodiscard]] bool CanEnterCompiledCode() const;
+    // Whether compiled code has to return to Run() after the instruction just executed.
+    [[nodiscard]] bool ShouldLeaveCompiledCode() const;
+    void LoadPrecompiledCode();
+    bool TryRunPrecompiled();
+#ifdef GBCXX_JIT
+    bool TryRunCompiled();
+#endif
+
+    static constexpr uint16_t kMaxHaltCycles = 0xfffc;
 
     memory::Bus bus_;
     uint8_t cycles_{};
 
-#ifndef NDEBUG
-    std::fstream log_file_{"gameboy_doctor.log", std::ios::out};
+    uint32_t run_cycles_{};
+    uint32_t run_budget_{};
+
+    // Operands of the pre-decoded instruction being executed, consumed by ReadOperand().
+    const uint8_t* prefetched_operands_{};
+    // Set when a write may have changed the code being executed, e.g. by switching ROM banks.
+    bool leave_compiled_code_{};
+    uint64_t idle_cycles_skipped_{};
+    uint64_t fused_cycles_{};
+    uint64_t precompiled_cycles_{};
+    uint64_t jit_cycles_{};
+#ifdef GBCXX_IDLE_LOOP_SKIP
+    IdleLoop idle_loop_;
+    uint32_t write_count_{};
+#endif
+
+    // Blocks of the ahead-of-time recompiled ROM, keyed by (bank << 16) | pc.
+    std::unordered_map<uint32_t, const PrecompiledEntry*> precompiled_entries_;
+#ifdef GBCXX_JIT
+    Jit jit_;
+#endif
+
+#ifdef GBCXX_DECODE_CACHE
+    DecodeCache decode_cache_;
+#ifdef GBCXX_CPU_DISPATCH_GOTO
+    // Copy of the cached instruction RunThreaded() is executing, a write performed by the
+    // instruction may invalidate its block.
+    DecodedInstruction threaded_instr_;
+#endif
 #endif
 
     uint16_t pc_{0x0100};
     uint16_t sp_{0xfffe};
     uint8_t a_{0x01};
-    uint8_t b_{0x00};
-    uint8_t c_{0x13};
-    uint8_t d_{0x00};
-    uint8_t e_{0xd8};
-    uint8_t h_{0x01};
-    uint8_t l_{0x4d};
-
-    bool zf_{true};
-    bool nf_{false};
-    bool hf_{true};
-    bool cf_{true};
+    alignas(uint16_t) std::array<uint8_t, 6> regs_{detail::kInitialRegs};
+
+    Flags flags_;
 
     bool ime_{true};
     bool ime_next_{};
@@ -269,51 +477,94 @@ private:
     void Instr_SET_B_MEM_HL();
 };
 
+template <R8 R>
+ALWAYS_INLINE uint8_t Cpu::GetReg() const
+{
+    if constexpr (R == R8::A) { return a_; }
+    else if constexpr (R == R8::F) { return flags_.Get(); }
+    else { return regs_[detail::GetRegIndex(R)]; }
+}
+
+template <R16 RR>
+ALWAYS_INLINE uint16_t Cpu::GetReg() const
+{
+    if constexpr (RR == R16::Af) { return static_cast<uint16_t>((a_ << 8) | flags_.Get()); }
+    else if constexpr (RR == R16::Sp) { return sp_; }
+    else if constexpr (RR == R16::Pc) { return pc_; }
+    else
+    {
+        uint16_t val{};
+        std::memcpy(&val, &regs_[detail::GetRegIndex(RR)], sizeof(val));
+        return val;
+    }
+}
+
+template <R8 R>
+ALWAYS_INLINE void Cpu::SetReg(uint8_t v)
+{
+    if constexpr (R == R8::A) { a_ = v; }
+    else if constexpr (R == R8::F) { flags_.Set(v); }
+    else { regs_[detail::GetRegIndex(R)] = v; }
+}
+
+template <R16 RR>
+ALWAYS_INLINE void Cpu::SetReg(uint16_t v)
+{
+    if constexpr (RR == R16::Af)
+    {
+        a_ = static_cast<uint8_t>(v >> 8);
+        flags_.Set(static_cast<uint8_t>(v));
+    }
+    else if constexpr (RR == R16::Sp) { sp_ = v; }
+    else if constexpr (RR == R16::Pc) { pc_ = v; }
+    else { std::memcpy(&regs_[detail::GetRegIndex(RR)], &v, sizeof(v)); }
+}
+
 template <R8 Dst, R8 Src>
 ALWAYS_INLINE void Cpu::Instr_LD_R_R()
 {
-    SetReg(Dst, GetReg(Src));
+    SetReg<Dst>(GetReg<Src>());
 }
 
 template <R8 Dst>
 ALWAYS_INLINE void Cpu::Instr_LD_R_N()
 {
-    SetReg(Dst, ReadOperand());
+    SetReg<Dst>(ReadOperand());
 }
 
 template <R8 Dst>
 ALWAYS_INLINE void Cpu::Instr_LD_R_MEM_HL()
 {
-    SetReg(Dst, ReadByte(GetReg(R16::Hl)));
+    SetReg<Dst>(ReadByte(GetReg<R16::Hl>()));
 }
 
 template <R8 Src>
 ALWAYS_INLINE void Cpu::Instr_LD_MEM_HL_R()
 {
-    WriteByte(GetReg(R16::Hl), GetReg(Src));
+    WriteByte(GetReg<R16::Hl>(), GetReg<Src>());
 }
 
-ALWAYS_INLINE void Cpu::Instr_LD_MEM_HL_N() { WriteByte(GetReg(R16::Hl), ReadOperand()); }
+ALWAYS_INLINE void Cpu::Instr_LD_MEM_HL_N() { WriteByte(GetReg<R16::Hl>(), ReadOperand()); }
 
 template <R16 Src>
 ALWAYS_INLINE void Cpu::Instr_LD_A_MEM_RR()
 {
-    a_ = ReadByte(GetReg(Src));
+    a_ = ReadByte(GetReg<Src>());
 }
 
 template <R16 Dst>
 ALWAYS_INLINE void Cpu::Instr_LD_MEM_RR_A()
 {
-    WriteByte(GetReg(Dst), a_);
+    WriteByte(GetReg<Dst>(), a_);
 }
 
 ALWAYS_INLINE void Cpu::Instr_LD_A_MEM_NN() { a_ = ReadByte(ReadOperands()); }
 
 ALWAYS_INLINE void Cpu::Instr_LD_MEM_NN_A() { WriteByte(ReadOperands(), a_); }
 
-ALWAYS_INLINE void Cpu::Instr_LDH_A_MEM_C() { a_ = ReadByte(0xff00 + c_); }
+ALWAYS_INLINE void Cpu::Instr_LDH_A_MEM_C() { a_ = ReadByte(0xff00 + GetReg<R8::C>()); }
 
-ALWAYS_INLINE void Cpu::Instr_LDH_MEM_C_A() { WriteByte(0xff00 + c_, a_); }
+ALWAYS_INLINE void Cpu::Instr_LDH_MEM_C_A() { WriteByte(0xff00 + GetReg<R8::C>(), a_); }
 
 ALWAYS_INLINE void Cpu::Instr_LDH_A_MEM_N() { a_ = ReadByte(0xff00 + ReadOperand()); }
 
@@ -321,301 +572,172 @@ ALWAYS_INLINE void Cpu::Instr_LDH_MEM_N_A() { WriteByte(0xff00 + ReadOperand(),
 
 ALWAYS_INLINE void Cpu::Instr_LD_A_MEM_HL_DEC()
 {
-    const uint16_t hl = GetReg(R16::Hl);
+    const uint16_t hl = GetReg<R16::Hl>();
     a_ = ReadByte(hl);
-    SetReg(R16::Hl, hl - 1);
+    SetReg<R16::Hl>(hl - 1);
 }
 
 ALWAYS_INLINE void Cpu::Instr_LD_MEM_HL_DEC_A()
 {
-    const uint16_t hl = GetReg(R16::Hl);
+    const uint16_t hl = GetReg<R16::Hl>();
     WriteByte(hl, a_);
-    SetReg(R16::Hl, hl - 1);
+    SetReg<R16::Hl>(hl - 1);
 }
 
 ALWAYS_INLINE void Cpu::Instr_LD_A_MEM_HL_INC()
 {
-    const uint16_t hl = GetReg(R16::Hl);
+    const uint16_t hl = GetReg<R16::Hl>();
     a_ = ReadByte(hl);
-    SetReg(R16::Hl, hl + 1);
+    SetReg<R16::Hl>(hl + 1);
 }
 
 ALWAYS_INLINE void Cpu::Instr_LD_MEM_HL_INC_A()
 {
-    const uint16_t hl = GetReg(R16::Hl);
+    const uint16_t hl = GetReg<R16::Hl>();
     WriteByte(hl, a_);
-    SetReg(R16::Hl, hl + 1);
+    SetReg<R16::Hl>(hl + 1);
 }
 
 template <R8 R>
 ALWAYS_INLINE void Cpu::Instr_ADD_R()
 {
-    const uint8_t val = GetReg(R);
-    const uint16_t result = a_ + val;
-
-    zf_ = !(result & 0xff);
-    nf_ = false;
-    hf_ = ((a_ & 0xf) + (val & 0xf)) > 0xf;
-    cf_ = result > 0xff;
-
-    a_ = result & 0xff;
+    const uint8_t val = GetReg<R>();
+    a_ = flags_.Add(a_, val);
 }
 
 ALWAYS_INLINE void Cpu::Instr_ADD_MEM_HL()
 {
-    const uint8_t val = ReadByte(GetReg(R16::Hl));
-    const uint16_t result = a_ + val;
-
-    zf_ = !(result & 0xff);
-    nf_ = false;
-    hf_ = ((a_ & 0xf) + (val & 0xf)) > 0xf;
-    cf_ = result > 0xff;
-
-    a_ = result & 0xff;
+    const uint8_t val = ReadByte(GetReg<R16::Hl>());
+    a_ = flags_.Add(a_, val);
 }
 
 ALWAYS_INLINE void Cpu::Instr_ADD_N()
 {
     const uint8_t n = ReadOperand();
-    const uint16_t result = a_ + n;
-
-    zf_ = !(result & 0xff);
-    nf_ = false;
-    hf_ = ((a_ & 0xf) + (n & 0xf)) > 0xf;
-    cf_ = result > 0xff;
-
-    a_ = result & 0xff;
+    a_ = flags_.Add(a_, n);
 }
 
 template <R8 R>
 ALWAYS_INLINE void Cpu::Instr_ADC_R()
 {
-    const uint8_t val = GetReg(R);
-    const uint16_t result = a_ + val + cf_;
-
-    zf_ = !(result & 0xff);
-    nf_ = false;
-    hf_ = ((a_ & 0xf) + (val & 0xf) + cf_) > 0xf;
-    cf_ = result > 0xff;
-
-    a_ = result & 0xff;
+    const uint8_t val = GetReg<R>();
+    a_ = flags_.Add(a_, val, flags_.C());
 }
 
 ALWAYS_INLINE void Cpu::Instr_ADC_MEM_HL()
 {
-    const uint8_t val = ReadByte(GetReg(R16::Hl));
-    const uint16_t result = a_ + val + cf_;
-
-    zf_ = !(result & 0xff);
-    nf_ = false;
-    hf_ = ((a_ & 0xf) + (val & 0xf) + cf_) > 0xf;
-    cf_ = result > 0xff;
-
-    a_ = result & 0xff;
+    const uint8_t val = ReadByte(GetReg<R16::Hl>());
+    a_ = flags_.Add(a_, val, flags_.C());
 }
 
 ALWAYS_INLINE void Cpu::Instr_ADC_N()
 {
     const uint8_t n = ReadOperand();
-    const uint16_t result = a_ + n + cf_;
-
-    zf_ = !(result & 0xff);
-    nf_ = false;
-    hf_ = ((a_ & 0xf) + (n & 0xf) + cf_) > 0xf;
-    cf_ = result > 0xff;
-
-    a_ = result & 0xff;
+    a_ = flags_.Add(a_, n, flags_.C());
 }
 
 template <R8 R>
 ALWAYS_INLINE void Cpu::Instr_SUB_R()
 {
-    const uint8_t val = GetReg(R);
-    const uint8_t result = a_ - val;
-
-    zf_ = !result;
-    nf_ = true;
-    hf_ = ((a_ & 0xf) - (val & 0xf)) < 0;
-    cf_ = a_ < val;
-
-    a_ = result;
+    const uint8_t val = GetReg<R>();
+    a_ = flags_.Sub(a_, val);
 }
 
 ALWAYS_INLINE void Cpu::Instr_SUB_MEM_HL()
 {
-    const uint8_t val = ReadByte(GetReg(R16::Hl));
-    const uint16_t result = a_ - val;
-
-    zf_ = !(result & 0xff);
-    nf_ = true;
-    hf_ = ((a_ & 0xf) - (val & 0xf)) < 0;
-    cf_ = a_ < val;
-
-    a_ = result & 0xff;
+    const uint8_t val = ReadByte(GetReg<R16::Hl>());
+    a_ = flags_.Sub(a_, val);
 }
 
 ALWAYS_INLINE void Cpu::Instr_SUB_N()
 {
     const uint8_t n = ReadOperand();
-    const uint16_t result = a_ - n;
-
-    zf_ = !(result & 0xff);
-    nf_ = true;
-    hf_ = ((a_ & 0xf) - (n & 0xf)) < 0;
-    cf_ = a_ < n;
-
-    a_ = result & 0xff;
+    a_ = flags_.Sub(a_, n);
 }
 
 template <R8 R>
 ALWAYS_INLINE void Cpu::Instr_SBC_R()
 {
-    const uint8_t val = GetReg(R);
-    const int result = a_ - val - cf_;
-
-    zf_ = !(result & 0xff);
-    nf_ = true;
-    hf_ = (a_ & 0xf) < ((val & 0xf) + cf_);
-    cf_ = a_ < (val + cf_);
-
-    a_ = result & 0xff;
+    const uint8_t val = GetReg<R>();
+    a_ = flags_.Sub(a_, val, flags_.C());
 }
 
 ALWAYS_INLINE void Cpu::Instr_SBC_MEM_HL()
 {
-    const uint8_t val = ReadByte(GetReg(R16::Hl));
-    const int result = a_ - val - cf_;
-
-    zf_ = !(result & 0xff);
-    nf_ = true;
-    hf_ = (a_ & 0xf) < ((val & 0xf) + cf_);
-    cf_ = a_ < (val + cf_);
-
-    a_ = result & 0xff;
+    const uint8_t val = ReadByte(GetReg<R16::Hl>());
+    a_ = flags_.Sub(a_, val, flags_.C());
 }
 
 ALWAYS_INLINE void Cpu::Instr_SBC_N()
 {
     const uint8_t n = ReadOperand();
-    const uint16_t result = a_ - n - cf_;
-
-    zf_ = !(result & 0xff);
-    nf_ = true;
-    hf_ = ((a_ & 0xf) < ((n & 0xf) + cf_));
-    cf_ = a_ < (n + cf_);
-
-    a_ = result & 0xff;
+    a_ = flags_.Sub(a_, n, flags_.C());
 }
 
 template <R8 R>
 ALWAYS_INLINE void Cpu::Instr_CP_R()
 {
-    const uint8_t val = GetReg(R);
-    const uint8_t result = a_ - val;
-
-    zf_ = !result;
-    nf_ = true;
-    hf_ = (a_ & 0xf) - (val & 0xf) < 0;
-    cf_ = a_ < val;
+    const uint8_t val = GetReg<R>();
+    flags_.Sub(a_, val);
 }
 
 ALWAYS_INLINE void Cpu::Instr_CP_MEM_HL()
 {
-    const uint8_t val = ReadByte(GetReg(R16::Hl));
-    const uint16_t result = a_ - val;
-
-    zf_ = !(result & 0xff);
-    nf_ = true;
-    hf_ = ((a_ & 0xf) - (val & 0xf)) < 0;
-    cf_ = a_ < val;
+    const uint8_t val = ReadByte(GetReg<R16::Hl>());
+    flags_.Sub(a_, val);
 }
 
 ALWAYS_INLINE void Cpu::Instr_CP_N()
 {
     const uint8_t n = ReadOperand();
-    const uint16_t result = a_ - n;
-
-    zf_ = !(result & 0xff);
-    nf_ = true;
-    hf_ = ((a_ & 0xf) - (n & 0xf)) < 0;
-    cf_ = a_ < n;
+    flags_.Sub(a_, n);
 }
 
 template <R8 R>
 ALWAYS_INLINE void Cpu::Instr_INC_R()
 {
-    const uint8_t val = GetReg(R);
-    const uint16_t result = val + 1;
-
-    zf_ = !(result & 0xff);
-    nf_ = false;
-    hf_ = (val & 0xf) == 0xf;
-
-    SetReg(R, result & 0xff);
+    const uint8_t val = GetReg<R>();
+    SetReg<R>(flags_.Inc(val));
 }
 
 ALWAYS_INLINE void Cpu::Instr_INC_MEM_HL()
 {
-    const uint16_t addr = GetReg(R16::Hl);
+    const uint16_t addr = GetReg<R16::Hl>();
     const uint8_t val = ReadByte(addr);
-    const uint16_t result = val + 1;
-
-    zf_ = !(result & 0xff);
-    nf_ = false;
-    hf_ = (val & 0xf) == 0xf;
-
-    WriteByte(addr, result & 0xff);
+    WriteByte(addr, flags_.Inc(val));
 }
 
 template <R8 R>
 ALWAYS_INLINE void Cpu::Instr_DEC_R()
 {
-    const uint8_t val = GetReg(R);
-    const uint8_t result = val - 1;
-
-    zf_ = !result;
-    nf_ = true;
-    hf_ = (result & 0xf) == 0xf;
-
-    SetReg(R, result & 0xff);
+    const uint8_t val = GetReg<R>();
+    SetReg<R>(flags_.Dec(val));
 }
 
 ALWAYS_INLINE void Cpu::Instr_DEC_MEM_HL()
 {
-    const uint16_t addr = GetReg(R16::Hl);
+    const uint16_t addr = GetReg<R16::Hl>();
     const uint8_t val = ReadByte(addr);
-    const uint16_t result = val - 1;
-
-    zf_ = !(result & 0xff);
-    nf_ = true;
-    hf_ = (result & 0xf) == 0xf;
-
-    WriteByte(addr, result & 0xff);
+    WriteByte(addr, flags_.Dec(val));
 }
 
 template <R8 R>
 ALWAYS_INLINE void Cpu::Instr_AND_R()
 {
-    const uint8_t val = GetReg(R);
+    const uint8_t val = GetReg<R>();
     const uint8_t result = a_ & val;
 
-    zf_ = !result;
-    nf_ = false;
-    hf_ = true;
-    cf_ = false;
+    flags_.Set(!result, false, true, false);
 
     a_ = result;
 }
 
 ALWAYS_INLINE void Cpu::Instr_AND_MEM_HL()
 {
-    const uint8_t val = ReadByte(GetReg(R16::Hl));
+    const uint8_t val = ReadByte(GetReg<R16::Hl>());
     const uint8_t result = a_ & val;
 
-    zf_ = !result;
-    nf_ = false;
-    hf_ = true;
-    cf_ = false;
+    flags_.Set(!result, false, true, false);
 
     a_ = result;
 }
@@ -625,10 +747,7 @@ ALWAYS_INLINE void Cpu::Instr_AND_N()
     const uint8_t n = ReadOperand();
     const uint8_t result = a_ & n;
 
-    zf_ = !result;
-    nf_ = false;
-    hf_ = true;
-    cf_ = false;
+    flags_.Set(!result, false, true, false);
 
     a_ = result;
 }
@@ -636,26 +755,20 @@ ALWAYS_INLINE void Cpu::Instr_AND_N()
 template <R8 R>
 ALWAYS_INLINE void Cpu::Instr_OR_R()
 {
-    const uint8_t val = GetReg(R);
+    const uint8_t val = GetReg<R>();
     const uint8_t result = a_ | val;
 
-    zf_ = !result;
-    nf_ = false;
-    hf_ = false;
-    cf_ = false;
+    flags_.Set(!result, false, false, false);
 
     a_ = result;
 }
 
 ALWAYS_INLINE void Cpu::Instr_OR_MEM_HL()
 {
-    const uint8_t val = ReadByte(GetReg(R16::Hl));
+    const uint8_t val = ReadByte(GetReg<R16::Hl>());
     const uint8_t result = a_ | val;
 
-    zf_ = !result;
-    nf_ = false;
-    hf_ = false;
-    cf_ = false;
+    flags_.Set(!result, false, false, false);
 
     a_ = result;
 }
@@ -665,10 +778,7 @@ ALWAYS_INLINE void Cpu::Instr_OR_N()
     const uint8_t n = ReadOperand();
     const uint8_t result = a_ | n;
 
-    zf_ = !result;
-    nf_ = false;
-    hf_ = false;
-    cf_ = false;
+    flags_.Set(!result, false, false, false);
 
     a_ = result;
 }
@@ -676,26 +786,20 @@ ALWAYS_INLINE void Cpu::Instr_OR_N()
 template <R8 R>
 ALWAYS_INLINE void Cpu::Instr_XOR_R()
 {
-    const uint8_t val = GetReg(R);
+    const uint8_t val = GetReg<R>();
     const uint8_t result = a_ ^ val;
 
-    zf_ = !result;
-    nf_ = false;
-    hf_ = false;
-    cf_ = false;
+    flags_.Set(!result, false, false, false);
 
     a_ = result;
 }
 
 ALWAYS_INLINE void Cpu::Instr_XOR_MEM_HL()
 {
-    const uint8_t val = ReadByte(GetReg(R16::Hl));
+    const uint8_t val = ReadByte(GetReg<R16::Hl>());
     const uint8_t result = a_ ^ val;
 
-    zf_ = !result;
-    nf_ = false;
-    hf_ = false;
-    cf_ = false;
+    flags_.Set(!result, false, false, false);
 
     a_ = result;
 }
@@ -705,51 +809,44 @@ ALWAYS_INLINE void Cpu::Instr_XOR_N()
     const uint8_t n = ReadOperand();
     const uint8_t result = a_ ^ n;
 
-    zf_ = !result;
-    nf_ = false;
-    hf_ = false;
-    cf_ = false;
+    flags_.Set(!result, false, false, false);
 
     a_ = result;
 }
 
 ALWAYS_INLINE void Cpu::Instr_CCF()
 {
-    nf_ = false;
-    hf_ = false;
-    cf_ = !cf_;
+    flags_.Set(flags_.Z(), false, false, !flags_.C());
 }
 
 ALWAYS_INLINE void Cpu::Instr_SCF()
 {
-    nf_ = false;
-    hf_ = false;
-    cf_ = true;
+    flags_.Set(flags_.Z(), false, false, true);
 }
 
 ALWAYS_INLINE void Cpu::Instr_DAA()
 {
     uint8_t result = a_;
+    bool carry = flags_.C();
 
     // ref:
     // https://forums.nesdev.org/viewtopic.php?p=196282&sid=38a75719934a07d0ae8ac78a3e1448ad#p196282
-    if (!nf_)
+    if (!flags_.N())
     {
-        if (cf_ || a_ > 0x99)
+        if (carry || a_ > 0x99)
         {
             result += 0x60;
-            cf_ = true;
+            carry = true;
         }
-        if (hf_ || (a_ & 0x0f) > 0x09) { result += 0x6; }
+        if (flags_.H() || (a_ & 0x0f) > 0x09) { result += 0x6; }
     }
     else
     {
-        if (cf_) { result -= 0x60; }
-        if (hf_) { result -= 0x6; }
+        if (carry) { result -= 0x60; }
+        if (flags_.H()) { result -= 0x6; }
     }
 
-    zf_ = !result;
-    hf_ = false;
+    flags_.Set(!result, flags_.N(), false, carry);
 
     a_ = result;
 }
@@ -757,78 +854,69 @@ ALWAYS_INLINE void Cpu::Instr_DAA()
 ALWAYS_INLINE void Cpu::Instr_CPL()
 {
     a_ = ~a_;
-    nf_ = true;
-    hf_ = true;
+    flags_.Set(flags_.Z(), true, true, flags_.C());
 }
 
 template <R16 Dst>
 ALWAYS_INLINE void Cpu::Instr_LD_RR_NN()
 {
-    SetReg(Dst, ReadOperands());
+    SetReg<Dst>(ReadOperands());
 }
 
 ALWAYS_INLINE void Cpu::Instr_LD_MEM_NN_SP() { WriteWord(ReadOperands(), sp_); }
 
-ALWAYS_INLINE void Cpu::Instr_LD_SP_HL() { sp_ = GetReg(R16::Hl); }
+ALWAYS_INLINE void Cpu::Instr_LD_SP_HL() { sp_ = GetReg<R16::Hl>(); }
 
 template <R16 Src>
 ALWAYS_INLINE void Cpu::Instr_PUSH_RR()
 {
-    StackPush(GetReg(Src));
+    StackPush(GetReg<Src>());
 }
 
 template <R16 Dst>
 ALWAYS_INLINE void Cpu::Instr_POP_RR()
 {
-    SetReg(Dst, StackPop());
+    SetReg<Dst>(StackPop());
 }
 
 ALWAYS_INLINE void Cpu::Instr_LD_HL_SP_E()
 {
     const auto e = static_cast<int8_t>(ReadOperand());
 
-    zf_ = false;
-    nf_ = false;
-    hf_ = ((sp_ & 0xf) + (e & 0xf)) > 0xf;
-    cf_ = ((sp_ & 0xff) + (e & 0xff)) > 0xff;
+    flags_.Set(false, false, ((sp_ & 0xf) + (e & 0xf)) > 0xf, ((sp_ & 0xff) + (e & 0xff)) > 0xff);
 
-    SetReg(R16::Hl, sp_ + static_cast<uint16_t>(e));
+    SetReg<R16::Hl>(sp_ + static_cast<uint16_t>(e));
 }
 
 template <R16 RR>
 ALWAYS_INLINE void Cpu::Instr_INC_RR()
 {
-    SetReg(RR, GetReg(RR) + 1);
+    SetReg<RR>(GetReg<RR>() + 1);
 }
 
 template <R16 RR>
 ALWAYS_INLINE void Cpu::Instr_DEC_RR()
 {
-    SetReg(RR, GetReg(RR) - 1);
+    SetReg<RR>(GetReg<RR>() - 1);
 }
 
 template <R16 RR>
 ALWAYS_INLINE void Cpu::Instr_ADD_HL_RR()
 {
-    const uint16_t hl = GetReg(R16::Hl);
-    const uint16_t val = GetReg(RR);
+    const uint16_t hl = GetReg<R16::Hl>();
+    const uint16_t val = GetReg<RR>();
     const int result = hl + val;
 
-    nf_ = false;
-    hf_ = (hl & 0xfff) + (val & 0xfff) > 0xfff;
-    cf_ = result > 0xffff;
+    flags_.Set(flags_.Z(), false, (hl & 0xfff) + (val & 0xfff) > 0xfff, result > 0xffff);
 
-    SetReg(R16::Hl, static_cast<uint16_t>(result));
+    SetReg<R16::Hl>(static_cast<uint16_t>(result));
 }
 
 ALWAYS_INLINE void Cpu::Instr_ADD_SP_E()
 {
     const auto e = static_cast<int8_t>(ReadOperand());
 
-    zf_ = false;
-    nf_ = false;
-    hf_ = ((sp_ & 0xf) + (e & 0xf)) > 0xf;
-    cf_ = ((sp_ & 0xff) + (e & 0xff)) > 0xff;
+    flags_.Set(false, false, ((sp_ & 0xf) + (e & 0xf)) > 0xf, ((sp_ & 0xff) + (e & 0xff)) > 0xff);
 
     sp_ += e;
 }
@@ -839,7 +927,7 @@ ALWAYS_INLINE void Cpu::Instr_JP_NN()
     pc_ = nn;
 }
 
-ALWAYS_INLINE void Cpu::Instr_JP_HL() { pc_ = GetReg(R16::Hl); }
+ALWAYS_INLINE void Cpu::Instr_JP_HL() { pc_ = GetReg<R16::Hl>(); }
 
 template <Condition CC>
 ALWAYS_INLINE void Cpu::Instr_JP_CC_NN()
@@ -939,10 +1027,7 @@ ALWAYS_INLINE void Cpu::Instr_RLCA()
     const bool carry = GetBit<7>(a_);
     const auto result = static_cast<uint8_t>((a_ << 1) | carry);
 
-    zf_ = false;
-    nf_ = false;
-    hf_ = false;
-    cf_ = carry;
+    flags_.Set(false, false, false, carry);
 
     a_ = result;
 }
@@ -952,34 +1037,25 @@ ALWAYS_INLINE void Cpu::Instr_RRCA()
     const bool carry = GetBit<0>(a_);
     const auto result = static_cast<uint8_t>((a_ >> 1) | (carry << 7));
 
-    zf_ = false;
-    nf_ = false;
-    hf_ = false;
-    cf_ = carry;
+    flags_.Set(false, false, false, carry);
 
     a_ = result;
 }
 
 ALWAYS_INLINE void Cpu::Instr_RLA()
 {
-    const auto result = static_cast<uint8_t>((a_ << 1) | cf_);
+    const auto result = static_cast<uint8_t>((a_ << 1) | flags_.C());
 
-    zf_ = false;
-    nf_ = false;
-    hf_ = false;
-    cf_ = GetBit<7>(a_);
+    flags_.Set(false, false, false, GetBit<7>(a_));
 
     a_ = result;
 }
 
 ALWAYS_INLINE void Cpu::Instr_RRA()
 {
-    const auto result = static_cast<uint8_t>((a_ >> 1) | (cf_ << 7));
+    const auto result = static_cast<uint8_t>((a_ >> 1) | (flags_.C() << 7));
 
-    zf_ = false;
-    nf_ = false;
-    hf_ = false;
-    cf_ = GetBit<0>(a_);
+    flags_.Set(false, false, false, GetBit<0>(a_));
 
     a_ = result;
 }
@@ -987,29 +1063,23 @@ ALWAYS_INLINE void Cpu::Instr_RRA()
 template <R8 R>
 ALWAYS_INLINE void Cpu::Instr_RLC_R()
 {
-    const uint8_t val = GetReg(R);
+    const uint8_t val = GetReg<R>();
     const bool carry = GetBit<7>(val);
     const auto result = static_cast<uint8_t>((val << 1) | carry);
 
-    zf_ = !result;
-    nf_ = false;
-    hf_ = false;
-    cf_ = carry;
+    flags_.Set(!result, false, false, carry);
 
-    SetReg(R, result);
+    SetReg<R>(result);
 }
 
 ALWAYS_INLINE void Cpu::Instr_RLC_MEM_HL()
 {
-    const uint16_t addr = GetReg(R16::Hl);
+    const uint16_t addr = GetReg<R16::Hl>();
     const uint8_t val = ReadByte(addr);
     const bool carry = GetBit<7>(val);
     const auto result = static_cast<uint8_t>((val << 1) | carry);
 
-    zf_ = !result;
-    nf_ = false;
-    hf_ = false;
-    cf_ = carry;
+    flags_.Set(!result, false, false, carry);
 
     WriteByte(addr, result);
 }
@@ -1017,29 +1087,23 @@ ALWAYS_INLINE void Cpu::Instr_RLC_MEM_HL()
 template <R8 R>
 ALWAYS_INLINE void Cpu::Instr_RRC_R()
 {
-    const uint8_t val = GetReg(R);
+    const uint8_t val = GetReg<R>();
     const bool carry = GetBit<0>(val);
     const auto result = static_cast<uint8_t>((val >> 1) | (carry << 7));
 
-    zf_ = !result;
-    nf_ = false;
-    hf_ = false;
-    cf_ = carry;
+    flags_.Set(!result, false, false, carry);
 
-    SetReg(R, result);
+    SetReg<R>(result);
 }
 
 ALWAYS_INLINE void Cpu::Instr_RRC_MEM_HL()
 {
-    const uint16_t addr = GetReg(R16::Hl);
+    const uint16_t addr = GetReg<R16::Hl>();
     const uint8_t val = ReadByte(addr);
     const bool carry = GetBit<0>(val);
     const auto result = static_cast<uint8_t>((val >> 1) | (carry << 7));
 
-    zf_ = !result;
-    nf_ = false;
-    hf_ = false;
-    cf_ = carry;
+    flags_.Set(!result, false, false, carry);
 
     WriteByte(addr, result);
 }
@@ -1047,27 +1111,21 @@ ALWAYS_INLINE void Cpu::Instr_RRC_MEM_HL()
 template <R8 R>
 ALWAYS_INLINE void Cpu::Instr_RL_R()
 {
-    const uint8_t val = GetReg(R);
-    const auto result = static_cast<uint8_t>((val << 1) | cf_);
+    const uint8_t val = GetReg<R>();
+    const auto result = static_cast<uint8_t>((val << 1) | flags_.C());
 
-    zf_ = !result;
-    nf_ = false;
-    hf_ = false;
-    cf_ = GetBit<7>(val);
+    flags_.Set(!result, false, false, GetBit<7>(val));
 
-    SetReg(R, result);
+    SetReg<R>(result);
 }
 
 ALWAYS_INLINE void Cpu::Instr_RL_MEM_HL()
 {
-    const uint16_t addr = GetReg(R16::Hl);
+    const uint16_t addr = GetReg<R16::Hl>();
     const uint8_t val = ReadByte(addr);
-    const auto result = static_cast<uint8_t>((val << 1) | cf_);
+    const auto result = static_cast<uint8_t>((val << 1) | flags_.C());
 
-    zf_ = !result;
-    nf_ = false;
-    hf_ = false;
-    cf_ = GetBit<7>(val);
+    flags_.Set(!result, false, false, GetBit<7>(val));
 
     WriteByte(addr, result);
 }
@@ -1075,27 +1133,21 @@ ALWAYS_INLINE void Cpu::Instr_RL_MEM_HL()
 template <R8 R>
 ALWAYS_INLINE void Cpu::Instr_RR_R()
 {
-    const uint8_t val = GetReg(R);
-    const auto result = static_cast<uint8_t>((val >> 1) | (cf_ << 7));
+    const uint8_t val = GetReg<R>();
+    const auto result = static_cast<uint8_t>((val >> 1) | (flags_.C() << 7));
 
-    zf_ = !result;
-    nf_ = false;
-    hf_ = false;
-    cf_ = GetBit<0>(val);
+    flags_.Set(!result, false, false, GetBit<0>(val));
 
-    SetReg(R, result);
+    SetReg<R>(result);
 }
 
 ALWAYS_INLINE void Cpu::Instr_RR_MEM_HL()
 {
-    const uint16_t addr = GetReg(R16::Hl);
+    const uint16_t addr = GetReg<R16::Hl>();
     const uint8_t val = ReadByte(addr);
-    const auto result = static_cast<uint8_t>((val >> 1) | (cf_ << 7));
+    const auto result = static_cast<uint8_t>((val >> 1) | (flags_.C() << 7));
 
-    zf_ = !result;
-    nf_ = false;
-    hf_ = false;
-    cf_ = GetBit<0>(val);
+    flags_.Set(!result, false, false, GetBit<0>(val));
 
     WriteByte(addr, result);
 }
@@ -1103,28 +1155,22 @@ ALWAYS_INLINE void Cpu::Instr_RR_MEM_HL()
 template <R8 R>
 ALWAYS_INLINE void Cpu::Instr_SLA_R()
 {
-    const uint8_t val = GetReg(R);
+    const uint8_t val = GetReg<R>();
     const auto result = static_cast<uint8_t>(val << 1);
 
-    zf_ = !result;
-    nf_ = false;
-    hf_ = false;
-    cf_ = GetBit<7>(val);
+    flags_.Set(!result, false, false, GetBit<7>(val));
 
-    SetReg(R, result);
+    SetReg<R>(result);
 }
 
 ALWAYS_INLINE void Cpu::Instr_SLA_MEM_HL()
 {
-    const uint16_t addr = GetReg(R16::Hl);
+    const uint16_t addr = GetReg<R16::Hl>();
     const uint8_t val = ReadByte(addr);
     const bool carry = GetBit<7>(val);
     const auto result = static_cast<uint8_t>(val << 1);
 
-    zf_ = !result;
-    nf_ = false;
-    hf_ = false;
-    cf_ = carry;
+    flags_.Set(!result, false, false, carry);
 
     WriteByte(addr, result);
 }
@@ -1132,27 +1178,21 @@ ALWAYS_INLINE void Cpu::Instr_SLA_MEM_HL()
 template <R8 R>
 ALWAYS_INLINE void Cpu::Instr_SRA_R()
 {
-    const uint8_t val = GetReg(R);
+    const uint8_t val = GetReg<R>();
     const auto result = static_cast<uint8_t>((val >> 1) | (val & (1 << 7)));
 
-    zf_ = !result;
-    nf_ = false;
-    hf_ = false;
-    cf_ = GetBit<0>(val);
+    flags_.Set(!result, false, false, GetBit<0>(val));
 
-    SetReg(R, result);
+    SetReg<R>(result);
 }
 
 ALWAYS_INLINE void Cpu::Instr_SRA_MEM_HL()
 {
-    const uint16_t addr = GetReg(R16::Hl);
+    const uint16_t addr = GetReg<R16::Hl>();
     const uint8_t val = ReadByte(addr);
     const auto result = static_cast<uint8_t>((val >> 1) | (val & (1 << 7)));
 
-    zf_ = !result;
-    nf_ = false;
-    hf_ = false;
-    cf_ = GetBit<0>(val);
+    flags_.Set(!result, false, false, GetBit<0>(val));
 
     WriteByte(addr, result);
 }
@@ -1160,27 +1200,21 @@ ALWAYS_INLINE void Cpu::Instr_SRA_MEM_HL()
 template <R8 R>
 ALWAYS_INLINE void Cpu::Instr_SWAP_R()
 {
-    const uint8_t val = GetReg(R);
+    const uint8_t val = GetReg<R>();
     const auto result = static_cast<uint8_t>(((val & 0x0f) << 4) | (((val & 0xf0) >> 4) & 0xf));
 
-    zf_ = !result;
-    nf_ = false;
-    hf_ = false;
-    cf_ = false;
+    flags_.Set(!result, false, false, false);
 
-    SetReg(R, result);
+    SetReg<R>(result);
 }
 
 ALWAYS_INLINE void Cpu::Instr_SWAP_MEM_HL()
 {
-    const uint16_t addr = GetReg(R16::Hl);
+    const uint16_t addr = GetReg<R16::Hl>();
     const uint8_t val = ReadByte(addr);
     const auto result = static_cast<uint8_t>(((val & 0x0f) << 4) | (((val & 0xf0) >> 4) & 0xf));
 
-    zf_ = !result;
-    nf_ = false;
-    hf_ = false;
-    cf_ = false;
+    flags_.Set(!result, false, false, false);
 
     WriteByte(addr, result);
 }
@@ -1188,27 +1222,21 @@ ALWAYS_INLINE void Cpu::Instr_SWAP_MEM_HL()
 template <R8 R>
 ALWAYS_INLINE void Cpu::Instr_SRL_R()
 {
-    const uint8_t val = GetReg(R);
+    const uint8_t val = GetReg<R>();
     const uint8_t result = val >> 1;
 
-    zf_ = !result;
-    nf_ = false;
-    hf_ = false;
-    cf_ = GetBit<0>(val);
+    flags_.Set(!result, false, false, GetBit<0>(val));
 
-    SetReg(R, result);
+    SetReg<R>(result);
 }
 
 ALWAYS_INLINE void Cpu::Instr_SRL_MEM_HL()
 {
-    const uint16_t addr = GetReg(R16::Hl);
+    const uint16_t addr = GetReg<R16::Hl>();
     const uint8_t val = ReadByte(addr);
     const uint8_t result = val >> 1;
 
-    zf_ = !result;
-    nf_ = false;
-    hf_ = false;
-    cf_ = GetBit<0>(val);
+    flags_.Set(!result, false, false, GetBit<0>(val));
 
     WriteByte(addr, result);
 }
@@ -1216,31 +1244,27 @@ ALWAYS_INLINE void Cpu::Instr_SRL_MEM_HL()
 template <uint8_t Bit, R8 R>
 ALWAYS_INLINE void Cpu::Instr_BIT_B_R()
 {
-    zf_ = !GetBit<Bit>(GetReg(R));
-    nf_ = false;
-    hf_ = true;
+    flags_.Set(!GetBit<Bit>(GetReg<R>()), false, true, flags_.C());
 }
 
 template <uint8_t Bit>
 ALWAYS_INLINE void Cpu::Instr_BIT_B_MEM_HL()
 {
-    const uint8_t val = ReadByte(GetReg(R16::Hl));
+    const uint8_t val = ReadByte(GetReg<R16::Hl>());
 
-    zf_ = !GetBit<Bit>(val);
-    nf_ = false;
-    hf_ = true;
+    flags_.Set(!GetBit<Bit>(val), false, true, flags_.C());
 }
 
 template <uint8_t Bit, R8 R>
 ALWAYS_INLINE void Cpu::Instr_RES_B_R()
 {
-    SetReg(R, ClearBit<Bit>(GetReg(R)));
+    SetReg<R>(ClearBit<Bit>(GetReg<R>()));
 }
 
 template <uint8_t Bit>
 ALWAYS_INLINE void Cpu::Instr_RES_B_MEM_HL()
 {
-    const uint16_t addr = GetReg(R16::Hl);
+    const uint16_t addr = GetReg<R16::Hl>();
     const uint8_t val = ReadByte(addr);
 
     WriteByte(addr, ClearBit<Bit>(val));
@@ -1249,13 +1273,13 @@ ALWAYS_INLINE void Cpu::Instr_RES_B_MEM_HL()
 template <uint8_t Bit, R8 R>
 ALWAYS_INLINE void Cpu::Instr_SET_B_R()
 {
-    SetReg(R, SetBit<Bit>(GetReg(R)));
+    SetReg<R>(SetBit<Bit>(GetReg<R>()));
 }
 
 template <uint8_t Bit>
 ALWAYS_INLINE void Cpu::Instr_SET_B_MEM_HL()
 {
-    const uint16_t addr = GetReg(R16::Hl);
+    const uint16_t addr = GetReg<R16::Hl>();
     const uint8_t val = ReadByte(addr);
 
     WriteByte(addr, SetBit<Bit>(val));
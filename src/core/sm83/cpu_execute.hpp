@@ -0,0 +1,188 @@
+#pragma once
+
+// Compile-time opcode decoding shared by the interpreter dispatch engines and by ahead-of-time
+// recompiled ROMs, which include this header.
+
+#include <array>
+
+#include "core/sm83/cpu.hpp"
+
+namespace gb::sm83
+{
+namespace detail
+{
+// Register operand encoding used by the opcode bit fields, index 6 is (HL) and has no R8.
+constexpr std::array<R8, 8> kOperandR8 = {R8::B, R8::C, R8::D, R8::E, R8::H, R8::L, R8::F, R8::A};
+constexpr std::array<R16, 4> kOperandR16 = {R16::Bc, R16::De, R16::Hl, R16::Sp};
+constexpr std::array<R16, 4> kOperandR16Stack = {R16::Bc, R16::De, R16::Hl, R16::Af};
+constexpr uint8_t kOperandMemHl = 6;
+}  // namespace detail
+
+// Opcode field layout: xx yyy zzz, with p = yyy >> 1 and q = yyy & 1.
+// ref: https://gb-archive.github.io/salvage/decoding_gbz80_opcodes/Decoding%20Gamboy%20Z80%20Opcodes.html
+template <uint8_t Opcode>
+ALWAYS_INLINE void Cpu::ExecuteOpcode()
+{
+    constexpr uint8_t kX = Opcode >> 6;
+    constexpr uint8_t kY = (Opcode >> 3) & 7;
+    constexpr uint8_t kZ = Opcode & 7;
+    constexpr uint8_t kP = kY >> 1;
+    constexpr uint8_t kQ = kY & 1;
+
+    if constexpr (Opcode == 0x00) { Instr_NOP(); }
+    else if constexpr (Opcode == 0x08) { Instr_LD_MEM_NN_SP(); }
+    else if constexpr (Opcode == 0x10) { Instr_STOP(); }
+    else if constexpr (Opcode == 0x18) { Instr_JR_E(); }
+    else if constexpr (kX == 0 && kZ == 0) { Instr_JR_CC_E<static_cast<Condition>(kY - 4)>(); }
+    else if constexpr (kX == 0 && kZ == 1 && kQ == 0) { Instr_LD_RR_NN<detail::kOperandR16[kP]>(); }
+    else if constexpr (kX == 0 && kZ == 1) { Instr_ADD_HL_RR<detail::kOperandR16[kP]>(); }
+    else if constexpr (Opcode == 0x02) { Instr_LD_MEM_RR_A<R16::Bc>(); }
+    else if constexpr (Opcode == 0x12) { Instr_LD_MEM_RR_A<R16::De>(); }
+    else if constexpr (Opcode == 0x22) { Instr_LD_MEM_HL_INC_A(); }
+    else if constexpr (Opcode == 0x32) { Instr_LD_MEM_HL_DEC_A(); }
+    else if constexpr (Opcode == 0x0a) { Instr_LD_A_MEM_RR<R16::Bc>(); }
+    else if constexpr (Opcode == 0x1a) { Instr_LD_A_MEM_RR<R16::De>(); }
+    else if constexpr (Opcode == 0x2a) { Instr_LD_A_MEM_HL_INC(); }
+    else if constexpr (Opcode == 0x3a) { Instr_LD_A_MEM_HL_DEC(); }
+    else if constexpr (kX == 0 && kZ == 3 && kQ == 0) { Instr_INC_RR<detail::kOperandR16[kP]>(); }
+    else if constexpr (kX == 0 && kZ == 3) { Instr_DEC_RR<detail::kOperandR16[kP]>(); }
+    else if constexpr (Opcode == 0x34) { Instr_INC_MEM_HL(); }
+    else if constexpr (kX == 0 && kZ == 4) { Instr_INC_R<detail::kOperandR8[kY]>(); }
+    else if constexpr (Opcode == 0x35) { Instr_DEC_MEM_HL(); }
+    else if constexpr (kX == 0 && kZ == 5) { Instr_DEC_R<detail::kOperandR8[kY]>(); }
+    else if constexpr (Opcode == 0x36) { Instr_LD_MEM_HL_N(); }
+    else if constexpr (kX == 0 && kZ == 6) { Instr_LD_R_N<detail::kOperandR8[kY]>(); }
+    else if constexpr (Opcode == 0x07) { Instr_RLCA(); }
+    else if constexpr (Opcode == 0x0f) { Instr_RRCA(); }
+    else if constexpr (Opcode == 0x17) { Instr_RLA(); }
+    else if constexpr (Opcode == 0x1f) { Instr_RRA(); }
+    else if constexpr (Opcode == 0x27) { Instr_DAA(); }
+    else if constexpr (Opcode == 0x2f) { Instr_CPL(); }
+    else if constexpr (Opcode == 0x37) { Instr_SCF(); }
+    else if constexpr (Opcode == 0x3f) { Instr_CCF(); }
+    else if constexpr (Opcode == 0x76) { Instr_HALT(); }
+    else if constexpr (kX == 1 && kY == detail::kOperandMemHl) { Instr_LD_MEM_HL_R<detail::kOperandR8[kZ]>(); }
+    else if constexpr (kX == 1 && kZ == detail::kOperandMemHl) { Instr_LD_R_MEM_HL<detail::kOperandR8[kY]>(); }
+    else if constexpr (kX == 1) { Instr_LD_R_R<detail::kOperandR8[kY], detail::kOperandR8[kZ]>(); }
+    else if constexpr (Opcode == 0x86) { Instr_ADD_MEM_HL(); }
+    else if constexpr (Opcode == 0x8e) { Instr_ADC_MEM_HL(); }
+    else if constexpr (Opcode == 0x96) { Instr_SUB_MEM_HL(); }
+    else if constexpr (Opcode == 0x9e) { Instr_SBC_MEM_HL(); }
+    else if constexpr (Opcode == 0xa6) { Instr_AND_MEM_HL(); }
+    else if constexpr (Opcode == 0xae) { Instr_XOR_MEM_HL(); }
+    else if constexpr (Opcode == 0xb6) { Instr_OR_MEM_HL(); }
+    else if constexpr (Opcode == 0xbe) { Instr_CP_MEM_HL(); }
+    else if constexpr (kX == 2 && kY == 0) { Instr_ADD_R<detail::kOperandR8[kZ]>(); }
+    else if constexpr (kX == 2 && kY == 1) { Instr_ADC_R<detail::kOperandR8[kZ]>(); }
+    else if constexpr (kX == 2 && kY == 2) { Instr_SUB_R<detail::kOperandR8[kZ]>(); }
+    else if constexpr (kX == 2 && kY == 3) { Instr_SBC_R<detail::kOperandR8[kZ]>(); }
+    else if constexpr (kX == 2 && kY == 4) { Instr_AND_R<detail::kOperandR8[kZ]>(); }
+    else if constexpr (kX == 2 && kY == 5) { Instr_XOR_R<detail::kOperandR8[kZ]>(); }
+    else if constexpr (kX == 2 && kY == 6) { Instr_OR_R<detail::kOperandR8[kZ]>(); }
+    else if constexpr (kX == 2 && kY == 7) { Instr_CP_R<detail::kOperandR8[kZ]>(); }
+    else if constexpr (Opcode == 0xe0) { Instr_LDH_MEM_N_A(); }
+    else if constexpr (Opcode == 0xe8) { Instr_ADD_SP_E(); }
+    else if constexpr (Opcode == 0xf0) { Instr_LDH_A_MEM_N(); }
+    else if constexpr (Opcode == 0xf8) { Instr_LD_HL_SP_E(); }
+    else if constexpr (kX == 3 && kZ == 0) { Instr_RET_CC<static_cast<Condition>(kY)>(); }
+    else if constexpr (kX == 3 && kZ == 1 && kQ == 0) { Instr_POP_RR<detail::kOperandR16Stack[kP]>(); }
+    else if constexpr (Opcode == 0xc9) { Instr_RET(); }
+    else if constexpr (Opcode == 0xd9) { Instr_RETI(); }
+    else if constexpr (Opcode == 0xe9) { Instr_JP_HL(); }
+    else if constexpr (Opcode == 0xf9) { Instr_LD_SP_HL(); }
+    else if constexpr (Opcode == 0xe2) { Instr_LDH_MEM_C_A(); }
+    else if constexpr (Opcode == 0xea) { Instr_LD_MEM_NN_A(); }
+    else if constexpr (Opcode == 0xf2) { Instr_LDH_A_MEM_C(); }
+    else if constexpr (Opcode == 0xfa) { Instr_LD_A_MEM_NN(); }
+    else if constexpr (kX == 3 && kZ == 2) { Instr_JP_CC_NN<static_cast<Condition>(kY)>(); }
+    else if constexpr (Opcode == 0xc3) { Instr_JP_NN(); }
+    else if constexpr (Opcode == 0xcb) { InterpretCbInstruction(); }
+    else if constexpr (Opcode == 0xf3) { Instr_DI(); }
+    else if constexpr (Opcode == 0xfb) { Instr_EI(); }
+    else if constexpr (kX == 3 && kZ == 4 && kY < 4) { Instr_CALL_CC_NN<static_cast<Condition>(kY)>(); }
+    else if constexpr (kX == 3 && kZ == 5 && kQ == 0) { Instr_PUSH_RR<detail::kOperandR16Stack[kP]>(); }
+    else if constexpr (Opcode == 0xcd) { Instr_CALL_NN(); }
+    else if constexpr (kX == 3 && kZ == 6 && kY == 0) { Instr_ADD_N(); }
+    else if constexpr (kX == 3 && kZ == 6 && kY == 1) { Instr_ADC_N(); }
+    else if constexpr (kX == 3 && kZ == 6 && kY == 2) { Instr_SUB_N(); }
+    else if constexpr (kX == 3 && kZ == 6 && kY == 3) { Instr_SBC_N(); }
+    else if constexpr (kX == 3 && kZ == 6 && kY == 4) { Instr_AND_N(); }
+    else if constexpr (kX == 3 && kZ == 6 && kY == 5) { Instr_XOR_N(); }
+    else if constexpr (kX == 3 && kZ == 6 && kY == 6) { Instr_OR_N(); }
+    else if constexpr (kX == 3 && kZ == 6 && kY == 7) { Instr_CP_N(); }
+    else if constexpr (kX == 3 && kZ == 7) { Instr_RST_N<kY * 8>(); }
+    else
+    {
+        // Unusable opcodes (0xd3, 0xdb, 0xdd, 0xe3, 0xe4, 0xeb, 0xec, 0xed, 0xf4, 0xfc, 0xfd)
+    }
+}
+
+template <uint8_t Opcode>
+ALWAYS_INLINE void Cpu::ExecuteCbOpcode()
+{
+    constexpr uint8_t kX = Opcode >> 6;
+    constexpr uint8_t kY = (Opcode >> 3) & 7;
+    constexpr uint8_t kZ = Opcode & 7;
+    constexpr R8 kR = detail::kOperandR8[kZ];
+
+    if constexpr (kZ == detail::kOperandMemHl)
+    {
+        if constexpr (kX == 0 && kY == 0) { Instr_RLC_MEM_HL(); }
+        else if constexpr (kX == 0 && kY == 1) { Instr_RRC_MEM_HL(); }
+        else if constexpr (kX == 0 && kY == 2) { Instr_RL_MEM_HL(); }
+        else if constexpr (kX == 0 && kY == 3) { Instr_RR_MEM_HL(); }
+        else if constexpr (kX == 0 && kY == 4) { Instr_SLA_MEM_HL(); }
+        else if constexpr (kX == 0 && kY == 5) { Instr_SRA_MEM_HL(); }
+        else if constexpr (kX == 0 && kY == 6) { Instr_SWAP_MEM_HL(); }
+        else if constexpr (kX == 0 && kY == 7) { Instr_SRL_MEM_HL(); }
+        else if constexpr (kX == 1) { Instr_BIT_B_MEM_HL<kY>(); }
+        else if constexpr (kX == 2) { Instr_RES_B_MEM_HL<kY>(); }
+        else { Instr_SET_B_MEM_HL<kY>(); }
+    }
+    else
+    {
+        if constexpr (kX == 0 && kY == 0) { Instr_RLC_R<kR>(); }
+        else if constexpr (kX == 0 && kY == 1) { Instr_RRC_R<kR>(); }
+        else if constexpr (kX == 0 && kY == 2) { Instr_RL_R<kR>(); }
+        else if constexpr (kX == 0 && kY == 3) { Instr_RR_R<kR>(); }
+        else if constexpr (kX == 0 && kY == 4) { Instr_SLA_R<kR>(); }
+        else if constexpr (kX == 0 && kY == 5) { Instr_SRA_R<kR>(); }
+        else if constexpr (kX == 0 && kY == 6) { Instr_SWAP_R<kR>(); }
+        else if constexpr (kX == 0 && kY == 7) { Instr_SRL_R<kR>(); }
+        else if constexpr (kX == 1) { Instr_BIT_B_R<kY, kR>(); }
+        else if constexpr (kX == 2) { Instr_RES_B_R<kY, kR>(); }
+        else { Instr_SET_B_R<kY, kR>(); }
+    }
+}
+
+template <uint8_t Opcode>
+ALWAYS_INLINE bool Cpu::StepCompiled(uint32_t operands)
+{
+    cycles_ = 0;
+
+    // Opcode fetch
+    Tick4();
+    ++pc_;
+
+    const std::array<uint8_t, 2> operand_bytes = {static_cast<uint8_t>(operands & 0xff),
+                                                  static_cast<uint8_t>(operands >> 8)};
+    prefetched_operands_ = operand_bytes.data();
+    ExecuteOpcode<Opcode>();
+    prefetched_operands_ = nullptr;
+
+    ime_ |= ime_next_;
+    ime_next_ = false;
+
+    bus_.Tick(cycles_);
+    run_cycles_ += cycles_;
+
+    return ShouldLeaveCompiledCode();
+}
+
+ALWAYS_INLINE bool Cpu::ShouldLeaveCompiledCode() const
+{
+    return run_cycles_ >= run_budget_ || bus_.ppu.ShouldDrawFrame() || halt_ || halt_bug_ ||
+           (ime_ && bus_.GetPendingInterrupts()) || leave_compiled_code_ ||
+           bus_.oam_dma.active;
+}
+}  // namespace gb::sm83
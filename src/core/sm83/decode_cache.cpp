@@ -0,0 +1,79 @@
+#include "core/sm83/decode_cache.hpp"
+
+namespace gb::sm83
+{
+std::vector<DecodedInstruction> DecodeBasicBlock(const memory::Bus& bus, uint16_t pc,
+                                                 uint32_t region_end)
+{
+    return DecodeBasicBlock([&](uint16_t addr) { return bus.ReadByte(addr); }, pc, region_end);
+}
+
+const DecodedInstruction* DecodeCache::FetchBlock(const memory::Bus& bus, uint16_t pc)
+{
+    cursor_ = cursor_end_ = nullptr;
+
+    const Block* block = FindOrDecodeBlock(bus, pc);
+    // The first instruction may straddle the end of its region, leaving the block empty.
+    if (block == nullptr || block->empty()) { return nullptr; }
+
+    cursor_ = block->data();
+    cursor_end_ = block->data() + block->size();
+    return cursor_++;
+}
+
+const DecodeCache::Block* DecodeCache::FindOrDecodeBlock(const memory::Bus& bus, uint16_t pc)
+{
+#ifdef GBCXX_TESTS
+    // The single-step tests' bus is a flat 64KiB RAM without a cartridge.
+    if (bus.flat_memory) { return FindOrDecodeRamBlock(bus, pc, 0x10000); }
+#endif
+    if (pc < 0x4000) { return FindOrDecodeRomBlock(bus, pc, 0x4000); }
+    if (pc <= kCartridgeEnd) { return FindOrDecodeRomBlock(bus, pc, kCartridgeEnd + 1); }
+    if (pc >= kWorkRamStart && pc <= kWorkRamEnd)
+    {
+        return FindOrDecodeRamBlock(bus, pc, kWorkRamEnd + 1);
+    }
+    if (pc >= kHighRamStart && pc <= kHighRamEnd)
+    {
+        return FindOrDecodeRamBlock(bus, pc, kHighRamEnd + 1);
+    }
+    return nullptr;
+}
+
+const DecodeCache::Block* DecodeCache::FindOrDecodeRomBlock(const memory::Bus& bus, uint16_t pc,
+                                                            uint32_t region_end)
+{
+    const auto key = static_cast<uint32_t>((bus.cartridge.GetRomBank(pc) << 16) | pc);
+    auto it = rom_blocks_.find(key);
+    if (it == rom_blocks_.end())
+    {
+        it = rom_blocks_.emplace(key, DecodeBasicBlock(bus, pc, region_end)).first;
+    }
+    return &it->second;
+}
+
+const DecodeCache::Block* DecodeCache::FindOrDecodeRamBlock(const memory::Bus& bus, uint16_t pc,
+                                                            uint32_t region_end)
+{
+    auto it = ram_blocks_.find(pc);
+    if (it == ram_blocks_.end())
+    {
+        it = ram_blocks_.emplace(pc, DecodeBasicBlock(bus, pc, region_end)).first;
+        for (const DecodedInstruction& instr : it->second)
+        {
+            for (uint32_t addr = instr.pc; addr < instr.pc + instr.length; ++addr)
+            {
+                ram_code_[addr] = true;
+            }
+        }
+    }
+    return &it->second;
+}
+
+void DecodeCache::InvalidateRam()
+{
+    ram_blocks_.clear();
+    ram_code_.reset();
+    cursor_ = cursor_end_ = nullptr;
+}
+}  // namespace gb::sm83
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <array>
+#include <bitset>
+#include <concepts>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "core/constants.hpp"
+#include "core/memory/bus.hpp"
+#include "core/sm83/opcode_info.hpp"
+#include "core/util.hpp"
+
+namespace gb::sm83
+{
+struct DecodedInstruction
+{
+    uint16_t pc{};
+    uint8_t opcode{};
+    uint8_t length{};
+    // Immediate bytes following the opcode, for CB-prefixed instructions the first byte holds the
+    // CB opcode.
+    std::array<uint8_t, 2> operands{};
+};
+
+constexpr size_t kMaxBasicBlockLength = 64;
+
+// Decodes instructions starting at pc up to and including the first control flow instruction.
+// Decoding stops early after kMaxBasicBlockLength instructions or before an instruction that would
+// extend past region_end, so the block may be empty. read_byte maps an address to its value.
+template <std::invocable<uint16_t> ReadByteFn>
+[[nodiscard]] std::vector<DecodedInstruction> DecodeBasicBlock(ReadByteFn&& read_byte, uint16_t pc,
+                                                               uint32_t region_end)
+{
+    std::vector<DecodedInstruction> block;
+    uint32_t addr = pc;
+
+    while (block.size() < kMaxBasicBlockLength)
+    {
+        const uint8_t opcode = read_byte(static_cast<uint16_t>(addr));
+        const uint8_t length = kInstructionLength[opcode];
+        if (addr + length > region_end) { break; }
+
+        DecodedInstruction& instr = block.emplace_back(static_cast<uint16_t>(addr), opcode, length);
+        for (uint8_t i = 1; i < length; ++i)
+        {
+            instr.operands[i - 1] = read_byte(static_cast<uint16_t>(addr + i));
+        }
+
+        addr += length;
+        if (kEndsBasicBlock[opcode]) { break; }
+    }
+
+    return block;
+}
+
+[[nodiscard]] std::vector<DecodedInstruction> DecodeBasicBlock(const memory::Bus& bus, uint16_t pc,
+                                                               uint32_t region_end);
+
+// Caches straight-line runs of instructions that have already been fetched and decoded, so hot
+// loops skip the bus walk on every step. ROM blocks are keyed by (bank, PC) and never go stale,
+// blocks decoded from WRAM/HRAM are dropped as soon as one of their bytes is written.
+class DecodeCache
+{
+public:
+    // Returns the decoded instruction at pc, decoding its basic block on first use. Returns nullptr
+    // when pc is outside of ROM, WRAM and HRAM, which are always interpreted from the bus.
+    ALWAYS_INLINE const DecodedInstruction* Fetch(const memory::Bus& bus, uint16_t pc)
+    {
+        if (cursor_ != cursor_end_ && cursor_->pc == pc) [[likely]] { return cursor_++; }
+        return FetchBlock(bus, pc);
+    }
+
+    // Must be called after every CPU write so that stale blocks are never executed.
+    ALWAYS_INLINE void OnWrite(uint16_t addr)
+    {
+        // MBC register write, the bank mapped under the cursor may have changed.
+        if (addr <= kCartridgeEnd) { cursor_ = cursor_end_ = nullptr; }
+        // Echo RAM writes land in the WRAM they mirror. Blocks are never decoded from echo RAM
+        // itself, except on the flat test bus, where checking both is merely conservative.
+        const bool echo = addr >= kEchoRamStart && addr <= kEchoRamEnd;
+        const bool writes_code =
+            ram_code_[addr] || (echo && ram_code_[addr - (kEchoRamStart - kWorkRamStart)]);
+        if (writes_code) [[unlikely]] { InvalidateRam(); }
+    }
+
+private:
+    using Block = std::vector<DecodedInstruction>;
+
+    const DecodedInstruction* FetchBlock(const memory::Bus& bus, uint16_t pc);
+    const Block* FindOrDecodeBlock(const memory::Bus& bus, uint16_t pc);
+    const Block* FindOrDecodeRomBlock(const memory::Bus& bus, uint16_t pc, uint32_t region_end);
+    const Block* FindOrDecodeRamBlock(const memory::Bus& bus, uint16_t pc, uint32_t region_end);
+    void InvalidateRam();
+
+    std::unordered_map<uint32_t, Block> rom_blocks_;
+    std::unordered_map<uint16_t, Block> ram_blocks_;
+    // Bytes of RAM that belong to at least one cached block.
+    std::bitset<0x10000> ram_code_;
+
+    const DecodedInstruction* cursor_{};
+    const DecodedInstruction* cursor_end_{};
+};
+}  // namespace gb::sm83
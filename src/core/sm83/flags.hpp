@@ -0,0 +1,194 @@
+#pragma once
+
+#include <cstdint>
+
+#include "core/util.hpp"
+
+namespace gb::sm83
+{
+class Jit;
+
+// The Z, N, H and C flags of the F register. Arithmetic records its operands through Add(),
+// Sub(), Inc() and Dec(), everything else sets the flags directly.
+//
+// With GBCXX_LAZY_FLAGS, Add() and friends only remember the last operation and its operands, and
+// H and C are derived from them when something reads them, i.e. a conditional instruction, ADC,
+// SBC, DAA, PUSH AF or GetReg(R8::F). Most arithmetic results are overwritten before that happens.
+// Z and N are cheap enough to always store directly.
+class Flags
+{
+public:
+    [[nodiscard]] bool Z() const { return !zero_src_; }
+    [[nodiscard]] bool N() const { return nf_; }
+    [[nodiscard]] bool H() const;
+    [[nodiscard]] bool C() const;
+
+    [[nodiscard]] uint8_t Get() const
+    {
+        return static_cast<uint8_t>((Z() << 7) | (N() << 6) | (H() << 5) | (C() << 4));
+    }
+
+    void Set(uint8_t f) { Set(GetBit<7>(f), GetBit<6>(f), GetBit<5>(f), GetBit<4>(f)); }
+
+    void Set(bool z, bool n, bool h, bool c)
+    {
+#ifdef GBCXX_LAZY_FLAGS
+        op_ = Op::None;
+#endif
+        zero_src_ = !z;
+        nf_ = n;
+        hf_ = h;
+        cf_ = c;
+    }
+
+    // 8-bit arithmetic, returns the result and sets all flags, except for Inc() and Dec() which
+    // leave C untouched.
+    uint8_t Add(uint8_t lhs, uint8_t rhs, bool carry = false);
+    uint8_t Sub(uint8_t lhs, uint8_t rhs, bool carry = false);
+    uint8_t Inc(uint8_t val);
+    uint8_t Dec(uint8_t val);
+
+private:
+    // Generated code reads and writes the flags in place.
+    friend class Jit;
+
+#ifdef GBCXX_LAZY_FLAGS
+    enum class Op : uint8_t
+    {
+        None,
+        Add,
+        Sub,
+        Inc,
+        Dec
+    };
+
+    Op op_{Op::None};
+    uint8_t lhs_{};
+    uint8_t rhs_{};
+    bool carry_{};
+#endif
+
+    // Z is set when this is zero.
+    uint8_t zero_src_{};
+    bool nf_{false};
+    bool hf_{true};
+    bool cf_{true};
+};
+
+#ifdef GBCXX_LAZY_FLAGS
+ALWAYS_INLINE bool Flags::H() const
+{
+    switch (op_)
+    {
+    case Op::None: return hf_;
+    case Op::Add: return ((lhs_ & 0xf) + (rhs_ & 0xf) + carry_) > 0xf;
+    case Op::Sub: return (lhs_ & 0xf) < ((rhs_ & 0xf) + carry_);
+    case Op::Inc: return (lhs_ & 0xf) == 0xf;
+    case Op::Dec: return (lhs_ & 0xf) == 0;
+    }
+    std::unreachable();
+}
+
+ALWAYS_INLINE bool Flags::C() const
+{
+    switch (op_)
+    {
+    case Op::Add: return (lhs_ + rhs_ + carry_) > 0xff;
+    case Op::Sub: return lhs_ < (rhs_ + carry_);
+    case Op::None:
+    case Op::Inc:
+    case Op::Dec: return cf_;
+    }
+    std::unreachable();
+}
+
+ALWAYS_INLINE uint8_t Flags::Add(uint8_t lhs, uint8_t rhs, bool carry)
+{
+    const auto result = static_cast<uint8_t>(lhs + rhs + carry);
+    op_ = Op::Add;
+    lhs_ = lhs;
+    rhs_ = rhs;
+    carry_ = carry;
+    zero_src_ = result;
+    nf_ = false;
+    return result;
+}
+
+ALWAYS_INLINE uint8_t Flags::Sub(uint8_t lhs, uint8_t rhs, bool carry)
+{
+    const auto result = static_cast<uint8_t>(lhs - rhs - carry);
+    op_ = Op::Sub;
+    lhs_ = lhs;
+    rhs_ = rhs;
+    carry_ = carry;
+    zero_src_ = result;
+    nf_ = true;
+    return result;
+}
+
+ALWAYS_INLINE uint8_t Flags::Inc(uint8_t val)
+{
+    const auto result = static_cast<uint8_t>(val + 1);
+    // C survives INC, so it has to be resolved before the operands it depends on are replaced.
+    cf_ = C();
+    op_ = Op::Inc;
+    lhs_ = val;
+    zero_src_ = result;
+    nf_ = false;
+    return result;
+}
+
+ALWAYS_INLINE uint8_t Flags::Dec(uint8_t val)
+{
+    const auto result = static_cast<uint8_t>(val - 1);
+    cf_ = C();
+    op_ = Op::Dec;
+    lhs_ = val;
+    zero_src_ = result;
+    nf_ = true;
+    return result;
+}
+#else
+ALWAYS_INLINE bool Flags::H() const { return hf_; }
+
+ALWAYS_INLINE bool Flags::C() const { return cf_; }
+
+ALWAYS_INLINE uint8_t Flags::Add(uint8_t lhs, uint8_t rhs, bool carry)
+{
+    const auto result = static_cast<uint8_t>(lhs + rhs + carry);
+    zero_src_ = result;
+    nf_ = false;
+    hf_ = ((lhs & 0xf) + (rhs & 0xf) + carry) > 0xf;
+    cf_ = (lhs + rhs + carry) > 0xff;
+    return result;
+}
+
+ALWAYS_INLINE uint8_t Flags::Sub(uint8_t lhs, uint8_t rhs, bool carry)
+{
+    const auto result = static_cast<uint8_t>(lhs - rhs - carry);
+    zero_src_ = result;
+    nf_ = true;
+    hf_ = (lhs & 0xf) < ((rhs & 0xf) + carry);
+    cf_ = lhs < (rhs + carry);
+    return result;
+}
+
+ALWAYS_INLINE uint8_t Flags::Inc(uint8_t val)
+{
+    const auto result = static_cast<uint8_t>(val + 1);
+    zero_src_ = result;
+    nf_ = false;
+    hf_ = (val & 0xf) == 0xf;
+    return result;
+}
+
+ALWAYS_INLINE uint8_t Flags::Dec(uint8_t val)
+{
+    const auto result = static_cast<uint8_t>(val - 1);
+    zero_src_ = result;
+    nf_ = true;
+    hf_ = (val & 0xf) == 0;
+    return result;
+}
+#endif
+}  // namespace gb::sm83
@@ -0,0 +1,1282 @@
+#ifdef GBCXX_JIT
+#include "core/sm83/jit.hpp"
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <initializer_list>
+#include <limits>
+#include <span>
+#include <utility>
+
+#include "core/constants.hpp"
+#include "core/sm83/cpu_execute.hpp"
+#include "core/sm83/decode_cache.hpp"
+
+#ifdef GBCXX_LAZY_FLAGS
+#error "GBCXX_JIT can't be combined with GBCXX_LAZY_FLAGS"
+#endif
+
+namespace gb::sm83
+{
+namespace
+{
+constexpr size_t kCodeSize = 4_MiB;
+
+// Lookups of a block start before it's compiled. Tests compile everything right away, so that the
+// single-step tests run compiled code.
+#ifdef GBCXX_TESTS
+constexpr uint8_t kHotThreshold = 0;
+#else
+constexpr uint8_t kHotThreshold = 16;
+#endif
+constexpr uint8_t kNeverCompiled = 0xff;
+
+// x86-64 general purpose registers, in encoding order.
+enum Reg : uint8_t
+{
+    kRax,
+    kRcx,
+    kRdx,
+    kRbx,
+    kRsp,
+    kRbp,
+    kRsi,
+    kRdi,
+    kR8,
+    kR9,
+    kR10,
+    kR11,
+    kR12,
+    kR13,
+    kR14,
+    kR15
+};
+
+// Condition codes of Jcc and SETcc.
+enum Cond : uint8_t
+{
+    kBelow = 0x2,
+    kEqual = 0x4,
+    kNotEqual = 0x5,
+    kLessEqual = 0xe
+};
+
+enum class Width : uint8_t
+{
+    k8,
+    k16,
+    k32,
+    k64
+};
+
+struct Label
+{
+    static constexpr size_t kUnbound = std::numeric_limits<size_t>::max();
+
+    size_t pos{kUnbound};
+    // Offsets of the rel32 fields jumping here.
+    std::vector<size_t> fixups;
+};
+
+// Encodes the few x86-64 instructions the translator needs. Memory operands are always
+// [rbx + disp32], rbx holding the Cpu.
+class Emitter
+{
+public:
+    [[nodiscard]] std::vector<uint8_t> Take() && { return std::move(code_); }
+
+    void Bytes(std::initializer_list<uint8_t> bytes) { code_.insert(code_.end(), bytes); }
+    void Imm8(uint8_t imm) { code_.push_back(imm); }
+    void Imm16(uint16_t imm) { Put(imm); }
+    void Imm32(uint32_t imm) { Put(imm); }
+    void Imm64(uint64_t imm) { Put(imm); }
+
+    // opcode reg, [rbx + disp], where reg may also be an opcode extension.
+    void Mem(Width width, std::initializer_list<uint8_t> opcode, uint8_t reg, int32_t disp)
+    {
+        Prefix(width, reg, kRbx);
+        Bytes(opcode);
+        Imm8(static_cast<uint8_t>(0x80 | ((reg & 7) << 3) | kRbx));
+        Imm32(static_cast<uint32_t>(disp));
+    }
+
+    // opcode rm, reg on registers. Byte registers are limited to al, cl and dl, as the others
+    // would need a REX prefix.
+    void Reg(Width width, std::initializer_list<uint8_t> opcode, uint8_t reg, uint8_t rm)
+    {
+        Prefix(width, reg, rm);
+        Bytes(opcode);
+        Imm8(static_cast<uint8_t>(0xc0 | ((reg & 7) << 3) | (rm & 7)));
+    }
+
+    void MovImm32(uint8_t reg, uint32_t imm)
+    {
+        Prefix(Width::k32, 0, reg);
+        Imm8(static_cast<uint8_t>(0xb8 + (reg & 7)));
+        Imm32(imm);
+    }
+
+    // The code is copied once it's complete, so calls go through an absolute address.
+    void Call(uintptr_t fn)
+    {
+        Bytes({0x48, 0xb8});  // mov rax, fn
+        Imm64(fn);
+        Bytes({0xff, 0xd0});  // call rax
+    }
+
+    void Jcc(Cond cond, Label& label)
+    {
+        Bytes({0x0f, static_cast<uint8_t>(0x80 | cond)});
+        Rel32(label);
+    }
+
+    void Jmp(Label& label)
+    {
+        Imm8(0xe9);
+        Rel32(label);
+    }
+
+    void Bind(Label& label)
+    {
+        label.pos = code_.size();
+        for (const size_t fixup : label.fixups) { Patch(fixup, label.pos); }
+    }
+
+private:
+    void Prefix(Width width, uint8_t reg, uint8_t rm)
+    {
+        if (width == Width::k16) { Imm8(0x66); }
+        const auto rex = static_cast<uint8_t>(0x40 | (width == Width::k64 ? 8 : 0) |
+                                              (reg >= 8 ? 4 : 0) | (rm >= 8 ? 1 : 0));
+        if (rex != 0x40) { Imm8(rex); }
+    }
+
+    void Rel32(Label& label)
+    {
+        const size_t fixup = code_.size();
+        Imm32(0);
+        if (label.pos == Label::kUnbound) { label.fixups.push_back(fixup); }
+        else { Patch(fixup, label.pos); }
+    }
+
+    void Patch(size_t fixup, size_t target)
+    {
+        const auto rel = static_cast<int32_t>(static_cast<int64_t>(target) -
+                                              static_cast<int64_t>(fixup + sizeof(int32_t)));
+        std::memcpy(&code_[fixup], &rel, sizeof(rel));
+    }
+
+    template <typename T>
+    void Put(T value)
+    {
+        const size_t size = code_.size();
+        code_.resize(size + sizeof(T));
+        std::memcpy(&code_[size], &value, sizeof(T));
+    }
+
+    std::vector<uint8_t> code_;
+};
+
+// Where generated code finds the Cpu members it accesses, as offsets from the Cpu, and the
+// functions it calls.
+struct Layout
+{
+    int32_t pc;
+    int32_t sp;
+    int32_t a;
+    int32_t regs;
+    int32_t zero_src;
+    int32_t nf;
+    int32_t hf;
+    int32_t cf;
+    int32_t ime;
+    int32_t write_count;
+    int32_t hram;
+    int32_t read_pages;
+    int32_t write_pages;
+    int32_t compiled_ram;
+
+    uintptr_t enter;
+    uintptr_t sync;
+    uintptr_t exit;
+    uintptr_t read_byte;
+    uintptr_t write_byte;
+    std::array<uintptr_t, 256> interpret;
+
+    // Every write goes through the Cpu, which keeps the decode cache up to date.
+    bool slow_writes;
+    // HRAM is accessed directly for constant addresses, it's the I/O page on the flat test bus.
+    bool direct_hram;
+};
+
+// Translates a basic block into a function taking the Cpu.
+//
+// Registers: rbx holds the Cpu, r14d the cycles executed since the last call into the Cpu, which
+// the callee adds to the bus clock first, and r15d the cycles left until the next Jit::Sync(),
+// i.e. until the next bus event or the end of the budget. r12d is set when an instruction called
+// into the Cpu, after which it may have to leave, e.g. on an interrupt request or a bank switch.
+// r13d keeps a value across calls.
+class Translator
+{
+public:
+    explicit Translator(const Layout& layout) : layout_(layout) {}
+
+    [[nodiscard]] std::vector<uint8_t> Translate(std::span<const DecodedInstruction> block) &&
+    {
+        e_.Bytes({0x53, 0x41, 0x54, 0x41, 0x55, 0x41, 0x56, 0x41, 0x57});  // push rbx ... r15
+        e_.Reg(Width::k64, {0x89}, kRdi, kRbx);                            // mov rbx, rdi
+        e_.Call(layout_.enter);
+        e_.Reg(Width::k32, {0x89}, kRax, kR15);  // mov r15d, eax
+        e_.Reg(Width::k32, {0x31}, kR14, kR14);  // xor r14d, r14d
+        e_.Reg(Width::k32, {0x31}, kR12, kR12);  // xor r12d, r12d
+
+        for (size_t i = 0; i < block.size(); ++i)
+        {
+            const bool last = i + 1 == block.size();
+            if (!TranslateNative(block[i], last)) { TranslateInterpreted(block[i], last); }
+        }
+
+        e_.Bind(epilogue_);
+        CallCpu(layout_.exit, {kR14, kRsi});
+        e_.Bytes({0x41, 0x5f, 0x41, 0x5e, 0x41, 0x5d, 0x41, 0x5c, 0x5b});  // pop r15 ... rbx
+        e_.Imm8(0xc3);                                                     // ret
+
+        // Slow paths go after the block, off the path of straight-line code.
+        for (size_t i = 0; i < cold_.size(); ++i) { cold_[i](); }
+        return std::move(e_).Take();
+    }
+
+private:
+    Label& NewLabel() { return labels_.emplace_back(); }
+
+    [[nodiscard]] int32_t Offset(R8 r) const
+    {
+        if (r == R8::A) { return layout_.a; }
+        return layout_.regs + static_cast<int32_t>(detail::GetRegIndex(r));
+    }
+
+    [[nodiscard]] int32_t Offset(R16 rr) const
+    {
+        if (rr == R16::Sp) { return layout_.sp; }
+        return layout_.regs + static_cast<int32_t>(detail::GetRegIndex(rr));
+    }
+
+    // movzx reg, byte/word [rbx + disp]
+    void Load8(uint8_t reg, int32_t disp) { e_.Mem(Width::k32, {0x0f, 0xb6}, reg, disp); }
+    void Load16(uint8_t reg, int32_t disp) { e_.Mem(Width::k32, {0x0f, 0xb7}, reg, disp); }
+    // mov [rbx + disp], reg
+    void Store8(int32_t disp, uint8_t reg) { e_.Mem(Width::k8, {0x88}, reg, disp); }
+    void Store16(int32_t disp, uint8_t reg) { e_.Mem(Width::k16, {0x89}, reg, disp); }
+    // mov [rbx + disp], imm
+    void Set8(int32_t disp, uint8_t imm)
+    {
+        e_.Mem(Width::k8, {0xc6}, 0, disp);
+        e_.Imm8(imm);
+    }
+    void Set16(int32_t disp, uint16_t imm)
+    {
+        e_.Mem(Width::k16, {0xc7}, 0, disp);
+        e_.Imm16(imm);
+    }
+    // setcc byte [rbx + disp]
+    void SetCond(Cond cond, int32_t disp)
+    {
+        e_.Mem(Width::k8, {0x0f, static_cast<uint8_t>(0x90 | cond)}, 0, disp);
+    }
+    void Mov(uint8_t dst, uint8_t src) { e_.Reg(Width::k32, {0x89}, src, dst); }
+    // shl/shr reg, imm
+    void Shl(uint8_t reg, uint8_t imm)
+    {
+        e_.Reg(Width::k32, {0xc1}, 4, reg);
+        e_.Imm8(imm);
+    }
+    void Shr(uint8_t reg, uint8_t imm)
+    {
+        e_.Reg(Width::k32, {0xc1}, 5, reg);
+        e_.Imm8(imm);
+    }
+    // Loads C into CF, for ADC, SBC, RLA, RRA, RL and RR.
+    void LoadCarry()
+    {
+        Load8(kRdx, layout_.cf);
+        e_.Reg(Width::k32, {0xd1}, 5, kRdx);  // shr edx, 1
+    }
+    void SetFlags(uint8_t nf, uint8_t hf)
+    {
+        Set8(layout_.nf, nf);
+        Set8(layout_.hf, hf);
+    }
+
+    // Calls fn with the Cpu and the given registers as arguments, the last one being the pending
+    // cycles, which it consumes.
+    void CallCpu(uintptr_t fn, std::initializer_list<std::pair<uint8_t, uint8_t>> args)
+    {
+        e_.Reg(Width::k64, {0x89}, kRbx, kRdi);  // mov rdi, rbx
+        for (const auto& [src, dst] : args)
+        {
+            if (src != dst) { Mov(dst, src); }
+        }
+        e_.Call(fn);
+        e_.Reg(Width::k32, {0x31}, kR14, kR14);  // xor r14d, r14d
+    }
+    void CallCpu(uintptr_t fn, std::pair<uint8_t, uint8_t> pending) { CallCpu(fn, {pending}); }
+
+    // Reads the byte at ecx into eax.
+    void Read()
+    {
+        ++accesses_;
+        calls_cpu_ = true;
+        Label& slow = NewLabel();
+        Label& done = NewLabel();
+        Mov(kRax, kRcx);
+        Shr(kRax, 8);
+        e_.Bytes({0x48, 0x8b, 0x94, 0xc3});  // mov rdx, [rbx + rax * 8 + read_pages]
+        e_.Imm32(static_cast<uint32_t>(layout_.read_pages));
+        e_.Bytes({0x48, 0x85, 0xd2});  // test rdx, rdx
+        e_.Jcc(kEqual, slow);
+        e_.Bytes({0x0f, 0xb6, 0xc1});        // movzx eax, cl
+        e_.Bytes({0x0f, 0xb6, 0x04, 0x02});  // movzx eax, byte [rdx + rax]
+        e_.Bind(done);
+        cold_.emplace_back(
+            [this, &slow, &done]
+            {
+                e_.Bind(slow);
+                CallCpu(layout_.read_byte, {{kRcx, kRsi}, {kR14, kRdx}});
+                e_.MovImm32(kR12, 1);
+                e_.Jmp(done);
+            });
+    }
+
+    // Writes dl to the address in ecx.
+    void Write()
+    {
+        ++accesses_;
+        calls_cpu_ = true;
+        if (layout_.slow_writes)
+        {
+            CallWriteByte();
+            return;
+        }
+        Label& slow = NewLabel();
+        Label& done = NewLabel();
+        e_.Mem(Width::k32, {0x0f, 0xa3}, kRcx, layout_.compiled_ram);  // bt [compiled_ram], ecx
+        e_.Jcc(kBelow, slow);
+        Mov(kRax, kRcx);
+        Shr(kRax, 8);
+        e_.Bytes({0x48, 0x8b, 0xb4, 0xc3});  // mov rsi, [rbx + rax * 8 + write_pages]
+        e_.Imm32(static_cast<uint32_t>(layout_.write_pages));
+        e_.Bytes({0x48, 0x85, 0xf6});  // test rsi, rsi
+        e_.Jcc(kEqual, slow);
+        e_.Bytes({0x0f, 0xb6, 0xc1});  // movzx eax, cl
+        e_.Bytes({0x88, 0x14, 0x06});  // mov [rsi + rax], dl
+        CountWrite();
+        e_.Bind(done);
+        cold_.emplace_back(
+            [this, &slow, &done]
+            {
+                e_.Bind(slow);
+                CallWriteByte();
+                e_.Jmp(done);
+            });
+    }
+
+    void CallWriteByte()
+    {
+        // The value is already in edx.
+        CallCpu(layout_.write_byte, {{kRcx, kRsi}, {kR14, kRcx}});
+        e_.MovImm32(kR12, 1);
+    }
+
+    void CountWrite()
+    {
+#ifdef GBCXX_IDLE_LOOP_SKIP
+        e_.Mem(Width::k32, {0x83}, 0, layout_.write_count);  // add dword [write_count], 1
+        e_.Imm8(1);
+#endif
+    }
+
+    [[nodiscard]] bool IsDirectHram(uint16_t addr) const
+    {
+        return layout_.direct_hram && addr >= kHighRamStart && addr <= kHighRamEnd;
+    }
+
+    void ReadConst(uint16_t addr)
+    {
+        if (IsDirectHram(addr))
+        {
+            ++accesses_;
+            Load8(kRax, layout_.hram + (addr - kHighRamStart));
+            return;
+        }
+        e_.MovImm32(kRcx, addr);
+        Read();
+    }
+
+    void WriteConst(uint16_t addr)
+    {
+        if (IsDirectHram(addr) && !layout_.slow_writes)
+        {
+            ++accesses_;
+            calls_cpu_ = true;
+            Label& slow = NewLabel();
+            Label& done = NewLabel();
+            // test byte [compiled_ram + addr / 8], 1 << (addr % 8)
+            e_.Mem(Width::k8, {0xf6}, 0, layout_.compiled_ram + (addr >> 3));
+            e_.Imm8(static_cast<uint8_t>(1 << (addr & 7)));
+            e_.Jcc(kNotEqual, slow);
+            Store8(layout_.hram + (addr - kHighRamStart), kRdx);
+            CountWrite();
+            e_.Bind(done);
+            cold_.emplace_back(
+                [this, &slow, &done, addr]
+                {
+                    e_.Bind(slow);
+                    e_.MovImm32(kRcx, addr);
+                    CallWriteByte();
+                    e_.Jmp(done);
+                });
+            return;
+        }
+        e_.MovImm32(kRcx, addr);
+        Write();
+    }
+
+    // StackPush(r13d)
+    void Push()
+    {
+        e_.Mem(Width::k16, {0x83}, 5, layout_.sp);  // sub word [sp], 2
+        e_.Imm8(2);
+        Load16(kRcx, layout_.sp);
+        Mov(kRdx, kR13);
+        Write();
+        Load16(kRcx, layout_.sp);
+        e_.Bytes({0x66, 0xff, 0xc1});  // inc cx
+        Mov(kRdx, kR13);
+        Shr(kRdx, 8);
+        Write();
+    }
+
+    // eax = StackPop()
+    void Pop()
+    {
+        Load16(kRcx, layout_.sp);
+        Read();
+        Mov(kR13, kRax);
+        Load16(kRcx, layout_.sp);
+        e_.Bytes({0x66, 0xff, 0xc1});  // inc cx
+        Read();
+        Shl(kRax, 8);
+        e_.Reg(Width::k32, {0x09}, kR13, kRax);     // or eax, r13d
+        e_.Mem(Width::k16, {0x83}, 0, layout_.sp);  // add word [sp], 2
+        e_.Imm8(2);
+    }
+
+    // Compares the flag of the condition against 0, returns the x86 condition for it to hold.
+    Cond EvaluateCondition(uint8_t cc)
+    {
+        const bool carry = cc >= 2;
+        e_.Mem(Width::k8, {0x80}, 7, carry ? layout_.cf : layout_.zero_src);  // cmp byte [f], 0
+        e_.Imm8(0);
+        // zero_src is 0 when Z is set.
+        switch (cc)
+        {
+        case 0: return kNotEqual;
+        case 1: return kEqual;
+        case 2: return kEqual;
+        default: return kNotEqual;
+        }
+    }
+
+    void ExitTo(uint32_t cycles, uint16_t pc)
+    {
+        AddPending(cycles);
+        Set16(layout_.pc, pc);
+        e_.Jmp(epilogue_);
+    }
+
+    void ExitToEax(uint32_t cycles)
+    {
+        AddPending(cycles);
+        Store16(layout_.pc, kRax);
+        e_.Jmp(epilogue_);
+    }
+
+    void AddPending(uint32_t cycles)
+    {
+        e_.Reg(Width::k32, {0x83}, 0, kR14);  // add r14d, cycles
+        e_.Imm8(static_cast<uint8_t>(cycles));
+    }
+
+    // Ends an instruction that doesn't branch like Cpu::StepCompiled() does.
+    void EndInstruction(uint32_t cycles, uint16_t next, bool last)
+    {
+        if (last)
+        {
+            ExitTo(cycles, next);
+            return;
+        }
+        AddPending(cycles);
+        Label& sync = NewLabel();
+        Label& resume = NewLabel();
+        e_.Reg(Width::k32, {0x83}, 5, kR15);  // sub r15d, cycles
+        e_.Imm8(static_cast<uint8_t>(cycles));
+        e_.Jcc(kLessEqual, sync);
+        if (calls_cpu_)
+        {
+            e_.Reg(Width::k32, {0x85}, kR12, kR12);  // test r12d, r12d
+            e_.Jcc(kNotEqual, sync);
+        }
+        e_.Bind(resume);
+        cold_.emplace_back(
+            [this, &sync, &resume, next]
+            {
+                e_.Bind(sync);
+                CallCpu(layout_.sync, {kR14, kRsi});
+                e_.Reg(Width::k32, {0x31}, kR12, kR12);  // xor r12d, r12d
+                Mov(kR15, kRax);
+                e_.Reg(Width::k32, {0x85}, kRax, kRax);  // test eax, eax
+                e_.Jcc(kNotEqual, resume);
+                Set16(layout_.pc, next);
+                e_.Jmp(epilogue_);
+            });
+    }
+
+    void TranslateInterpreted(const DecodedInstruction& instr, bool last)
+    {
+        Set16(layout_.pc, instr.pc);
+        e_.Reg(Width::k64, {0x89}, kRbx, kRdi);  // mov rdi, rbx
+        e_.MovImm32(kRsi, static_cast<uint32_t>(instr.operands[0] | (instr.operands[1] << 8)));
+        Mov(kRdx, kR14);
+        e_.Call(layout_.interpret[instr.opcode]);
+        e_.Reg(Width::k32, {0x31}, kR14, kR14);  // xor r14d, r14d
+        Mov(kR15, kRax);
+        if (last)
+        {
+            e_.Jmp(epilogue_);
+            return;
+        }
+        // Cpu::StepCompiled() has already set PC.
+        e_.Reg(Width::k32, {0x85}, kRax, kRax);  // test eax, eax
+        e_.Jcc(kEqual, epilogue_);
+    }
+
+    // Returns false for the instructions left to Cpu::StepCompiled().
+    bool TranslateNative(const DecodedInstruction& instr, bool last)
+    {
+        accesses_ = 0;
+        calls_cpu_ = false;
+
+        const uint8_t opcode = instr.opcode;
+        const uint8_t x = opcode >> 6;
+        const uint8_t y = (opcode >> 3) & 7;
+        const uint8_t z = opcode & 7;
+        const auto next = static_cast<uint16_t>(instr.pc + instr.length);
+        const uint8_t n = instr.operands[0];
+        const auto nn = static_cast<uint16_t>(instr.operands[0] | (instr.operands[1] << 8));
+
+        // Control flow, which always ends the block. Taken branches take 4 more cycles, or 12 for
+        // CALL cc and RET cc, as timed by the interpreter.
+        Label& taken = NewLabel();
+        if (opcode == 0xc3) { ExitTo(12, nn); }
+        else if (opcode == 0x18)
+        {
+            ExitTo(8, static_cast<uint16_t>(next + static_cast<int8_t>(n)));
+        }
+        else if (opcode == 0xe9)
+        {
+            Load16(kRax, Offset(R16::Hl));
+            ExitToEax(4);
+        }
+        else if (opcode == 0xcd)
+        {
+            e_.MovImm32(kR13, next);
+            Push();
+            ExitTo(20, nn);
+        }
+        else if (opcode == 0xc9)
+        {
+            Pop();
+            ExitToEax(12);
+        }
+        else if (x == 0 && z == 0 && y >= 4)
+        {
+            e_.Jcc(EvaluateCondition(y - 4), taken);
+            ExitTo(8, next);
+            e_.Bind(taken);
+            ExitTo(12, static_cast<uint16_t>(next + static_cast<int8_t>(n)));
+        }
+        else if (x == 3 && z == 2 && y < 4)
+        {
+            e_.Jcc(EvaluateCondition(y), taken);
+            ExitTo(12, next);
+            e_.Bind(taken);
+            ExitTo(16, nn);
+        }
+        else if (x == 3 && z == 4 && y < 4)
+        {
+            e_.Jcc(EvaluateCondition(y), taken);
+            ExitTo(12, next);
+            e_.Bind(taken);
+            e_.MovImm32(kR13, next);
+            Push();
+            ExitTo(32, nn);
+        }
+        else if (x == 3 && z == 0 && y < 4)
+        {
+            e_.Jcc(EvaluateCondition(y), taken);
+            ExitTo(4, next);
+            e_.Bind(taken);
+            Pop();
+            ExitToEax(24);
+        }
+        else if (x == 3 && z == 7)
+        {
+            e_.MovImm32(kR13, next);
+            Push();
+            ExitTo(12, static_cast<uint16_t>(y * 8));
+        }
+        else
+        {
+            if (!TranslateBody(instr)) { return false; }
+            EndInstruction(4 * (instr.length + accesses_), next, last);
+        }
+        return true;
+    }
+
+    bool TranslateBody(const DecodedInstruction& instr)
+    {
+        using enum R16;
+        const uint8_t opcode = instr.opcode;
+        const uint8_t x = opcode >> 6;
+        const uint8_t y = (opcode >> 3) & 7;
+        const uint8_t z = opcode & 7;
+        const uint8_t p = y >> 1;
+        const uint8_t n = instr.operands[0];
+        const auto nn = static_cast<uint16_t>(instr.operands[0] | (instr.operands[1] << 8));
+
+        if (x == 1)
+        {
+            if (opcode == 0x76) { return false; }  // HALT
+            if (y == detail::kOperandMemHl)
+            {
+                Load8(kRdx, Offset(detail::kOperandR8[z]));
+                Load16(kRcx, Offset(Hl));
+                Write();
+            }
+            else if (z == detail::kOperandMemHl)
+            {
+                Load16(kRcx, Offset(Hl));
+                Read();
+                Store8(Offset(detail::kOperandR8[y]), kRax);
+            }
+            else if (y != z)
+            {
+                Load8(kRax, Offset(detail::kOperandR8[z]));
+                Store8(Offset(detail::kOperandR8[y]), kRax);
+            }
+            return true;
+        }
+        if (x == 2)
+        {
+            LoadOperand(z);
+            Alu(y);
+            return true;
+        }
+        if (x == 3 && z == 6)
+        {
+            e_.MovImm32(kRcx, n);
+            Alu(y);
+            return true;
+        }
+        if (x == 3 && z == 1 && (y & 1) == 0)
+        {
+            Pop();
+            if (p == 3) { SetAf(); }
+            else { Store16(Offset(detail::kOperandR16Stack[p]), kRax); }
+            return true;
+        }
+        if (x == 3 && z == 5 && (y & 1) == 0)
+        {
+            if (p == 3) { GetAf(); }
+            else { Load16(kRax, Offset(detail::kOperandR16Stack[p])); }
+            Mov(kR13, kRax);
+            Push();
+            return true;
+        }
+        if (x == 0 && z == 4 && y == detail::kOperandMemHl)
+        {
+            ModifyMemHl([this] { IncDec(false); });
+            return true;
+        }
+        if (x == 0 && z == 5 && y == detail::kOperandMemHl)
+        {
+            ModifyMemHl([this] { IncDec(true); });
+            return true;
+        }
+        if (x == 0 && (z == 4 || z == 5))
+        {
+            const int32_t r = Offset(detail::kOperandR8[y]);
+            Load8(kRax, r);
+            IncDec(z == 5);
+            Store8(r, kRax);
+            return true;
+        }
+
+        switch (opcode)
+        {
+        case 0x00: return true;  // NOP
+        case 0x01:
+        case 0x11:
+        case 0x21:
+        case 0x31: Set16(Offset(detail::kOperandR16[p]), nn); return true;
+        case 0x09:
+        case 0x19:
+        case 0x29:
+        case 0x39: AddHl(Offset(detail::kOperandR16[p])); return true;
+        case 0x03:
+        case 0x13:
+        case 0x23:
+        case 0x33:
+        case 0x0b:
+        case 0x1b:
+        case 0x2b:
+        case 0x3b:
+            // inc/dec word [rr]
+            e_.Mem(Width::k16, {0xff}, (y & 1), Offset(detail::kOperandR16[p]));
+            return true;
+        case 0x02:
+        case 0x12:
+            Load8(kRdx, layout_.a);
+            Load16(kRcx, Offset(opcode == 0x02 ? Bc : De));
+            Write();
+            return true;
+        case 0x0a:
+        case 0x1a:
+            Load16(kRcx, Offset(opcode == 0x0a ? Bc : De));
+            Read();
+            Store8(layout_.a, kRax);
+            return true;
+        case 0x22:
+        case 0x32:
+            Load8(kRdx, layout_.a);
+            Load16(kRcx, Offset(Hl));
+            Write();
+            e_.Mem(Width::k16, {0xff}, opcode == 0x22 ? 0 : 1, Offset(Hl));
+            return true;
+        case 0x2a:
+        case 0x3a:
+            Load16(kRcx, Offset(Hl));
+            Read();
+            Store8(layout_.a, kRax);
+            e_.Mem(Width::k16, {0xff}, opcode == 0x2a ? 0 : 1, Offset(Hl));
+            return true;
+        case 0x36:
+            e_.MovImm32(kRdx, n);
+            Load16(kRcx, Offset(Hl));
+            Write();
+            return true;
+        case 0x06:
+        case 0x0e:
+        case 0x16:
+        case 0x1e:
+        case 0x26:
+        case 0x2e:
+        case 0x3e: Set8(Offset(detail::kOperandR8[y]), n); return true;
+        case 0x07: RotateA(0); return true;  // RLCA: rol al, 1
+        case 0x0f: RotateA(1); return true;  // RRCA: ror al, 1
+        case 0x17: RotateA(2); return true;  // RLA: rcl al, 1
+        case 0x1f: RotateA(3); return true;  // RRA: rcr al, 1
+        case 0x2f:
+            e_.Mem(Width::k8, {0xf6}, 2, layout_.a);  // not byte [a]
+            SetFlags(1, 1);
+            return true;
+        case 0x37:
+            SetFlags(0, 0);
+            Set8(layout_.cf, 1);
+            return true;
+        case 0x3f:
+            SetFlags(0, 0);
+            e_.Mem(Width::k8, {0x80}, 6, layout_.cf);  // xor byte [cf], 1
+            e_.Imm8(1);
+            return true;
+        case 0xe0:
+            Load8(kRdx, layout_.a);
+            WriteConst(static_cast<uint16_t>(0xff00 + n));
+            return true;
+        case 0xf0:
+            ReadConst(static_cast<uint16_t>(0xff00 + n));
+            Store8(layout_.a, kRax);
+            return true;
+        case 0xe2:
+            Load8(kRdx, layout_.a);
+            LoadHighC();
+            Write();
+            return true;
+        case 0xf2:
+            LoadHighC();
+            Read();
+            Store8(layout_.a, kRax);
+            return true;
+        case 0xea:
+            Load8(kRdx, layout_.a);
+            WriteConst(nn);
+            return true;
+        case 0xfa:
+            ReadConst(nn);
+            Store8(layout_.a, kRax);
+            return true;
+        case 0xf9:
+            Load16(kRax, Offset(Hl));
+            Store16(layout_.sp, kRax);
+            return true;
+        case 0xf3: Set8(layout_.ime, 0); return true;  // DI
+        case 0xcb: TranslateCb(n); return true;
+        default: return false;
+        }
+    }
+
+    // ecx = 0xff00 + C
+    void LoadHighC()
+    {
+        Load8(kRcx, Offset(R8::C));
+        e_.Reg(Width::k32, {0x81}, 1, kRcx);  // or ecx, 0xff00
+        e_.Imm32(0xff00);
+    }
+
+    // Loads the operand of an 8-bit ALU instruction into ecx.
+    void LoadOperand(uint8_t z)
+    {
+        if (z == detail::kOperandMemHl)
+        {
+            Load16(kRcx, Offset(R16::Hl));
+            Read();
+            Mov(kRcx, kRax);
+        }
+        else { Load8(kRcx, Offset(detail::kOperandR8[z])); }
+    }
+
+    // ADD, ADC, SUB, SBC, AND, XOR, OR or CP of A and cl. x86 computes the same carry, and its
+    // auxiliary carry is H. CP is a SUB that keeps A, as Z comes from the result.
+    void Alu(uint8_t op)
+    {
+        constexpr std::array<uint8_t, 8> kOpcodes = {
+            0x00, 0x10, 0x28, 0x18, 0x20, 0x30, 0x08, 0x28};
+        Load8(kRax, layout_.a);
+        if (op == 1 || op == 3) { LoadCarry(); }
+        e_.Reg(Width::k8, {kOpcodes[op]}, kRcx, kRax);  // op al, cl
+        if (op >= 4 && op <= 6)
+        {
+            Store8(layout_.a, kRax);
+            Store8(layout_.zero_src, kRax);
+            SetFlags(0, op == 4 ? 1 : 0);
+            Set8(layout_.cf, 0);
+            return;
+        }
+        e_.Imm8(0x9f);  // lahf
+        SetCond(kBelow, layout_.cf);
+        e_.Bytes({0xf6, 0xc4, 0x10});  // test ah, 0x10
+        SetCond(kNotEqual, layout_.hf);
+        Store8(layout_.zero_src, kRax);
+        Set8(layout_.nf, op >= 2 ? 1 : 0);
+        if (op != 7) { Store8(layout_.a, kRax); }
+    }
+
+    // INC al or DEC al, which leave CF alone, as INC r and DEC r do.
+    void IncDec(bool dec)
+    {
+        e_.Reg(Width::k8, {0xfe}, dec ? 1 : 0, kRax);
+        e_.Imm8(0x9f);                 // lahf
+        e_.Bytes({0xf6, 0xc4, 0x10});  // test ah, 0x10
+        SetCond(kNotEqual, layout_.hf);
+        Store8(layout_.zero_src, kRax);
+        Set8(layout_.nf, dec ? 1 : 0);
+    }
+
+    // Reads (HL) into al, lets op change it and writes it back.
+    void ModifyMemHl(const std::function<void()>& op)
+    {
+        Load16(kRcx, Offset(R16::Hl));
+        Read();
+        op();
+        Mov(kRdx, kRax);
+        Load16(kRcx, Offset(R16::Hl));
+        Write();
+    }
+
+    // ADD HL,rr: H is the carry into bit 12, C the carry out of bit 15.
+    void AddHl(int32_t rr)
+    {
+        Load16(kRax, Offset(R16::Hl));
+        Load16(kRcx, rr);
+        Mov(kRdx, kRax);
+        e_.Reg(Width::k32, {0x31}, kRcx, kRdx);  // xor edx, ecx
+        e_.Reg(Width::k32, {0x01}, kRcx, kRax);  // add eax, ecx
+        e_.Reg(Width::k32, {0x31}, kRax, kRdx);  // xor edx, eax
+        e_.Reg(Width::k32, {0xf7}, 0, kRdx);     // test edx, 0x1000
+        e_.Imm32(0x1000);
+        SetCond(kNotEqual, layout_.hf);
+        e_.Reg(Width::k32, {0xf7}, 0, kRax);  // test eax, 0x10000
+        e_.Imm32(0x10000);
+        SetCond(kNotEqual, layout_.cf);
+        Store16(Offset(R16::Hl), kRax);
+        Set8(layout_.nf, 0);
+    }
+
+    // RLCA, RRCA, RLA and RRA, which clear Z.
+    void RotateA(uint8_t op)
+    {
+        Load8(kRax, layout_.a);
+        if (op >= 2) { LoadCarry(); }
+        e_.Reg(Width::k8, {0xd0}, op, kRax);
+        SetCond(kBelow, layout_.cf);
+        Store8(layout_.a, kRax);
+        Set8(layout_.zero_src, 1);
+        SetFlags(0, 0);
+    }
+
+    void TranslateCb(uint8_t cb_opcode)
+    {
+        const uint8_t x = cb_opcode >> 6;
+        const uint8_t y = (cb_opcode >> 3) & 7;
+        const uint8_t z = cb_opcode & 7;
+        const auto mask = static_cast<uint8_t>(1 << y);
+
+        const auto op = [this, x, y, mask]
+        {
+            if (x == 1)
+            {
+                e_.Bytes({0x24, mask});  // and al, mask
+                Store8(layout_.zero_src, kRax);
+                SetFlags(0, 1);
+            }
+            else if (x == 2) { e_.Bytes({0x24, static_cast<uint8_t>(~mask)}); }
+            else if (x == 3) { e_.Bytes({0x0c, mask}); }
+            else
+            {
+                // RLC, RRC, RL, RR, SLA, SRA, SWAP and SRL as rol, ror, rcl, rcr, shl, sar,
+                // rol 4 and shr.
+                constexpr std::array<uint8_t, 8> kShifts = {0, 1, 2, 3, 4, 7, 0, 5};
+                if (y == 2 || y == 3) { LoadCarry(); }
+                if (y == 6)
+                {
+                    e_.Reg(Width::k8, {0xc0}, 0, kRax);
+                    e_.Imm8(4);
+                    Set8(layout_.cf, 0);
+                }
+                else
+                {
+                    e_.Reg(Width::k8, {0xd0}, kShifts[y], kRax);
+                    SetCond(kBelow, layout_.cf);
+                }
+                Store8(layout_.zero_src, kRax);
+                SetFlags(0, 0);
+            }
+        };
+
+        if (z != detail::kOperandMemHl)
+        {
+            const int32_t r = Offset(detail::kOperandR8[z]);
+            Load8(kRax, r);
+            op();
+            if (x != 1) { Store8(r, kRax); }
+        }
+        else if (x == 1)
+        {
+            Load16(kRcx, Offset(R16::Hl));
+            Read();
+            op();
+        }
+        else { ModifyMemHl(op); }
+    }
+
+    // A << 8 | F into eax.
+    void GetAf()
+    {
+        e_.Reg(Width::k32, {0x31}, kRax, kRax);                  // xor eax, eax
+        e_.Mem(Width::k8, {0x80}, 7, layout_.zero_src);          // cmp byte [zero_src], 0
+        e_.Imm8(0);
+        e_.Reg(Width::k8, {0x0f, 0x90 | kEqual}, 0, kRax);       // sete al
+        Shl(kRax, 7);
+        const std::array<std::pair<int32_t, uint8_t>, 4> kBits = {
+            {{layout_.nf, 6}, {layout_.hf, 5}, {layout_.cf, 4}, {layout_.a, 8}}};
+        for (const auto& [flag, bit] : kBits)
+        {
+            Load8(kRdx, flag);
+            Shl(kRdx, bit);
+            e_.Reg(Width::k32, {0x09}, kRdx, kRax);  // or eax, edx
+        }
+    }
+
+    // Sets A and F from eax.
+    void SetAf()
+    {
+        Mov(kRcx, kRax);
+        Shr(kRcx, 8);
+        Store8(layout_.a, kRcx);
+        const std::array<std::pair<int32_t, uint8_t>, 4> kBits = {
+            {{layout_.zero_src, 0x80}, {layout_.nf, 0x40}, {layout_.hf, 0x20}, {layout_.cf, 0x10}}};
+        for (const auto& [flag, bit] : kBits)
+        {
+            e_.Bytes({0xa8, bit});  // test al, bit
+            // zero_src is 0 when Z is set.
+            SetCond(flag == layout_.zero_src ? kEqual : kNotEqual, flag);
+        }
+    }
+
+    const Layout& layout_;
+    Emitter e_;
+    // Labels are referenced by slow paths emitted later, so their addresses must stay stable.
+    std::deque<Label> labels_;
+    Label epilogue_;
+    std::vector<std::function<void()>> cold_;
+
+    // Memory accesses of the instruction being translated, 4 cycles each.
+    uint32_t accesses_{};
+    bool calls_cpu_{};
+};
+
+template <typename T>
+int32_t GetOffset(const Cpu& cpu, const T& member)
+{
+    return static_cast<int32_t>(reinterpret_cast<const char*>(&member) -
+                                reinterpret_cast<const char*>(&cpu));
+}
+
+template <typename Fn>
+uintptr_t GetAddress(Fn* fn)
+{
+    return reinterpret_cast<uintptr_t>(fn);
+}
+}  // namespace
+
+Jit::~Jit()
+{
+    if (code_ != nullptr) { munmap(code_, kCodeSize); }
+}
+
+Jit::Block Jit::Lookup(Cpu& cpu, uint16_t pc)
+{
+    if (ram_flush_pending_) [[unlikely]] { FlushRam(); }
+    if (unavailable_) { return nullptr; }
+
+    bool flat_memory = false;
+#ifdef GBCXX_TESTS
+    flat_memory = cpu.bus_.flat_memory;
+#endif
+    size_t index = pc >> 14;
+    uint32_t region_end{};
+    // The flat test bus has no banks, and instructions may cross 16KiB boundaries.
+    if (flat_memory) { region_end = 0x10000; }
+    else if (pc <= kCartridgeEnd)
+    {
+        index += kRamRegions + (cpu.bus_.cartridge.GetRomBank(pc) * 2);
+        region_end = (pc & 0xc000) + 0x4000;
+    }
+    else if (pc >= kWorkRamStart && pc <= kWorkRamEnd) { region_end = kWorkRamEnd + 1; }
+    else if (pc >= kHighRamStart && pc <= kHighRamEnd) { region_end = kHighRamEnd + 1; }
+    else { return nullptr; }
+
+    const auto offset = static_cast<uint16_t>(pc & 0x3fff);
+    Region& region = GetRegion(index);
+    if (const Block block = region.blocks[offset]) [[likely]] { return block; }
+    uint8_t& lookups = region.lookups[offset];
+    if (lookups == kNeverCompiled || lookups++ < kHotThreshold) { return nullptr; }
+
+    const Block block = Compile(cpu, pc, region_end, index < kRamRegions);
+    // Compiling flushes everything when the buffer is full, regions included.
+    Region& compiled = GetRegion(index);
+    if (block == nullptr) { compiled.lookups[offset] = kNeverCompiled; }
+    compiled.blocks[offset] = block;
+    return block;
+}
+
+Jit::Region& Jit::GetRegion(size_t index)
+{
+    if (index >= regions_.size()) { regions_.resize(index + 1); }
+    std::unique_ptr<Region>& region = regions_[index];
+    if (region == nullptr) { region = std::make_unique<Region>(); }
+    return *region;
+}
+
+Jit::Block Jit::Compile(Cpu& cpu, uint16_t pc, uint32_t region_end, bool ram)
+{
+    const std::vector<DecodedInstruction> instrs = DecodeBasicBlock(cpu.bus_, pc, region_end);
+    // The first instruction may straddle the end of its region.
+    if (instrs.empty()) { return nullptr; }
+
+    bool flat_memory = false;
+#ifdef GBCXX_TESTS
+    flat_memory = cpu.bus_.flat_memory;
+#endif
+#ifdef GBCXX_DECODE_CACHE
+    constexpr bool kDecodeCache = true;
+#else
+    constexpr bool kDecodeCache = false;
+#endif
+
+    Layout layout{
+        .pc = GetOffset(cpu, cpu.pc_),
+        .sp = GetOffset(cpu, cpu.sp_),
+        .a = GetOffset(cpu, cpu.a_),
+        .regs = GetOffset(cpu, cpu.regs_),
+        .zero_src = GetOffset(cpu, cpu.flags_.zero_src_),
+        .nf = GetOffset(cpu, cpu.flags_.nf_),
+        .hf = GetOffset(cpu, cpu.flags_.hf_),
+        .cf = GetOffset(cpu, cpu.flags_.cf_),
+        .ime = GetOffset(cpu, cpu.ime_),
+#ifdef GBCXX_IDLE_LOOP_SKIP
+        .write_count = GetOffset(cpu, cpu.write_count_),
+#else
+        .write_count = 0,
+#endif
+        .hram = GetOffset(cpu, cpu.bus_.hram),
+        .read_pages = GetOffset(cpu, cpu.bus_.read_pages),
+        .write_pages = GetOffset(cpu, cpu.bus_.write_pages),
+        .compiled_ram = GetOffset(cpu, compiled_ram_),
+        .enter = GetAddress(&Jit::Enter),
+        .sync = GetAddress(&Jit::Sync),
+        .exit = GetAddress(&Jit::Exit),
+        .read_byte = GetAddress(&Jit::ReadByte),
+        .write_byte = GetAddress(&Jit::WriteByte),
+        .interpret = []<size_t... Opcodes>(std::index_sequence<Opcodes...>)
+        {
+            return std::array<uintptr_t, 256>{GetAddress(&Jit::Interpret<Opcodes>)...};
+        }(std::make_index_sequence<256>{}),
+        .slow_writes = kDecodeCache,
+        .direct_hram = !flat_memory,
+    };
+
+    const std::vector<uint8_t> code = Translator{layout}.Translate(instrs);
+    Block block = Install(code);
+    if (block == nullptr && !unavailable_)
+    {
+        Flush();
+        block = Install(code);
+    }
+
+    if (block != nullptr && ram)
+    {
+        for (const DecodedInstruction& instr : instrs)
+        {
+            for (uint8_t i = 0; i < instr.length; ++i)
+            {
+                const auto addr = static_cast<uint16_t>(instr.pc + i);
+                compiled_ram_[addr >> 3] |= static_cast<uint8_t>(1 << (addr & 7));
+            }
+        }
+    }
+    return block;
+}
+
+Jit::Block Jit::Install(const std::vector<uint8_t>& code)
+{
+    if (code_ == nullptr)
+    {
+        void* buffer = mmap(nullptr, kCodeSize, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (buffer == MAP_FAILED)
+        {
+            LOG_WARN("JIT: Failed to map the code buffer, interpreting instead");
+            unavailable_ = true;
+            return nullptr;
+        }
+        code_ = static_cast<uint8_t*>(buffer);
+    }
+    if (code.size() > kCodeSize - code_used_) { return nullptr; }
+
+    // Only the pages being written to are writable, and only until the code is copied.
+    uint8_t* const dst = code_ + code_used_;
+    const auto page_size = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+    const uintptr_t start = reinterpret_cast<uintptr_t>(dst) & ~(page_size - 1);
+    const uintptr_t end = reinterpret_cast<uintptr_t>(dst + code.size());
+    void* const pages = reinterpret_cast<void*>(start);
+    if (mprotect(pages, end - start, PROT_READ | PROT_WRITE) != 0)
+    {
+        LOG_WARN("JIT: Failed to make the code buffer writable, interpreting instead");
+        unavailable_ = true;
+        return nullptr;
+    }
+    std::memcpy(dst, code.data(), code.size());
+    if (mprotect(pages, end - start, PROT_READ | PROT_EXEC) != 0)
+    {
+        LOG_WARN("JIT: Failed to make the code buffer executable, interpreting instead");
+        unavailable_ = true;
+        return nullptr;
+    }
+
+    code_used_ += (code.size() + 15) & ~size_t{15};
+    return reinterpret_cast<Block>(dst);
+}
+
+void Jit::Flush()
+{
+    regions_.clear();
+    code_used_ = 0;
+    compiled_ram_.fill(0);
+    ram_flush_pending_ = false;
+}
+
+void Jit::FlushRam()
+{
+    for (size_t i = 0; i < std::min(kRamRegions, regions_.size()); ++i) { regions_[i].reset(); }
+    compiled_ram_.fill(0);
+    ram_flush_pending_ = false;
+}
+
+void Jit::AddCycles(Cpu& cpu, uint32_t cycles)
+{
+    // Never past an event, generated code calls Sync() after the instruction reaching it.
+    cpu.bus_.scheduler.Advance(cycles);
+    cpu.run_cycles_ += cycles;
+}
+
+uint32_t Jit::GetCyclesUntilSync(const Cpu& cpu)
+{
+    const uint32_t budget =
+        cpu.run_cycles_ < cpu.run_budget_ ? cpu.run_budget_ - cpu.run_cycles_ : 0;
+    return std::min({cpu.bus_.CyclesUntilNextEvent(), budget,
+                     static_cast<uint32_t>(std::numeric_limits<int32_t>::max())});
+}
+
+uint32_t Jit::Enter(Cpu* cpu) { return GetCyclesUntilSync(*cpu); }
+
+uint32_t Jit::Sync(Cpu* cpu, uint32_t pending)
+{
+    // Blocks are at most kMaxBasicBlockLength instructions long, so pending cycles fit.
+    cpu->bus_.Tick(static_cast<uint16_t>(pending));
+    cpu->run_cycles_ += pending;
+    if (cpu->ShouldLeaveCompiledCode()) { return 0; }
+    return GetCyclesUntilSync(*cpu);
+}
+
+void Jit::Exit(Cpu* cpu, uint32_t pending)
+{
+    cpu->bus_.Tick(static_cast<uint16_t>(pending));
+    cpu->run_cycles_ += pending;
+}
+
+uint32_t Jit::ReadByte(Cpu* cpu, uint32_t addr, uint32_t pending)
+{
+    AddCycles(*cpu, pending);
+    return cpu->LoadByte(static_cast<uint16_t>(addr));
+}
+
+void Jit::WriteByte(Cpu* cpu, uint32_t addr, uint32_t val, uint32_t pending)
+{
+    AddCycles(*cpu, pending);
+    cpu->StoreByte(static_cast<uint16_t>(addr), static_cast<uint8_t>(val));
+}
+
+template <uint8_t Opcode>
+uint32_t Jit::Interpret(Cpu* cpu, uint32_t operands, uint32_t pending)
+{
+    AddCycles(*cpu, pending);
+    if (cpu->StepCompiled<Opcode>(operands)) { return 0; }
+    return GetCyclesUntilSync(*cpu);
+}
+}  // namespace gb::sm83
+#endif
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace gb::sm83
+{
+class Cpu;
+
+// Translates hot basic blocks in ROM, WRAM and HRAM into x86-64 machine code. Loads, stores, ALU
+// operations and branches are emitted as native instructions working on the registers and flags
+// stored in the Cpu. Memory is accessed through the page tables of the bus, and only unmapped
+// pages, i.e. I/O registers, cartridge RAM and MBC registers, go through calls back into the Cpu.
+// The few instructions without a native translation, e.g. DAA, EI and HALT, call
+// Cpu::StepCompiled().
+//
+// Generated code ticks the bus and leaves the block after the same instructions as
+// Cpu::StepCompiled(), so that Run() takes over for interrupts, HALT, bank switches and OAM DMA,
+// and at the end of the budget or frame. A write to RAM that was compiled leaves the block too and
+// drops all code compiled from RAM, so self-modifying code keeps being interpreted. The code buffer
+// is never writable and executable at the same time.
+class Jit
+{
+public:
+    using Block = void (*)(Cpu* cpu);
+
+    Jit() = default;
+    ~Jit();
+
+    Jit(const Jit&) = delete;
+    Jit& operator=(const Jit&) = delete;
+    Jit(Jit&&) = delete;
+    Jit& operator=(Jit&&) = delete;
+
+    // Returns the block starting at pc, compiling it once it has been looked up often enough.
+    // Returns nullptr when the code at pc has to be interpreted.
+    [[nodiscard]] Block Lookup(Cpu& cpu, uint16_t pc);
+
+    // Must be called after every CPU write, returns true when code compiled from RAM was
+    // overwritten.
+    bool OnWrite(uint16_t addr)
+    {
+        if (compiled_ram_[addr >> 3] & (1 << (addr & 7))) [[unlikely]]
+        {
+            ram_flush_pending_ = true;
+        }
+        return ram_flush_pending_;
+    }
+
+private:
+    // 16KiB of the address space. The first kRamRegions cover RAM, i.e. WRAM and HRAM or the whole
+    // flat test bus, by address. The others each hold a ROM bank mapped at 0x0000 or 0x4000. A bank
+    // mapped at both, e.g. bank 0 with MBC1's large ROM mode, is compiled twice, as its absolute
+    // jumps differ.
+    struct Region
+    {
+        std::array<Block, 0x4000> blocks{};
+        std::array<uint8_t, 0x4000> lookups{};
+    };
+    static constexpr size_t kRamRegions = 4;
+
+    Region& GetRegion(size_t index);
+    Block Compile(Cpu& cpu, uint16_t pc, uint32_t region_end, bool ram);
+    // Copies the code into the buffer, returns nullptr when it's full.
+    Block Install(const std::vector<uint8_t>& code);
+    void Flush();
+    // Drops the code compiled from RAM, whose machine code stays in the buffer until Flush().
+    void FlushRam();
+
+    // Called from generated code, which counts the cycles of the instructions since the last call
+    // into the Cpu in a register. Each of them adds these pending cycles to the bus clock first.
+    // Returns the cycles until generated code has to call Sync(), 0 to leave the block.
+    static uint32_t Enter(Cpu* cpu);
+    // Ticks the bus after an instruction.
+    static uint32_t Sync(Cpu* cpu, uint32_t pending);
+    static void Exit(Cpu* cpu, uint32_t pending);
+    static uint32_t ReadByte(Cpu* cpu, uint32_t addr, uint32_t pending);
+    static void WriteByte(Cpu* cpu, uint32_t addr, uint32_t val, uint32_t pending);
+    template <uint8_t Opcode>
+    static uint32_t Interpret(Cpu* cpu, uint32_t operands, uint32_t pending);
+    static uint32_t GetCyclesUntilSync(const Cpu& cpu);
+    static void AddCycles(Cpu& cpu, uint32_t cycles);
+
+    std::vector<std::unique_ptr<Region>> regions_;
+
+    uint8_t* code_{};
+    size_t code_used_{};
+    bool unavailable_{};
+
+    // One bit per address, set for the RAM bytes compiled code was translated from. Generated code
+    // tests it on every write, as a bit string indexed by address.
+    std::array<uint8_t, 0x10000 / 8> compiled_ram_{};
+    bool ram_flush_pending_{};
+};
+}  // namespace gb::sm83
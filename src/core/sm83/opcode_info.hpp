@@ -0,0 +1,46 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+namespace gb::sm83
+{
+namespace detail
+{
+constexpr auto kTwoByteOpcodes = std::to_array<uint8_t>({
+    0x06, 0x0e, 0x16, 0x1e, 0x26, 0x2e, 0x36, 0x3e, 0x18, 0x20, 0x28, 0x30, 0x38,
+    0xc6, 0xce, 0xd6, 0xde, 0xe6, 0xee, 0xf6, 0xfe, 0xe0, 0xf0, 0xe8, 0xf8, 0xcb,
+});
+
+constexpr auto kThreeByteOpcodes = std::to_array<uint8_t>({
+    0x01, 0x11, 0x21, 0x31, 0x08, 0xc3, 0xc2, 0xca, 0xd2,
+    0xda, 0xcd, 0xc4, 0xcc, 0xd4, 0xdc, 0xea, 0xfa,
+});
+
+constexpr auto kControlFlowOpcodes = std::to_array<uint8_t>({
+    0x18, 0x20, 0x28, 0x30, 0x38, 0xc3, 0xc2, 0xca, 0xd2, 0xda, 0xe9,
+    0xcd, 0xc4, 0xcc, 0xd4, 0xdc, 0xc9, 0xc0, 0xc8, 0xd0, 0xd8, 0xd9,
+    0xc7, 0xcf, 0xd7, 0xdf, 0xe7, 0xef, 0xf7, 0xff, 0x76, 0x10,
+});
+}  // namespace detail
+
+// Length in bytes of every unprefixed instruction, including the opcode. CB-prefixed instructions
+// are always two bytes long. STOP is treated as a single byte, matching Cpu::Instr_STOP().
+constexpr std::array<uint8_t, 256> kInstructionLength = []
+{
+    std::array<uint8_t, 256> table;
+    table.fill(1);
+    for (const uint8_t opcode : detail::kTwoByteOpcodes) { table[opcode] = 2; }
+    for (const uint8_t opcode : detail::kThreeByteOpcodes) { table[opcode] = 3; }
+    return table;
+}();
+
+// Whether the instruction may transfer control somewhere other than the next instruction, i.e.
+// jumps, calls, returns, restarts, HALT and STOP.
+constexpr std::array<bool, 256> kEndsBasicBlock = []
+{
+    std::array<bool, 256> table{};
+    for (const uint8_t opcode : detail::kControlFlowOpcodes) { table[opcode] = true; }
+    return table;
+}();
+}  // namespace gb::sm83
@@ -0,0 +1,35 @@
+#include "core/sm83/precompiled.hpp"
+
+#include <algorithm>
+#include <vector>
+
+namespace gb::sm83
+{
+namespace
+{
+std::vector<PrecompiledRom>& GetRegistry()
+{
+    // Function-local so that registration from other static initializers is safe.
+    static std::vector<PrecompiledRom> registry;
+    return registry;
+}
+}  // namespace
+
+bool RegisterPrecompiledRom(const PrecompiledRom& rom)
+{
+    GetRegistry().push_back(rom);
+    return true;
+}
+
+const PrecompiledRom* FindPrecompiledRom(uint8_t header_checksum, uint16_t global_checksum)
+{
+    const auto& registry = GetRegistry();
+    const auto it = std::ranges::find_if(registry,
+                                         [&](const PrecompiledRom& rom)
+                                         {
+                                             return rom.header_checksum == header_checksum &&
+                                                    rom.global_checksum == global_checksum;
+                                         });
+    return it != registry.end() ? &*it : nullptr;
+}
+}  // namespace gb::sm83
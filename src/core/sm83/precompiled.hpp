@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <string_view>
+
+namespace gb::sm83
+{
+class Cpu;
+
+constexpr uint16_t kHeaderChecksumAddress = 0x14d;
+constexpr uint16_t kGlobalChecksumAddress = 0x14e;
+
+// Entry point into a basic block recompiled by gbcxx_recompile. Every instruction of a block is an
+// entry point, so execution can resume in the middle of a block after leaving it early.
+struct PrecompiledEntry
+{
+    uint16_t bank;
+    uint16_t pc;
+    uint8_t index;
+    void (*block)(Cpu& cpu, uint8_t index);
+};
+
+struct PrecompiledRom
+{
+    std::string_view title;
+    uint8_t header_checksum;
+    uint16_t global_checksum;
+    std::span<const PrecompiledEntry> entries;
+};
+
+// Called from the static initializers of generated translation units.
+bool RegisterPrecompiledRom(const PrecompiledRom& rom);
+
+[[nodiscard]] const PrecompiledRom* FindPrecompiledRom(uint8_t header_checksum,
+                                                       uint16_t global_checksum);
+}  // namespace gb::sm83
@@ -0,0 +1,338 @@
+#include "core/sm83/profiler.hpp"
+
+#include <fmt/format.h>
+#include <fmt/ranges.h>
+
+#include <algorithm>
+#include <charconv>
+#include <fstream>
+#include <functional>
+#include <numeric>
+#include <utility>
+#include <vector>
+
+#include "core/constants.hpp"
+#include "core/sm83/cpu.hpp"
+
+namespace gb::sm83
+{
+namespace
+{
+constexpr uint32_t MakeKey(uint16_t bank, uint16_t addr)
+{
+    return (static_cast<uint32_t>(bank) << 16) | addr;
+}
+
+constexpr uint16_t GetBank(uint32_t key) { return static_cast<uint16_t>(key >> 16); }
+constexpr uint16_t GetAddress(uint32_t key) { return static_cast<uint16_t>(key & 0xffff); }
+
+template <typename T>
+bool ParseHex(std::string_view str, T& value)
+{
+    const auto [ptr, ec] = std::from_chars(str.data(), str.data() + str.size(), value, 16);
+    return ec == std::errc{} && ptr == str.data() + str.size();
+}
+
+// Sorts map entries by a counter, largest first.
+template <typename Map, typename Projection>
+auto SortedByDescending(const Map& map, Projection projection)
+{
+    std::vector<const typename Map::value_type*> entries;
+    entries.reserve(map.size());
+    for (const auto& entry : map) { entries.push_back(&entry); }
+    std::ranges::sort(entries, std::ranges::greater{},
+                      [&](const auto* entry) { return std::invoke(projection, entry->second); });
+    return entries;
+}
+}  // namespace
+
+void SymbolTable::Load(const std::filesystem::path& path)
+{
+    std::ifstream file{path};
+    if (!file)
+    {
+        LOG_ERROR("Profiler: Failed to open {}", path.string());
+        return;
+    }
+
+    size_t invalid_lines = 0;
+    for (std::string line; std::getline(file, line);)
+    {
+        std::string_view view = line;
+        view = view.substr(0, view.find(';'));
+        view = view.substr(0, view.find_last_not_of(" \t\r") + 1);
+        if (view.empty()) { continue; }
+
+        // BB:AAAA Name
+        const size_t colon = view.find(':');
+        const size_t space = view.find(' ');
+        uint16_t bank{};
+        uint16_t addr{};
+        if (colon == std::string_view::npos || space == std::string_view::npos || colon > space ||
+            !ParseHex(view.substr(0, colon), bank) ||
+            !ParseHex(view.substr(colon + 1, space - colon - 1), addr))
+        {
+            ++invalid_lines;
+            continue;
+        }
+        symbols_.insert_or_assign(MakeKey(bank, addr), std::string{view.substr(space + 1)});
+    }
+
+    if (invalid_lines) { LOG_WARN("Profiler: Skipped {} invalid lines", invalid_lines); }
+    LOG_INFO("Profiler: Loaded {} symbols from {}", symbols_.size(), path.string());
+}
+
+const std::pair<const uint32_t, std::string>* SymbolTable::Find(uint16_t bank,
+                                                                uint16_t addr) const
+{
+    auto it = symbols_.upper_bound(MakeKey(bank, addr));
+    if (it == symbols_.begin()) { return nullptr; }
+    --it;
+    return (it->first >> 16) == bank ? &*it : nullptr;
+}
+
+std::string SymbolTable::Resolve(uint16_t bank, uint16_t addr) const
+{
+    const auto* symbol = Find(bank, addr);
+    if (!symbol) { return fmt::format("{:02X}:{:04X}", bank, addr); }
+
+    const uint32_t offset = MakeKey(bank, addr) - symbol->first;
+    if (offset == 0) { return symbol->second; }
+    return fmt::format("{}+0x{:X}", symbol->second, offset);
+}
+
+std::optional<std::string> SymbolTable::ResolveRoutine(uint16_t bank, uint16_t addr) const
+{
+    const auto* symbol = Find(bank, addr);
+    if (!symbol) { return std::nullopt; }
+
+    const std::string& name = symbol->second;
+    return name.substr(0, name.find('.'));
+}
+
+Profiler::Profiler(const std::filesystem::path& sym_path)
+{
+    if (std::filesystem::exists(sym_path)) { symbols_.Load(sym_path); }
+    else { LOG_INFO("Profiler: No symbol file at {}", sym_path.string()); }
+}
+
+void Profiler::OnInstruction(const Cpu& cpu)
+{
+    const uint64_t cycle = cpu.GetCycleCount();
+    if (current_) { current_->cycles += cycle - current_cycle_; }
+    current_cycle_ = cycle;
+
+    const auto& bus = cpu.GetBus();
+    const uint16_t pc = cpu.GetReg(R16::Pc);
+    const uint16_t sp = cpu.GetReg(R16::Sp);
+    const auto bank = static_cast<uint16_t>(pc <= kCartridgeEnd ? bus.cartridge.GetRomBank(pc) : 0);
+    const uint32_t location = MakeKey(bank, pc);
+    if (!std::exchange(call_stack_updated_, false)) { UpdateCallStack(sp, location); }
+
+    const uint8_t opcode = bus.ReadByte(pc);
+    ++opcode_counts_[opcode == 0xcb ? 0x100 + bus.ReadByte(static_cast<uint16_t>(pc + 1))
+                                    : opcode];
+
+    const uint32_t node = call_stack_.empty() ? 0 : call_stack_.back().node;
+    current_ = &samples_[(static_cast<uint64_t>(node) << 32) | location];
+    ++current_->count;
+    current_location_ = location;
+    current_sp_ = sp;
+    current_opcode_ = opcode;
+}
+
+void Profiler::OnInterrupt(const Cpu& cpu)
+{
+    // The interrupted instruction finished before the dispatch pushed its return address.
+    const auto& bus = cpu.GetBus();
+    const uint16_t sp = cpu.GetReg(R16::Sp);
+    const auto return_address = static_cast<uint16_t>(
+        bus.ReadByte(sp) | (bus.ReadByte(static_cast<uint16_t>(sp + 1)) << 8));
+    const auto bank = static_cast<uint16_t>(
+        return_address <= kCartridgeEnd ? bus.cartridge.GetRomBank(return_address) : 0);
+    const uint32_t return_location = MakeKey(bank, return_address);
+    UpdateCallStack(static_cast<uint16_t>(sp + 2), return_location);
+    call_stack_updated_ = true;
+
+    PushFrame(return_location, MakeKey(0, cpu.GetReg(R16::Pc)), sp);
+}
+
+void Profiler::UpdateCallStack(uint16_t sp, uint32_t location)
+{
+    // Whatever happened, a return address below SP can't be returned to anymore.
+    while (!call_stack_.empty() && call_stack_.back().sp < sp) { call_stack_.pop_back(); }
+
+    const bool is_call = current_opcode_ == 0xcd || (current_opcode_ & 0xe7) == 0xc4 ||
+                         (current_opcode_ & 0xc7) == 0xc7;
+    // Conditional calls that weren't taken leave SP alone.
+    if (is_call && sp == static_cast<uint16_t>(current_sp_ - 2))
+    {
+        PushFrame(current_location_, location, sp);
+    }
+}
+
+void Profiler::PushFrame(uint32_t call_site, uint32_t entry, uint16_t sp)
+{
+    if (call_stack_.size() == kMaxCallDepth) { call_stack_.clear(); }
+
+    const uint32_t parent = call_stack_.empty() ? 0 : call_stack_.back().node;
+    const auto [it, inserted] = node_ids_.try_emplace(std::tuple{parent, call_site, entry},
+                                                      static_cast<uint32_t>(nodes_.size()));
+    if (inserted) { nodes_.push_back({.parent = parent, .call_site = call_site, .entry = entry}); }
+    call_stack_.push_back({.node = it->second, .sp = sp});
+}
+
+std::string Profiler::ResolveRoutine(uint32_t node, uint32_t location) const
+{
+    if (auto name = symbols_.ResolveRoutine(GetBank(location), GetAddress(location)))
+    {
+        return *std::move(name);
+    }
+    if (node == 0) { return "root"; }
+    const uint32_t entry = nodes_[node].entry;
+    return fmt::format("{:02X}:{:04X}", GetBank(entry), GetAddress(entry));
+}
+
+std::vector<std::string> Profiler::ResolveCallers(uint32_t node) const
+{
+    std::vector<std::string> names;
+    for (; node != 0; node = nodes_[node].parent)
+    {
+        names.push_back(ResolveRoutine(nodes_[node].parent, nodes_[node].call_site));
+    }
+    std::ranges::reverse(names);
+    return names;
+}
+
+std::vector<std::pair<std::vector<std::string>, Profiler::Counters>> Profiler::ResolveSamples()
+    const
+{
+    std::unordered_map<uint32_t, std::vector<std::string>> callers;
+    std::vector<std::pair<std::vector<std::string>, Counters>> samples;
+    samples.reserve(samples_.size());
+    for (const auto& [key, counters] : samples_)
+    {
+        const auto node = static_cast<uint32_t>(key >> 32);
+        const auto location = static_cast<uint32_t>(key & 0xffffffff);
+        auto it = callers.find(node);
+        if (it == callers.end()) { it = callers.emplace(node, ResolveCallers(node)).first; }
+
+        std::vector<std::string> names = it->second;
+        names.push_back(ResolveRoutine(node, location));
+        samples.emplace_back(std::move(names), counters);
+    }
+    return samples;
+}
+
+void Profiler::WriteReport(const std::filesystem::path& path) const
+{
+    std::ofstream file{path, std::ios::out | std::ios::trunc};
+    if (!file)
+    {
+        LOG_ERROR("Profiler: Failed to open {}", path.string());
+        return;
+    }
+
+    std::unordered_map<uint32_t, Counters> locations;
+    for (const auto& [key, counters] : samples_)
+    {
+        auto& location = locations[static_cast<uint32_t>(key & 0xffffffff)];
+        location.cycles += counters.cycles;
+        location.count += counters.count;
+    }
+
+    const auto [total_cycles, total_count] = std::accumulate(
+        locations.begin(), locations.end(), std::pair<uint64_t, uint64_t>{},
+        [](auto sum, const auto& entry)
+        { return std::pair{sum.first + entry.second.cycles, sum.second + entry.second.count}; });
+    const auto percent = [&](uint64_t cycles)
+    {
+        if (!total_cycles) { return 0.0; }
+        return 100.0 * static_cast<double>(cycles) / static_cast<double>(total_cycles);
+    };
+
+    file << fmt::format("# {} instructions, {} cycles, {} symbols, {} call stacks\n", total_count,
+                        total_cycles, symbols_.GetSize(), nodes_.size());
+
+    // Exclusive cycles are those of the routine itself, inclusive ones add everything it called.
+    struct RoutineCounters
+    {
+        uint64_t exclusive;
+        uint64_t inclusive;
+        uint64_t count;
+    };
+    std::map<std::string, RoutineCounters> routines;
+    for (const auto& [names, counters] : ResolveSamples())
+    {
+        auto& routine = routines[names.back()];
+        routine.exclusive += counters.cycles;
+        routine.count += counters.count;
+
+        // Recursive routines only count once per stack.
+        for (auto it = names.begin(); it != names.end(); ++it)
+        {
+            if (std::find(names.begin(), it, *it) == it)
+            {
+                routines[*it].inclusive += counters.cycles;
+            }
+        }
+    }
+
+    file << fmt::format("\n# Routines\n{:>14} {:>7} {:>14} {:>7} {:>12}  {}\n", "exclusive", "%",
+                        "inclusive", "%", "executed", "routine");
+    for (const auto* entry : SortedByDescending(routines, &RoutineCounters::exclusive))
+    {
+        const auto& [name, counters] = *entry;
+        file << fmt::format("{:>14} {:>6.2f}% {:>14} {:>6.2f}% {:>12}  {}\n", counters.exclusive,
+                            percent(counters.exclusive), counters.inclusive,
+                            percent(counters.inclusive), counters.count, name);
+    }
+
+    file << fmt::format("\n# Locations\n{:>14} {:>7} {:>12}  {:<7}  {}\n", "cycles", "%",
+                        "executed", "bank:pc", "symbol");
+    for (const auto* entry : SortedByDescending(locations, &Counters::cycles))
+    {
+        const uint16_t bank = GetBank(entry->first);
+        const uint16_t pc = GetAddress(entry->first);
+        file << fmt::format("{:>14} {:>6.2f}% {:>12}  {:02X}:{:04X}  {}\n", entry->second.cycles,
+                            percent(entry->second.cycles), entry->second.count, bank, pc,
+                            symbols_.Resolve(bank, pc));
+    }
+
+    std::vector<size_t> opcodes(opcode_counts_.size());
+    std::iota(opcodes.begin(), opcodes.end(), 0);
+    std::ranges::stable_sort(opcodes, std::ranges::greater{},
+                             [&](size_t opcode) { return opcode_counts_[opcode]; });
+    file << fmt::format("\n# Opcodes\n{:>14}  {}\n", "executed", "opcode");
+    for (const size_t opcode : opcodes)
+    {
+        if (!opcode_counts_[opcode]) { break; }
+        file << fmt::format("{:>14}  {}{:02X}\n", opcode_counts_[opcode],
+                            opcode >= 0x100 ? "CB " : "", opcode & 0xff);
+    }
+
+    LOG_INFO("Profiler: Wrote report to {}", path.string());
+}
+
+void Profiler::WriteFoldedStacks(const std::filesystem::path& path) const
+{
+    std::ofstream file{path, std::ios::out | std::ios::trunc};
+    if (!file)
+    {
+        LOG_ERROR("Profiler: Failed to open {}", path.string());
+        return;
+    }
+
+    std::map<std::string, uint64_t> stacks;
+    for (const auto& [names, counters] : ResolveSamples())
+    {
+        stacks[fmt::format("{}", fmt::join(names, ";"))] += counters.cycles;
+    }
+    for (const auto& [stack, cycles] : stacks)
+    {
+        if (cycles) { file << fmt::format("{} {}\n", stack, cycles); }
+    }
+
+    LOG_INFO("Profiler: Wrote folded stacks to {}", path.string());
+}
+}  // namespace gb::sm83
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <optional>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+namespace gb::sm83
+{
+class Cpu;
+
+// Symbols of an RGBDS .sym file, i.e. lines of the form "BB:AAAA Name". Addresses resolve to the
+// closest preceding symbol in the same bank.
+class SymbolTable
+{
+public:
+    void Load(const std::filesystem::path& path);
+
+    [[nodiscard]] size_t GetSize() const { return symbols_.size(); }
+
+    // "Name+offset", or "BB:AAAA" when no symbol precedes the address.
+    [[nodiscard]] std::string Resolve(uint16_t bank, uint16_t addr) const;
+    // Like Resolve(), but without the offset and without the local label part of "Name.local", so
+    // that all addresses of a routine resolve to the same name.
+    [[nodiscard]] std::optional<std::string> ResolveRoutine(uint16_t bank, uint16_t addr) const;
+
+private:
+    [[nodiscard]] const std::pair<const uint32_t, std::string>* Find(uint16_t bank,
+                                                                     uint16_t addr) const;
+
+    // Keyed by (bank << 16) | addr.
+    std::map<uint32_t, std::string> symbols_;
+};
+
+// Tracer that counts how often every (ROM bank, PC) executes and how many cycles it takes, as well
+// as the executions of every opcode. The cycles between two instructions are attributed to the
+// first one, so HALT gets the cycles spent halted and interrupt dispatch goes to the interrupted
+// instruction.
+//
+// Cycles are also attributed to the emulated call stack, which is tracked with a shadow stack of
+// return address slots. CALL, RST and interrupt dispatch push a frame, and a frame is popped as
+// soon as SP moves above its slot. That covers RET and RETI, but also return addresses dropped with
+// POP or ADD SP and stack resets through LD SP. Every frame is named after the routine its PC is
+// in, so a tail call through JP shows up as the routine jumped to. Without a symbol, a frame is
+// named after the address it was entered at instead.
+class Profiler
+{
+public:
+    explicit Profiler(const std::filesystem::path& sym_path);
+
+    void OnInstruction(const Cpu& cpu);
+    // Called after an interrupt was dispatched, before the first instruction of its handler.
+    void OnInterrupt(const Cpu& cpu);
+
+    // Routines with inclusive and exclusive cycles, locations and opcodes, sorted by cycles or
+    // executions.
+    void WriteReport(const std::filesystem::path& path) const;
+    // One "caller;callee cycles" line per call stack, the input format of flamegraph.pl.
+    void WriteFoldedStacks(const std::filesystem::path& path) const;
+
+private:
+    struct Counters
+    {
+        uint64_t cycles;
+        uint64_t count;
+    };
+
+    // A call or interrupt that hasn't returned yet.
+    struct Frame
+    {
+        uint32_t node;
+        // Where the return address is stored.
+        uint16_t sp;
+    };
+
+    // Call tree node, identified by the call site in its parent routine and the address called.
+    struct Node
+    {
+        uint32_t parent;
+        uint32_t call_site;
+        uint32_t entry;
+    };
+
+    // Deeper stacks are assumed to be abandoned, e.g. after SP was moved to another memory region.
+    static constexpr size_t kMaxCallDepth = 256;
+
+    // Applies the effect of the previous instruction on the call stack.
+    void UpdateCallStack(uint16_t sp, uint32_t location);
+    void PushFrame(uint32_t call_site, uint32_t entry, uint16_t sp);
+
+    // Name of the routine at location, in the frame of node.
+    [[nodiscard]] std::string ResolveRoutine(uint32_t node, uint32_t location) const;
+    // Routine names of every frame leading to the node, starting from the root, but without the
+    // routine of the node itself.
+    [[nodiscard]] std::vector<std::string> ResolveCallers(uint32_t node) const;
+    // Routine names of all samples, with the routine the sample is in last.
+    [[nodiscard]] std::vector<std::pair<std::vector<std::string>, Counters>> ResolveSamples() const;
+
+    SymbolTable symbols_;
+
+    // Node 0 is the root, i.e. code that isn't called by anything.
+    std::vector<Node> nodes_{{.parent = 0, .call_site = 0, .entry = 0}};
+    // Keyed by parent, call site and entry.
+    std::map<std::tuple<uint32_t, uint32_t, uint32_t>, uint32_t> node_ids_;
+    std::vector<Frame> call_stack_;
+
+    // Keyed by (node << 32) | (bank << 16) | pc.
+    std::unordered_map<uint64_t, Counters> samples_;
+    // Unprefixed opcodes followed by CB-prefixed ones.
+    std::array<uint64_t, 512> opcode_counts_{};
+
+    // The instruction currently being executed, receives the cycles until the next one.
+    Counters* current_{};
+    uint64_t current_cycle_{};
+    uint32_t current_location_{};
+    uint16_t current_sp_{};
+    uint8_t current_opcode_{};
+    // Set when an interrupt dispatch already accounted for the current instruction.
+    bool call_stack_updated_{};
+};
+}  // namespace gb::sm83
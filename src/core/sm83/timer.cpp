@@ -6,62 +6,99 @@
 
 namespace gb::sm83
 {
-uint8_t Timer::ReadByte(uint16_t addr) const
+namespace
+{
+uint16_t GetInputClock(uint8_t tac)
+{
+    switch (tac & 3)
+    {
+    case 0: return 1024;
+    case 1: return 16;
+    case 2: return 64;
+    case 3: return 256;
+    default: std::unreachable();
+    }
+}
+}  // namespace
+
+uint8_t Timer::ReadByte(uint16_t addr, uint64_t now) const
 {
     switch (addr)
     {
-    case kRegDiv: return div_;
-    case kRegTima: return tima_;
+    case kRegDiv: return static_cast<uint8_t>(GetCounter(now) >> 8);
+    case kRegTima:
+    {
+        const uint64_t count = CountIncrements(now);
+        if (tima_ + count <= 0xff) { return static_cast<uint8_t>(tima_ + count); }
+        // Overflowed since the last Sync(), TIMA restarted from TMA.
+        const uint64_t after_overflow = tima_ + count - 0x100;
+        return static_cast<uint8_t>(tma_ + (after_overflow % (0x100 - tma_)));
+    }
     case kRegTma: return tma_;
     case kRegTac: return tac_;
     default: DIE("Timer: Unmapped read {:X}", addr);
     }
 }
 
-void Timer::WriteByte(uint16_t addr, uint8_t val)
+void Timer::WriteByte(uint16_t addr, uint8_t val, uint64_t now)
 {
+    Sync(now);
+
+    // Clearing the counter or changing TAC increments TIMA if it makes the timer signal fall.
+    const bool signal = GetTimerSignal(now);
     switch (addr)
     {
-    case kRegDiv: div_ = 0; break;
+    case kRegDiv: counter_offset_ = (0x10000 - (now % 0x10000)) % 0x10000; break;
     case kRegTima: tima_ = val; break;
     case kRegTma: tma_ = val; break;
-    case kRegTac: tac_ = val; break;
+    case kRegTac: tac_ = val | 0xf8; break;
     default: DIE("Timer: Unmapped write {:X} <- {:X}", addr, val);
     }
+    if (signal && !GetTimerSignal(now)) { IncrementTima(1); }
 }
 
-void Timer::Tick(uint8_t tcycles)
+void Timer::Sync(uint64_t now)
 {
-    // ref: https://markau.dev/posts/time-for-timers/
-    internal_div_ += tcycles;
-    while (internal_div_ >= 256)
-    {
-        internal_div_ -= 256;
-        div_++;
-    }
+    IncrementTima(CountIncrements(now));
+    tima_timestamp_ = now;
+}
 
-    if (!(tac_ & 4)) { return; }
+uint64_t Timer::GetNextOverflow() const
+{
+    if (!(tac_ & 4)) { return kNever; }
 
-    uint16_t input_clock{};
-    switch (tac_ & 3)
-    {
-    case 0: input_clock = 1024; break;
-    case 1: input_clock = 16; break;
-    case 2: input_clock = 64; break;
-    case 3: input_clock = 256; break;
-    default: std::unreachable();
-    }
+    // TIMA increments whenever the counter reaches a multiple of the input clock.
+    const uint16_t input_clock = GetInputClock(tac_);
+    const uint64_t increments = 0x100 - tima_;
+    const uint64_t edges = (GetCounter(tima_timestamp_) / input_clock) + increments;
+    return (edges * input_clock) - counter_offset_;
+}
+
+bool Timer::GetTimerSignal(uint64_t now) const
+{
+    return (tac_ & 4) && (GetCounter(now) & (GetInputClock(tac_) / 2));
+}
+
+uint64_t Timer::CountIncrements(uint64_t now) const
+{
+    if (!(tac_ & 4)) { return 0; }
+    const uint16_t input_clock = GetInputClock(tac_);
+    return (GetCounter(now) / input_clock) - (GetCounter(tima_timestamp_) / input_clock);
+}
 
-    internal_tima_ += tcycles;
-    while (internal_tima_ >= input_clock)
+void Timer::IncrementTima(uint64_t count)
+{
+    while (count > 0)
     {
-        tima_++;
-        internal_tima_ -= input_clock;
-        if (tima_ == 0)
+        const uint64_t until_overflow = 0x100 - tima_;
+        if (count < until_overflow)
         {
-            tima_ = tma_;
-            interrupts_ |= sm83::IntTimer;
+            tima_ += static_cast<uint8_t>(count);
+            return;
         }
+        count -= until_overflow;
+        tima_ = tma_;
+        interrupts_ |= sm83::IntTimer;
     }
 }
 
@@ -1,26 +1,47 @@
 #pragma once
 
 #include <cstdint>
+#include <limits>
 #include <utility>
 
 namespace gb::sm83
 {
+// DIV is the upper byte of a 16-bit counter incremented every cycle. TIMA increments whenever the
+// counter bit selected by TAC falls from 1 to 0 while the timer is enabled, which includes the
+// glitch increments caused by writing DIV or TAC. Both are computed from the emulated timestamp
+// when read, so the timer only runs when TIMA overflows.
 class Timer
 {
 public:
-    [[nodiscard]] uint8_t ReadByte(uint16_t addr) const;
-    void WriteByte(uint16_t addr, uint8_t val);
+    static constexpr uint64_t kNever = std::numeric_limits<uint64_t>::max();
 
-    void Tick(uint8_t tcycles);
+    // now is never past GetNextOverflow().
+    [[nodiscard]] uint8_t ReadByte(uint16_t addr, uint64_t now) const;
+    void WriteByte(uint16_t addr, uint8_t val, uint64_t now);
+
+    // Handles the overflows up to now.
+    void Sync(uint64_t now);
     uint8_t ConsumeInterrupts() { return std::exchange(interrupts_, 0); }
 
+    // When TIMA overflows and requests an interrupt, kNever if the timer is stopped.
+    [[nodiscard]] uint64_t GetNextOverflow() const;
+
 private:
-    uint8_t div_{0xab};
+    [[nodiscard]] uint64_t GetCounter(uint64_t now) const { return now + counter_offset_; }
+    // Whether the counter bit selected by TAC is set while the timer is enabled.
+    [[nodiscard]] bool GetTimerSignal(uint64_t now) const;
+    // Increments of TIMA between tima_timestamp_ and now.
+    [[nodiscard]] uint64_t CountIncrements(uint64_t now) const;
+    // Increments TIMA, reloading it from TMA and requesting an interrupt on overflow.
+    void IncrementTima(uint64_t count);
+
+    // Added to the timestamp to get the counter, its lower 16 bits are the visible ones.
+    uint64_t counter_offset_{0xab00};
+    // TIMA is up to date as of this timestamp.
+    uint64_t tima_timestamp_{};
     uint8_t tima_{0};
     uint8_t tma_{0};
     uint8_t tac_{0xf8};
-    uint16_t internal_div_{};
-    uint16_t internal_tima_{};
-    uint8_t interrupts_;
+    uint8_t interrupts_{};
 };
 }  // namespace gb::sm83
@@ -0,0 +1,106 @@
+#include "core/sm83/tracer.hpp"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+
+#include "core/constants.hpp"
+#include "core/sm83/cpu.hpp"
+
+namespace gb::sm83
+{
+TraceRecord MakeTraceRecord(const Cpu& cpu)
+{
+    using enum R8;
+    using enum R16;
+    const auto& bus = cpu.GetBus();
+    const uint16_t pc = cpu.GetReg(Pc);
+    return {
+        .cycle = cpu.GetCycleCount(),
+        .pc = pc,
+        .sp = cpu.GetReg(Sp),
+        .bank = static_cast<uint16_t>(pc <= kCartridgeEnd ? bus.cartridge.GetRomBank(pc) : 0),
+        .regs = {cpu.GetReg(A), cpu.GetReg(F), cpu.GetReg(B), cpu.GetReg(C), cpu.GetReg(D),
+                 cpu.GetReg(E), cpu.GetReg(H), cpu.GetReg(L)},
+        .mem = {bus.ReadByte(pc), bus.ReadByte(static_cast<uint16_t>(pc + 1)),
+                bus.ReadByte(static_cast<uint16_t>(pc + 2)),
+                bus.ReadByte(static_cast<uint16_t>(pc + 3))},
+    };
+}
+
+std::string FormatDoctorLine(const TraceRecord& record)
+{
+    const auto& [a, f, b, c, d, e, h, l] = record.regs;
+    return fmt::format("A: {:02X} F: {:02X} B: {:02X} C: {:02X} D: {:02X} E: {:02X} "
+                       "H: {:02X} L: {:02X} SP: {:04X} PC: 00:{:04X} ({:02X} {:02X} {:02X} "
+                       "{:02X})",
+                       a, f, b, c, d, e, h, l, record.sp, record.pc, record.mem[0], record.mem[1],
+                       record.mem[2], record.mem[3]);
+}
+
+DoctorTracer::DoctorTracer(const std::filesystem::path& log_path)
+    : log_file_(log_path, std::ios::out)
+{
+    if (!log_file_) { DIE("Tracer: Failed to open {}", log_path.string()); }
+}
+
+void DoctorTracer::OnInstruction(const Cpu& cpu)
+{
+    log_file_ << FormatDoctorLine(MakeTraceRecord(cpu)) << '\n';
+}
+
+RingTracer::RingTracer(std::filesystem::path dump_path)
+    : records_(kCapacity), dump_path_(std::move(dump_path))
+{
+}
+
+void RingTracer::Dump() const
+{
+    std::ofstream file{dump_path_, std::ios::binary | std::ios::out | std::ios::trunc};
+    if (!file)
+    {
+        LOG_ERROR("Tracer: Failed to open {}", dump_path_.string());
+        return;
+    }
+
+    const uint64_t count = std::min<uint64_t>(count_, kCapacity);
+    const TraceHeader header{
+        .magic = TraceHeader::kMagic,
+        .version = TraceHeader::kVersion,
+        .record_size = sizeof(TraceRecord),
+        .count = count,
+    };
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    // Once the buffer has wrapped around, the oldest record is the next one to be overwritten.
+    const size_t oldest = count_ > kCapacity ? count_ & (kCapacity - 1) : 0;
+    const auto write_records = [&](size_t begin, size_t end)
+    {
+        file.write(reinterpret_cast<const char*>(records_.data() + begin),
+                   static_cast<std::streamsize>((end - begin) * sizeof(TraceRecord)));
+    };
+    write_records(oldest, count == kCapacity ? kCapacity : count);
+    write_records(0, oldest);
+
+    LOG_INFO("Tracer: Dumped the last {} instructions to {}", count, dump_path_.string());
+}
+
+AnyTracer MakeTracer(TraceMode mode, const std::filesystem::path& rom_path)
+{
+    switch (mode)
+    {
+    case TraceMode::None: return NullTracer{};
+    case TraceMode::Doctor:
+        LOG_INFO("Tracer: Writing gameboy-doctor log to gameboy_doctor.log");
+        return AnyTracer{std::in_place_type<DoctorTracer>, "gameboy_doctor.log"};
+    case TraceMode::Ring:
+        LOG_INFO("Tracer: Recording the last {} instructions, dumped to gbcxx_trace.bin",
+                 RingTracer::kCapacity);
+        return AnyTracer{std::in_place_type<RingTracer>, "gbcxx_trace.bin"};
+    case TraceMode::Profile:
+        return AnyTracer{std::in_place_type<Profiler>,
+                         std::filesystem::path{rom_path}.replace_extension(".sym")};
+    }
+    std::unreachable();
+}
+}  // namespace gb::sm83
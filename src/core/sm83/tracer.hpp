@@ -0,0 +1,114 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <variant>
+#include <vector>
+
+#include "core/sm83/profiler.hpp"
+
+namespace gb::sm83
+{
+class Cpu;
+
+// One executed instruction, as kept by RingTracer and stored in its dumps.
+struct TraceRecord
+{
+    uint64_t cycle;
+    uint16_t pc;
+    uint16_t sp;
+    uint16_t bank;
+    // A, F, B, C, D, E, H, L
+    std::array<uint8_t, 8> regs;
+    // The opcode and the 3 bytes following it.
+    std::array<uint8_t, 4> mem;
+};
+static_assert(sizeof(TraceRecord) == 32);
+
+// Starts a RingTracer dump, followed by count TraceRecords from oldest to newest, all in host byte
+// order.
+struct TraceHeader
+{
+    static constexpr std::array<char, 8> kMagic = {'G', 'B', 'C', 'X', 'X', 'T', 'R', 'C'};
+    static constexpr uint32_t kVersion = 1;
+
+    std::array<char, 8> magic;
+    uint32_t version;
+    uint32_t record_size;
+    uint64_t count;
+};
+
+// Formats a record as a line of the log written by DoctorTracer, without the newline.
+[[nodiscard]] std::string FormatDoctorLine(const TraceRecord& record);
+
+[[nodiscard]] TraceRecord MakeTraceRecord(const Cpu& cpu);
+
+// Tracers are passed to Cpu::Step() and Cpu::Run() as a template parameter and notified before
+// every interpreted instruction. The untraced instantiations use NullTracer and contain no tracing
+// code at all. Traced runs fetch every instruction from the bus and take none of the shortcuts
+// of Run(), i.e. precompiled code, fused loops, idle loop skipping and the decode cache, so every
+// instruction is seen.
+// Tracers may also define OnInterrupt(const Cpu&), called after an interrupt was dispatched.
+template <typename T>
+concept Tracer = requires(T& tracer, const Cpu& cpu) { tracer.OnInstruction(cpu); };
+
+struct NullTracer
+{
+    void OnInstruction(const Cpu&) {}
+};
+
+// Writes the registers and the 4 bytes at PC before every instruction, in the format compared by
+// gameboy-doctor.
+class DoctorTracer
+{
+public:
+    explicit DoctorTracer(const std::filesystem::path& log_path);
+
+    void OnInstruction(const Cpu& cpu);
+
+private:
+    std::ofstream log_file_;
+};
+
+// Keeps the last kCapacity instructions in memory, cheap enough to leave enabled. The buffer is
+// written to dump_path by Dump(), and by DIE() while DumpOnDie() is bound as the thread's die
+// handler. Convert dumps to text with gbcxx_tracedump.
+class RingTracer
+{
+public:
+    static constexpr size_t kCapacity = size_t{1} << 16;
+
+    explicit RingTracer(std::filesystem::path dump_path);
+
+    void OnInstruction(const Cpu& cpu)
+    {
+        records_[count_ & (kCapacity - 1)] = MakeTraceRecord(cpu);
+        ++count_;
+    }
+
+    void Dump() const;
+    // DieHandler dumping the tracer passed as user data.
+    static void DumpOnDie(void* tracer) { static_cast<const RingTracer*>(tracer)->Dump(); }
+
+private:
+    std::vector<TraceRecord> records_;
+    uint64_t count_{};
+    std::filesystem::path dump_path_;
+};
+
+enum class TraceMode : uint8_t
+{
+    None,
+    Doctor,
+    Ring,
+    Profile
+};
+
+using AnyTracer = std::variant<NullTracer, DoctorTracer, RingTracer, Profiler>;
+
+// The profiler loads symbols from the .sym file next to the ROM, as written by rgblink -n.
+[[nodiscard]] AnyTracer MakeTracer(TraceMode mode, const std::filesystem::path& rom_path);
+}  // namespace gb::sm83
@@ -4,6 +4,38 @@
 
 #include <fstream>
 
+namespace gb
+{
+namespace
+{
+thread_local DieHandler die_handler = nullptr;
+thread_local void* die_handler_user_data = nullptr;
+}  // namespace
+
+ScopedDieHandler::ScopedDieHandler(DieHandler handler, void* user_data)
+    : previous_handler_(die_handler), previous_user_data_(die_handler_user_data)
+{
+    if (handler != nullptr)
+    {
+        die_handler = handler;
+        die_handler_user_data = user_data;
+    }
+}
+
+ScopedDieHandler::~ScopedDieHandler()
+{
+    die_handler = previous_handler_;
+    die_handler_user_data = previous_user_data_;
+}
+
+void RunDieHandler()
+{
+    // Cleared first, so that a DIE() inside the handler doesn't recurse.
+    const DieHandler handler = std::exchange(die_handler, nullptr);
+    if (handler) { handler(die_handler_user_data); }
+}
+}  // namespace gb
+
 namespace gb::fs
 {
 std::vector<uint8_t> ReadFile(const std::filesystem::path& path)
@@ -12,17 +12,14 @@
 #include <type_traits>
 #include <utility>
 
-#define FWD(...) static_cast<decltype(__VA_ARGS__)&&>(__VA_ARGS__)
+#include "core/log.hpp"
 
-#define LOG_DEBUG(...) spdlog::debug(__VA_ARGS__)
-#define LOG_TRACE(...) spdlog::trace(__VA_ARGS__)
-#define LOG_INFO(...) spdlog::info(__VA_ARGS__)
-#define LOG_WARN(...) spdlog::warn(__VA_ARGS__)
-#define LOG_ERROR(...) spdlog::error(__VA_ARGS__)
+#define FWD(...) static_cast<decltype(__VA_ARGS__)&&>(__VA_ARGS__)
 
 #define DIE(...)                 \
     do {                         \
         LOG_ERROR(__VA_ARGS__);  \
+        ::gb::RunDieHandler();   \
         std::exit(EXIT_FAILURE); \
     } while (0)
 
@@ -36,6 +33,29 @@
 
 namespace gb
 {
+// Called by DIE() before exiting, e.g. to dump the last executed instructions. Handlers are bound
+// per thread, so that a DIE() only runs the one of the emulator instance running on its thread.
+using DieHandler = void (*)(void* user_data);
+
+// Binds a handler to the calling thread until destroyed, nullptr keeps the current one.
+class ScopedDieHandler
+{
+public:
+    ScopedDieHandler(DieHandler handler, void* user_data);
+    ~ScopedDieHandler();
+
+    ScopedDieHandler(const ScopedDieHandler&) = delete;
+    ScopedDieHandler& operator=(const ScopedDieHandler&) = delete;
+    ScopedDieHandler(ScopedDieHandler&&) = delete;
+    ScopedDieHandler& operator=(ScopedDieHandler&&) = delete;
+
+private:
+    DieHandler previous_handler_;
+    void* previous_user_data_;
+};
+
+void RunDieHandler();
+
 template <size_t Offset, std::integral T>
     requires(Offset < std::numeric_limits<T>::digits)
 [[nodiscard]] constexpr T GetBit(T value)
@@ -1,21 +1,26 @@
 #include "core/video/ppu.hpp"
 
+#include <algorithm>
+#include <bit>
 #include <cstddef>
+#include <functional>
 #include <ranges>
+#include <utility>
 
 #include "core/constants.hpp"
 #include "core/sm83/interrupts.hpp"
 #include "core/util.hpp"
+#include "core/video/sprite_rows.hpp"
 
 namespace
 {
 constexpr size_t kTileSize = 8;
 constexpr size_t kTilesPerLine = 32;
 
-constexpr int kCyclesOam = 80;
-constexpr int kCyclesTransfer = 172;
-constexpr int kCyclesVBlank = 456;
-constexpr int kCyclesHBlank = 204;
+constexpr uint32_t kCyclesOam = 80;
+constexpr uint32_t kCyclesTransfer = 172;
+constexpr uint32_t kCyclesVBlank = 456;
+constexpr uint32_t kCyclesHBlank = 204;
 }  // namespace
 
 namespace gb::video
@@ -27,16 +32,7 @@ uint8_t Ppu::ReadByte(uint16_t addr) const
     if (addr >= kOamStart && addr <= kOamEnd)
     {
         if (!CanAccessOam()) { return 0xff; }
-        addr -= kOamStart;
-        const Sprite& sprite = oam_[addr / 4];
-        switch (addr % 4)
-        {
-        case 0: return sprite.y;
-        case 1: return sprite.x;
-        case 2: return sprite.tile_index;
-        case 3: return static_cast<uint8_t>(sprite.flags);
-        default: std::unreachable();
-        }
+        return oam_[addr - kOamStart];
     }
 
     switch (addr)
@@ -53,28 +49,33 @@ uint8_t Ppu::ReadByte(uint16_t addr) const
     case kRegObp1: return obp1_;
     case kRegWy: return window_y_;
     case kRegWx: return window_x_;
-    default: LOG_ERROR("PPU: Unmapped read {:X}", addr); return {};
+    default: LOG_ERROR_LIMITED("PPU: Unmapped read {:X}", addr); return {};
     }
 }
 
 void Ppu::WriteByte(uint16_t addr, uint8_t val)
 {
-    if (addr >= kVramStart && addr <= kVramEnd) { vram_[addr - kVramStart] = val; }
-    else if (addr >= kOamStart && addr <= kOamEnd)
+    if (addr >= kVramStart && addr <= kVramEnd)
     {
-        if (!CanAccessOam()) { return; }
-        addr -= kOamStart;
-        Sprite& sprite = oam_[addr / 4];
-
-        switch (addr % 4)
+        vram_[addr - kVramStart] = val;
+        if (addr <= kTileDataEnd)
+        {
+            const size_t tile = (addr - kTileDataStart) / 16U;
+            decoded_tiles_.reset(tile);
+            for (TileMapLayer& layer : layers_) { layer.written_tiles.set(tile); }
+        }
+        else
         {
-        case 0: sprite.y = val; break;
-        case 1: sprite.x = val; break;
-        case 2: sprite.tile_index = val; break;
-        case 3: sprite.flags = SpriteFlags{val}; break;
-        default: std::unreachable();
+            const size_t entry = (addr - kTileMapStart) % TileMapLayer::kEntries;
+            layers_[(addr - kTileMapStart) / TileMapLayer::kEntries].drawn_entries.reset(entry);
         }
     }
+    else if (addr >= kOamStart && addr <= kOamEnd)
+    {
+        if (!CanAccessOam()) { return; }
+        oam_[addr - kOamStart] = val;
+        sprite_lines_stale_ = true;
+    }
     else
     {
         switch (addr)
@@ -88,12 +89,21 @@ void Ppu::WriteByte(uint16_t addr, uint8_t val)
         case kRegScx: scroll_x_ = val; break;
         case kRegLy: break;
         case kRegLyc: SetScanYCompare(val); break;
-        case kRegBgp: bgp_ = val; break;
-        case kRegObp0: obp0_ = val; break;
-        case kRegObp1: obp1_ = val; break;
+        case kRegBgp:
+            bgp_ = val;
+            bg_palette_ = DecodePalette(val);
+            break;
+        case kRegObp0:
+            obp0_ = val;
+            obj_palettes_[0] = DecodePalette(val);
+            break;
+        case kRegObp1:
+            obp1_ = val;
+            obj_palettes_[1] = DecodePalette(val);
+            break;
         case kRegWy: window_y_ = val; break;
         case kRegWx: window_x_ = val; break;
-        default: LOG_ERROR("PPU: Unmapped write {:X} <- {:X}", addr, val);
+        default: LOG_ERROR_LIMITED("PPU: Unmapped write {:X} <- {:X}", addr, val);
         }
     }
 }
@@ -116,20 +126,25 @@ uint8_t ScrollAdjustment(uint8_t scroll_x)
 }
 }  // namespace
 
-void Ppu::Tick(uint8_t tcycles)
+void Ppu::Tick(uint32_t tcycles)
 {
     if (!lcd_control_.LcdEnabled()) { return; }
     cycles_ += tcycles;
 
-    const uint8_t scroll_adjust = ScrollAdjustment(scroll_x_);
+    for (uint32_t mode_cycles = GetModeCycles(lcd_status_.GetMode()); cycles_ >= mode_cycles;
+         mode_cycles = GetModeCycles(lcd_status_.GetMode()))
+    {
+        cycles_ -= mode_cycles;
+        AdvanceMode();
+    }
+}
 
+void Ppu::AdvanceMode()
+{
     switch (lcd_status_.GetMode())
     {
     case Mode::HBlank:
     {
-        if (cycles_ < kCyclesHBlank - scroll_adjust) { return; }
-        cycles_ -= kCyclesHBlank - scroll_adjust;
-
         if (scan_y_ >= 143) [[unlikely]]
         {
             interrupts_ |= sm83::IntVBlank;
@@ -151,8 +166,6 @@ void Ppu::Tick(uint8_t tcycles)
     }
     case Mode::VBlank:
     {
-        if (cycles_ < kCyclesVBlank) { return; }
-        cycles_ -= kCyclesVBlank;
         SetScanY(scan_y_ + 1);
 
         if (scan_y_ > 153) [[unlikely]]
@@ -165,40 +178,16 @@ void Ppu::Tick(uint8_t tcycles)
     }
     case Mode::Oam:
     {
-        if (cycles_ < kCyclesOam) { return; }
-        cycles_ -= kCyclesOam;
-
-        scanline_sprite_buffer_.clear();
-
-        // Can't use std::views::enumerate here because looks like emscripten doesn't support it yet
-        for (size_t oam_idx = 0; oam_idx < oam_.size(); ++oam_idx)
-        {
-            const auto& sprite = oam_[oam_idx];
-            constexpr int kSpriteYOffset = 16;
-            if ((sprite.x > 0) && (scan_y_ + kSpriteYOffset >= sprite.y) &&
-                (scan_y_ + kSpriteYOffset < sprite.y + lcd_control_.GetSpriteHeight()))
-            {
-                scanline_sprite_buffer_.emplace_back(oam_idx, sprite);
-            }
-        }
-
-        constexpr int kMaxSpritesPerScanline = 10;
-        if (scanline_sprite_buffer_.size() > kMaxSpritesPerScanline)
-        {
-            scanline_sprite_buffer_.resize(kMaxSpritesPerScanline);
-        }
-
-        std::ranges::sort(
-            scanline_sprite_buffer_, [](const auto& a, const auto& b)
-            { return std::tie(a.second.x, a.first) > std::tie(b.second.x, b.first); });
+        if (sprite_lines_stale_) { BuildSpriteLines(); }
+        const SpriteLine& line = sprite_lines_[scan_y_];
+        line_sprite_count_ = line.count;
+        for (size_t i = 0; i < line.count; ++i) { line_sprites_[i] = GetSprite(line.sprites[i]); }
 
         lcd_status_.SetMode(Mode::Transfer, interrupts_);
         break;
     }
     case Mode::Transfer:
     {
-        if (cycles_ < kCyclesTransfer + scroll_adjust) { return; }
-        cycles_ -= kCyclesTransfer + scroll_adjust;
         RenderScanline();
         lcd_status_.SetMode(Mode::HBlank, interrupts_);
         break;
@@ -206,10 +195,72 @@ void Ppu::Tick(uint8_t tcycles)
     }
 }
 
+uint32_t Ppu::GetModeCycles(Mode mode) const
+{
+    const uint8_t scroll_adjust = ScrollAdjustment(scroll_x_);
+    switch (mode)
+    {
+    case Mode::HBlank: return kCyclesHBlank - scroll_adjust;
+    case Mode::VBlank: return kCyclesVBlank;
+    case Mode::Oam: return kCyclesOam;
+    case Mode::Transfer: return kCyclesTransfer + scroll_adjust;
+    }
+    std::unreachable();
+}
+
+uint32_t Ppu::CyclesUntilModeChange() const
+{
+    if (!lcd_control_.LcdEnabled()) { return std::numeric_limits<uint32_t>::max(); }
+
+    const uint32_t mode_cycles = GetModeCycles(lcd_status_.GetMode());
+    return cycles_ < mode_cycles ? mode_cycles - cycles_ : 0;
+}
+
+uint32_t Ppu::CyclesUntilNextEvent() const
+{
+    if (!lcd_control_.LcdEnabled()) { return std::numeric_limits<uint32_t>::max(); }
+
+    // Walks the mode changes ahead like AdvanceMode(), without rendering. VBlank starts at least
+    // once a frame, so this stops within 154 lines.
+    Mode mode = lcd_status_.GetMode();
+    uint8_t scan_y = scan_y_;
+    uint32_t cycles = CyclesUntilModeChange();
+    while (true)
+    {
+        switch (mode)
+        {
+        case Mode::HBlank:
+            if (scan_y >= 143) { return cycles; }
+            ++scan_y;
+            mode = Mode::Oam;
+            if (lcd_status_.Mode2Condition() || IsLineCompareInterrupt(scan_y)) { return cycles; }
+            break;
+        case Mode::VBlank:
+            ++scan_y;
+            if (scan_y > 153 || IsLineCompareInterrupt(scan_y)) { return cycles; }
+            break;
+        case Mode::Oam: mode = Mode::Transfer; break;
+        case Mode::Transfer:
+            mode = Mode::HBlank;
+            if (lcd_status_.Mode0Condition()) { return cycles; }
+            break;
+        }
+        cycles += GetModeCycles(mode);
+    }
+}
+
+void Ppu::WriteOam(std::span<const uint8_t, 160> oam)
+{
+    std::ranges::copy(oam, oam_.begin());
+    sprite_lines_stale_ = true;
+}
+
 void Ppu::SetLcdc(uint8_t lcdc)
 {
     const bool was_enabled = lcd_control_.LcdEnabled();
+    const bool was_tall = lcd_control_.ObjTallSize();
     lcd_control_ = LcdControl{lcdc};
+    if (lcd_control_.ObjTallSize() != was_tall) { sprite_lines_stale_ = true; }
     if (!lcd_control_.LcdEnabled() && was_enabled) [[unlikely]]
     {
         cycles_ = 0;
@@ -246,43 +297,173 @@ namespace
 constexpr Color kDmgPalette[4] = {
     {0xff, 0xff, 0xff}, {0xaa, 0xaa, 0xaa}, {0x55, 0x55, 0x55}, {0x00, 0x00, 0x00}};
 
-constexpr uint8_t GetPixelColorIndex(uint8_t lo_byte, uint8_t hi_byte, uint8_t bit_pos)
+// Bits of a tile row byte spread out to one byte per pixel, leftmost first in memory.
+static_assert(std::endian::native == std::endian::little);
+constexpr std::array<uint64_t, 256> kTileRowBits = []
 {
-    const auto bit0 = (lo_byte >> bit_pos) & 1;
-    const auto bit1 = ((hi_byte >> bit_pos) & 1) << 1;
-    return static_cast<uint8_t>(bit1 | bit0);
-}
+    std::array<uint64_t, 256> bits{};
+    for (size_t byte = 0; byte < bits.size(); ++byte)
+    {
+        for (size_t px = 0; px < kTileSize; ++px)
+        {
+            bits[byte] |= static_cast<uint64_t>((byte >> (7 - px)) & 1) << (px * 8);
+        }
+    }
+    return bits;
+}();
 
-constexpr Color GetPixelColor(uint8_t palette, uint8_t color_idx)
+// The colour indices of the 8 pixels of a tile row, from its low and high bit planes.
+std::array<uint8_t, kTileSize> DecodeTileRow(uint8_t lo_byte, uint8_t hi_byte)
 {
-    return kDmgPalette[(palette >> (color_idx << 1)) & 3];
+    return std::bit_cast<std::array<uint8_t, kTileSize>>(kTileRowBits[lo_byte] |
+                                                         (kTileRowBits[hi_byte] << 1));
 }
 }  // namespace
 
+const Ppu::DecodedTile& Ppu::GetTile(size_t tile)
+{
+    DecodedTile& decoded = tiles_[tile];
+    if (!decoded_tiles_[tile]) [[unlikely]]
+    {
+        for (size_t row = 0; row < kTileSize; ++row)
+        {
+            const size_t row_addr = (tile * 16) + (row * 2);
+            decoded.rows[row] = DecodeTileRow(vram_[row_addr], vram_[row_addr + 1]);
+            std::ranges::reverse_copy(decoded.rows[row], decoded.flipped_rows[row].begin());
+        }
+        decoded_tiles_.set(tile);
+    }
+    return decoded;
+}
+
+Ppu::Palette Ppu::DecodePalette(uint8_t palette)
+{
+    Palette colors;
+    for (size_t idx = 0; idx < colors.size(); ++idx)
+    {
+        colors[idx] = kDmgPalette[(palette >> (idx * 2)) & 3];
+    }
+    return colors;
+}
+
+std::span<const uint8_t, Ppu::TileMapLayer::kSize> Ppu::GetLayerLine(bool tile_map, size_t y)
+{
+    constexpr size_t kSize = TileMapLayer::kSize;
+    TileMapLayer& layer = layers_[tile_map ? 1 : 0];
+    const size_t map_addr = (tile_map ? 0x9c00 : 0x9800) - kVramStart;
+
+    if (layer.unsigned_tile_data != lcd_control_.BgWinTileData())
+    {
+        layer.unsigned_tile_data = lcd_control_.BgWinTileData();
+        layer.drawn_entries.reset();
+    }
+    if (layer.written_tiles.any())
+    {
+        for (size_t entry = 0; entry < TileMapLayer::kEntries; ++entry)
+        {
+            if (layer.written_tiles[GetTileNumber(vram_[map_addr + entry])])
+            {
+                layer.drawn_entries.reset(entry);
+            }
+        }
+        layer.written_tiles.reset();
+    }
+
+    const size_t tile_y = y / kTileSize;
+    for (size_t tile_x = 0; tile_x < kTilesPerLine; ++tile_x)
+    {
+        const size_t entry = (tile_y * kTilesPerLine) + tile_x;
+        if (layer.drawn_entries[entry]) { continue; }
+
+        const DecodedTile& tile = GetTile(GetTileNumber(vram_[map_addr + entry]));
+        for (size_t row = 0; row < kTileSize; ++row)
+        {
+            const size_t offset = (((tile_y * kTileSize) + row) * kSize) + (tile_x * kTileSize);
+            std::ranges::copy(tile.rows[row], layer.color_indices.begin() + offset);
+        }
+        layer.drawn_entries.set(entry);
+    }
+    return std::span{layer.color_indices}.subspan(y * kSize).first<kSize>();
+}
+
 void Ppu::RenderScanline()
 {
     const auto scanline_start = static_cast<size_t>(scan_y_) * kLcdWidth;
     Color* pixels = &lcd_buf_[scanline_start];
 
-    for (uint8_t scan_x = 0; scan_x < kLcdWidth; ++scan_x)
+    if (!lcd_control_.BgWinEnabled())
     {
-        Color bg_color = FetchBackgroundPixel(scan_x, scan_y_);
-        pixels[scan_x] = bg_color;
-        bg_transparency_[scanline_start + scan_x] = (bg_color == kDmgPalette[0]);
+        std::fill_n(pixels, kLcdWidth, kDmgPalette[0]);
+        for (size_t x = 0; x < kLcdWidth; ++x) { bg_transparency_[scanline_start + x] = true; }
+    }
+    else
+    {
+        std::array<uint8_t, kLcdWidth> color_indices;
+        const std::span line{color_indices};
+
+        // The background wraps around, so the line is copied in up to two parts.
+        const uint8_t bg_y = scan_y_ + scroll_y_;
+        const auto bg_line = GetLayerLine(lcd_control_.BgTileMap(), bg_y);
+        const size_t wrap_x = std::min<size_t>(bg_line.size() - scroll_x_, line.size());
+        std::ranges::copy(bg_line.subspan(scroll_x_, wrap_x), line.begin());
+        std::ranges::copy(bg_line.first(line.size() - wrap_x), line.subspan(wrap_x).begin());
+
+        const int window_start = window_x_ - 7;
+        if (lcd_control_.WindowEnabled() && scan_y_ >= window_y_ && window_start < kLcdWidth)
+        {
+            const int start = std::max(window_start, 0);
+            const size_t window_y = ((window_line_counter_ / kTileSize) * kTileSize) +
+                                    ((scan_y_ - window_y_) % kTileSize);
+            const auto window_line = GetLayerLine(lcd_control_.WindowTileMap(), window_y);
+            std::ranges::copy(window_line.subspan(static_cast<size_t>(start - window_start),
+                                                  static_cast<size_t>(kLcdWidth - start)),
+                              line.subspan(static_cast<size_t>(start)).begin());
+        }
 
-        const Color win_color = FetchWindowPixel(scan_x, scan_y_);
-        if (!win_color.IsTransparent())
+        for (size_t x = 0; x < kLcdWidth; ++x)
         {
-            pixels[scan_x] = win_color;
-            bg_transparency_[scanline_start + scan_x] = (win_color == kDmgPalette[0]);
+            pixels[x] = bg_palette_[color_indices[x]];
+            bg_transparency_[scanline_start + x] = (pixels[x] == kDmgPalette[0]);
         }
     }
     if (lcd_control_.ObjEnabled()) { RenderSprites(scanline_start); }
 }
 
+void Ppu::BuildSpriteLines()
+{
+    constexpr uint8_t kSpriteYOffset = 16;
+
+    detail::SpriteYs ys{};
+    uint64_t shown = 0;
+    for (size_t idx = 0; idx < kOamSprites; ++idx)
+    {
+        const Sprite sprite = GetSprite(idx);
+        ys[idx] = sprite.y;
+        if (sprite.x > 0) { shown |= uint64_t{1} << idx; }
+    }
+
+    const uint8_t height = lcd_control_.GetSpriteHeight();
+    for (uint8_t y = 0; y < sprite_lines_.size(); ++y)
+    {
+        // The first sprites in OAM order, drawn in order of decreasing X then OAM index, so that
+        // the one with the lowest X and then index ends up on top.
+        SpriteLine& line = sprite_lines_[y];
+        line.count = 0;
+        const auto line_y = static_cast<uint8_t>(y + kSpriteYOffset);
+        for (uint64_t mask = detail::MatchSpriteRows(ys, line_y, height) & shown;
+             mask != 0 && line.count < line.sprites.size(); mask &= mask - 1)
+        {
+            line.sprites[line.count++] = static_cast<uint8_t>(std::countr_zero(mask));
+        }
+        std::ranges::sort(std::span{line.sprites}.first(line.count), std::ranges::greater{},
+                          [this](uint8_t idx) { return std::pair{GetSprite(idx).x, idx}; });
+    }
+    sprite_lines_stale_ = false;
+}
+
 void Ppu::RenderSprites(size_t scanline_start)
 {
-    for (const auto& [_, sprite] : scanline_sprite_buffer_)
+    for (const Sprite& sprite : std::span{line_sprites_}.first(line_sprite_count_))
     {
         const uint8_t tile_index =
             lcd_control_.ObjTallSize() ? ClearBit<0>(sprite.tile_index) : sprite.tile_index;
@@ -290,10 +471,12 @@ void Ppu::RenderSprites(size_t scanline_start)
         uint8_t row = scan_y_ - (sprite.y - 16);
         if (sprite.flags.YFlip()) { row = lcd_control_.GetSpriteHeight() - 1 - row; }
 
-        const uint16_t tile_addr = kVramStart + ((static_cast<uint16_t>(tile_index * 8) + row) * 2);
-        const uint8_t byte1 = ReadByte(tile_addr);
-        const uint8_t byte2 = ReadByte(tile_addr + 1);
+        // The lower half of tall sprites is the next tile.
+        const DecodedTile& tile = GetTile(tile_index + (row / kTileSize));
+        const TileRow& color_indices = sprite.flags.XFlip() ? tile.flipped_rows[row % kTileSize]
+                                                            : tile.rows[row % kTileSize];
 
+        const Palette& palette = obj_palettes_[sprite.flags.DmgPalette() ? 1 : 0];
         for (uint8_t px = 0; px < kTileSize; ++px)
         {
             const uint8_t x_off = (sprite.x - 8) + px;
@@ -302,62 +485,11 @@ void Ppu::RenderSprites(size_t scanline_start)
             const bool bg_transparent = bg_transparency_[scanline_start + x_off];
             if (sprite.flags.BgWinPriority() && !bg_transparent) { continue; }
 
-            const uint8_t flipped_px = sprite.flags.XFlip() ? px : 7 - px;
-
-            const uint8_t color_idx = GetPixelColorIndex(byte1, byte2, flipped_px);
+            const uint8_t color_idx = color_indices[px];
             if (color_idx == 0) { continue; }
 
-            const uint8_t palette = sprite.flags.DmgPalette() ? obp1_ : obp0_;
-            const Color color = GetPixelColor(palette, color_idx);
-            lcd_buf_[scanline_start + x_off] = color;
+            lcd_buf_[scanline_start + x_off] = palette[color_idx];
         }
     }
 }
-
-ALWAYS_INLINE Color Ppu::FetchTilePixel(uint8_t tile_idx, uint8_t x_off, uint8_t y_off,
-                                        uint8_t pal) const
-{
-    const uint16_t tile_addr = lcd_control_.GetTileAddress(tile_idx);
-    const uint8_t byte1 = ReadByte(tile_addr + y_off);
-    const uint8_t byte2 = ReadByte(tile_addr + y_off + 1);
-    return GetPixelColor(pal, GetPixelColorIndex(byte1, byte2, x_off));
-}
-
-ALWAYS_INLINE Color Ppu::FetchBackgroundPixel(uint8_t scan_x, uint8_t scan_y) const
-{
-    if (!lcd_control_.BgWinEnabled()) { return kDmgPalette[0]; }
-
-    const uint16_t bg_map_base = lcd_control_.GetBackgroundTileMapAddress();
-    const uint8_t bg_map_x = scan_x + scroll_x_;
-    const uint8_t bg_map_y = scan_y + scroll_y_;
-
-    const uint16_t tile_idx_addr =
-        bg_map_base + ((bg_map_y / kTileSize) * kTilesPerLine) + (bg_map_x / kTileSize);
-    const uint8_t tile_idx = ReadByte(tile_idx_addr);
-
-    const uint8_t x_off = 7 - (bg_map_x % kTileSize);
-    const uint8_t y_off = 2 * (bg_map_y % kTileSize);
-    return FetchTilePixel(tile_idx, x_off, y_off, bgp_);
-}
-
-ALWAYS_INLINE Color Ppu::FetchWindowPixel(uint8_t scan_x, uint8_t scan_y) const
-{
-    if (scan_y_ < window_y_ || scan_x < window_x_ - 7 || !lcd_control_.WindowEnabled() ||
-        !lcd_control_.BgWinEnabled())
-    {
-        return Color::Transparent();
-    }
-
-    const uint16_t win_map_base = lcd_control_.GetWindowTileMapAddress();
-    const uint8_t win_map_x = scan_x - (window_x_ - 7);
-    const uint8_t win_map_y = window_line_counter_;
-
-    const uint16_t tile_idx_addr =
-        win_map_base + ((win_map_y / kTileSize) * kTilesPerLine) + (win_map_x / kTileSize);
-    const uint8_t tile_idx = ReadByte(tile_idx_addr);
-
-    const uint8_t x_off = 7 - (win_map_x % kTileSize);
-    const uint8_t y_off = 2 * ((scan_y - window_y_) % kTileSize);
-    return FetchTilePixel(tile_idx, x_off, y_off, bgp_);
-}
 }  // namespace gb::video
@@ -4,8 +4,9 @@
 #include <bitset>
 #include <cassert>
 #include <cstdint>
+#include <limits>
+#include <span>
 #include <utility>
-#include <vector>
 
 #include "core/constants.hpp"
 #include "core/sm83/interrupts.hpp"
@@ -134,7 +135,15 @@ using LcdBuffer = std::array<Color, kLcdSize>;
 class Ppu
 {
 public:
-    void Tick(uint8_t tcycles);
+    // Catches up through any number of mode changes, rendering the scanlines on the way.
+    void Tick(uint32_t tcycles);
+
+    // Cycles until the next mode or line change, the next time registers read differently.
+    [[nodiscard]] uint32_t CyclesUntilModeChange() const;
+    // Cycles until the next mode or line change that may request an interrupt, finishes a frame,
+    // or starts or ends rendering. Nothing outside of the PPU can tell the others happened until it
+    // reads the PPU, so the PPU only has to be ticked at these.
+    [[nodiscard]] uint32_t CyclesUntilNextEvent() const;
 
     [[nodiscard]] uint8_t ReadByte(uint16_t addr) const;
     void WriteByte(uint16_t addr, uint8_t val);
@@ -143,6 +152,12 @@ public:
 
     [[nodiscard]] const LcdBuffer& GetLcdBuffer() const { return lcd_buf_; }
 
+    // VRAM is always accessible, so the bus maps it directly for reads. Writes go through
+    // WriteByte(), which keeps the decoded tiles and tile maps up to date.
+    [[nodiscard]] std::span<uint8_t, 8192> GetVram() { return vram_; }
+    // Written by OAM DMA, which bypasses the mode restrictions.
+    void WriteOam(std::span<const uint8_t, 160> oam);
+
     [[nodiscard]] bool ShouldDrawFrame() const { return should_draw_frame_; }
     void SetShouldDrawFrame(bool should_draw_frame) { should_draw_frame_ = should_draw_frame; }
 
@@ -153,26 +168,102 @@ public:
     }
 
 private:
+    [[nodiscard]] uint32_t GetModeCycles(Mode mode) const;
+    // Switches to the mode following the current one, which has run for its cycles.
+    void AdvanceMode();
+    [[nodiscard]] bool IsLineCompareInterrupt(uint8_t scan_y) const
+    {
+        return lcd_status_.LycEqLyEnable() && scan_y == scan_y_compare_;
+    }
+
     void SetLcdc(uint8_t lcdc);
     void SetScanY(uint8_t scan_y);
     void SetScanYCompare(uint8_t scan_y_compare);
     void CompareLine();
 
+    static constexpr size_t kOamSprites = 40;
+    static constexpr size_t kMaxSpritesPerLine = 10;
+
+    // OAM indices of the sprites on a line, in the order they're drawn.
+    struct SpriteLine
+    {
+        std::array<uint8_t, kMaxSpritesPerLine> sprites;
+        uint8_t count;
+    };
+    // OAM is usually written once a frame, by DMA, so the sprites on every line are only looked
+    // up again after it or the sprite height changed.
+    void BuildSpriteLines();
+
+    // Decodes the 4 OAM bytes of the sprite.
+    [[nodiscard]] Sprite GetSprite(size_t idx) const
+    {
+        return {.y = oam_[idx * 4],
+                .x = oam_[(idx * 4) + 1],
+                .tile_index = oam_[(idx * 4) + 2],
+                .flags = SpriteFlags{oam_[(idx * 4) + 3]}};
+    }
+
+    static constexpr size_t kTileCount = (kTileDataEnd - kTileDataStart + 1) / 16;
+
+    // Colour indices of the 8 pixels of a tile row, leftmost first.
+    using TileRow = std::array<uint8_t, 8>;
+    struct DecodedTile
+    {
+        std::array<TileRow, 8> rows;
+        // Mirrored, for X-flipped sprites.
+        std::array<TileRow, 8> flipped_rows;
+    };
+    // Decodes the tile first if it was written since it was last decoded.
+    [[nodiscard]] const DecodedTile& GetTile(size_t tile);
+    // Index of the tile a tile map entry refers to, in the tile data area selected by LCDC.
+    [[nodiscard]] size_t GetTileNumber(uint8_t tile_idx) const
+    {
+        return (lcd_control_.GetTileAddress(tile_idx) - kTileDataStart) / 16U;
+    }
+
+    // A tile map drawn to colour indices, which scanlines of the background and window are
+    // copied from. Its entries are drawn again when a scanline needs them after they or their
+    // tile were written.
+    struct TileMapLayer
+    {
+        static constexpr size_t kSize = 256;
+        static constexpr size_t kEntries = 32 * 32;
+
+        std::array<uint8_t, kSize * kSize> color_indices{};
+        std::bitset<kEntries> drawn_entries;
+        // Tiles written since entries showing them were last looked for.
+        std::bitset<kTileCount> written_tiles;
+        // LCDC tile data area the entries were drawn with.
+        bool unsigned_tile_data{};
+    };
+    // Line of the layer of the tile map, with its entries drawn.
+    [[nodiscard]] std::span<const uint8_t, TileMapLayer::kSize> GetLayerLine(bool tile_map,
+                                                                            size_t y);
+
+    // Colours of the 4 colour indices, rebuilt when the palette register is written.
+    using Palette = std::array<Color, 4>;
+    [[nodiscard]] static Palette DecodePalette(uint8_t palette);
+
     void RenderScanline();
     void RenderSprites(size_t scanline_start);
 
-    [[nodiscard]] Color FetchTilePixel(uint8_t tile_idx, uint8_t x_off, uint8_t y_off,
-                                       uint8_t pal) const;
-    [[nodiscard]] Color FetchBackgroundPixel(uint8_t scan_x, uint8_t scan_y) const;
-    [[nodiscard]] Color FetchWindowPixel(uint8_t scan_x, uint8_t scan_y) const;
-
     LcdBuffer lcd_buf_{};
     std::array<uint8_t, 8192> vram_{};
-    std::array<Sprite, 40> oam_{};
-    std::vector<std::pair<size_t, Sprite>> scanline_sprite_buffer_;
+    std::array<uint8_t, 160> oam_{};
+    // Tile data changes far less often than it's drawn, so tiles are decoded once and again only
+    // after being written.
+    std::array<DecodedTile, kTileCount> tiles_{};
+    std::bitset<kTileCount> decoded_tiles_;
+    // At 0x9800 and 0x9c00.
+    std::array<TileMapLayer, 2> layers_{};
+    std::array<SpriteLine, kLcdHeight> sprite_lines_{};
+    bool sprite_lines_stale_{true};
+    // Sprites of the line being drawn, as they were at the end of its OAM scan.
+    std::array<Sprite, kMaxSpritesPerLine> line_sprites_{};
+    uint8_t line_sprite_count_{};
     std::bitset<kLcdSize> bg_transparency_;
     uint8_t interrupts_;
-    uint16_t cycles_{};
+    uint32_t cycles_{};
     bool should_draw_frame_{};
 
     LcdControl lcd_control_{0x91};
@@ -188,5 +279,8 @@ private:
     uint8_t window_x_{};
     uint8_t window_y_{};
     uint8_t window_line_counter_{};
+
+    Palette bg_palette_{DecodePalette(bgp_)};
+    std::array<Palette, 2> obj_palettes_{DecodePalette(obp0_), DecodePalette(obp1_)};
 };
 }  // namespace gb::video
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace gb::video::detail
+{
+// Y coordinates of the 40 sprites in OAM, padded to whole SSE registers. The padding never matches
+// a line on screen, as its sprites are hidden.
+using SpriteYs = std::array<uint8_t, 48>;
+
+// Bit i is set if sprite i is on line y, both in OAM coordinates, i.e. if y - ys[i] is a row of the
+// sprite. Lines above the sprite wrap around to rows past its height.
+inline uint64_t MatchSpriteRowsScalar(const SpriteYs& ys, uint8_t y, uint8_t height)
+{
+    uint64_t mask = 0;
+    for (size_t i = 0; i < ys.size(); ++i)
+    {
+        if (static_cast<uint8_t>(y - ys[i]) < height) { mask |= uint64_t{1} << i; }
+    }
+    return mask;
+}
+
+#if defined(__SSE2__)
+inline uint64_t MatchSpriteRowsSse2(const SpriteYs& ys, uint8_t y, uint8_t height)
+{
+    const __m128i line = _mm_set1_epi8(static_cast<char>(y));
+    const __m128i max_row = _mm_set1_epi8(static_cast<char>(height - 1));
+    uint64_t mask = 0;
+    for (size_t i = 0; i < ys.size(); i += 16)
+    {
+        const __m128i row =
+            _mm_sub_epi8(line, _mm_loadu_si128(reinterpret_cast<const __m128i*>(&ys[i])));
+        // row <= max_row, unsigned
+        const __m128i on_line = _mm_cmpeq_epi8(_mm_min_epu8(row, max_row), row);
+        mask |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(on_line))) << i;
+    }
+    return mask;
+}
+#endif
+
+inline uint64_t MatchSpriteRows(const SpriteYs& ys, uint8_t y, uint8_t height)
+{
+#if defined(__SSE2__)
+    return MatchSpriteRowsSse2(ys, y, height);
+#else
+    return MatchSpriteRowsScalar(ys, y, height);
+#endif
+}
+}  // namespace gb::video::detail
@@ -35,7 +35,8 @@ int main(int argc, char* argv[])
     const auto args{std::span(argv, static_cast<size_t>(argc))};
     if (args.size() < 2)
     {
-        LOG_ERROR("Usage: gbcxx <ROM>");
+        LOG_ERROR(
+            "Usage: gbcxx <ROM> [--quiet | --trace | --doctor-log | --trace-buffer | --profile]");
         return 1;
     }
 
@@ -72,7 +73,24 @@ int main(int argc, char* argv[])
     spdlog::set_level(spdlog::level::off);
 #endif
 
-    auto app = MainApp{rom_file};
+    // --doctor-log writes a gameboy-doctor log, --trace-buffer keeps the last instructions in
+    // memory and --profile counts cycles per routine. All of them run through a separately
+    // instantiated traced CPU loop. --trace only raises the log level of debug builds.
+    auto trace_mode = gb::sm83::TraceMode::None;
+    if (args.size() > 2 && std::string_view(args[2]) == "--doctor-log"sv)
+    {
+        trace_mode = gb::sm83::TraceMode::Doctor;
+    }
+    else if (args.size() > 2 && std::string_view(args[2]) == "--trace-buffer"sv)
+    {
+        trace_mode = gb::sm83::TraceMode::Ring;
+    }
+    else if (args.size() > 2 && std::string_view(args[2]) == "--profile"sv)
+    {
+        trace_mode = gb::sm83::TraceMode::Profile;
+    }
+
+    auto app = MainApp{rom_file, trace_mode};
 
 #ifdef __EMSCRIPTEN__
     emscripten_set_main_loop_arg(MainLoop, &app, 0, true);
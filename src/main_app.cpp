@@ -14,8 +14,9 @@ constexpr int kEmuScale = 4;
 #endif
 }  // namespace
 
-MainApp::MainApp(const std::filesystem::path& rom_file)
-    : core_(rom_file, [this](const gb::video::LcdBuffer& lcd_buf) { viewport_buf_ = lcd_buf; })
+MainApp::MainApp(const std::filesystem::path& rom_file, gb::sm83::TraceMode trace_mode)
+    : core_(rom_file, [this](const gb::video::LcdBuffer& lcd_buf) { viewport_buf_ = lcd_buf; },
+            trace_mode)
 {
     if (!SDL_Init(SDL_INIT_VIDEO)) { DIE("Error: SDL_Init(): {}", SDL_GetError()); }
     SDL_CreateWindowAndRenderer("gbcxx", gb::kLcdWidth * kEmuScale, gb::kLcdHeight * kEmuScale,
@@ -83,6 +84,9 @@ void MainApp::PollEvents()
                 core_.SetKeyState(ScancodeToGbInput(event.key.scancode),
                                   event.type == SDL_EVENT_KEY_DOWN);
                 break;
+            case SDL_SCANCODE_F12:
+                if (event.type == SDL_EVENT_KEY_DOWN) { core_.DumpTrace(); }
+                break;
             default: break;
             }
         }
@@ -7,7 +7,7 @@
 class MainApp
 {
 public:
-    explicit MainApp(const std::filesystem::path& rom_file);
+    explicit MainApp(const std::filesystem::path& rom_file, gb::sm83::TraceMode trace_mode);
     ~MainApp();
 
     void Step();
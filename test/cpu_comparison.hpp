@@ -0,0 +1,139 @@
+#pragma once
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <initializer_list>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "core/constants.hpp"
+#include "core/sm83/cpu.hpp"
+#include "core/sm83/tracer.hpp"
+
+namespace gb::test
+{
+// Runs the same program on two CPUs: one with Run(), which takes every shortcut the build enables,
+// i.e. fused loops, idle loop skipping and the decode cache, and one traced, which interprets every
+// instruction fetched from the bus. They must end up in the same state after every Run(), whether
+// it stops in the middle of a loop or not.
+class CpuComparisonTest : public ::testing::Test
+{
+protected:
+    explicit CpuComparisonTest(std::vector<uint8_t> rom) : rom_(std::move(rom)) { Reset(); }
+
+    // Powers both CPUs on again. Programs are loaded into new CPUs, as writes from outside of a CPU
+    // don't invalidate the code it has decoded.
+    void Reset()
+    {
+        if (fast_) { fused_cycles_ += fast_->GetFusedCycles(); }
+        fast_.emplace(rom_);
+        interpreted_.emplace(rom_);
+        for (sm83::Cpu* cpu : {&Fast(), &Interpreted()})
+        {
+            // WRAM and HRAM start out random.
+            for (uint16_t addr = kWorkRamStart; addr <= kWorkRamEnd; ++addr)
+            {
+                cpu->GetBus().WriteByte(addr, 0);
+            }
+            for (uint16_t addr = kHighRamStart; addr <= kHighRamEnd; ++addr)
+            {
+                cpu->GetBus().WriteByte(addr, 0);
+            }
+        }
+    }
+
+    sm83::Cpu& Fast() { return *fast_; }
+    sm83::Cpu& Interpreted() { return *interpreted_; }
+
+    // Cycles spent in fused loops since the test started.
+    [[nodiscard]] uint64_t GetFusedCycles() const
+    {
+        return fused_cycles_ + fast_->GetFusedCycles();
+    }
+
+    void Write(uint16_t addr, std::initializer_list<uint8_t> bytes)
+    {
+        for (sm83::Cpu* cpu : {&Fast(), &Interpreted()})
+        {
+            uint16_t offset = 0;
+            for (const uint8_t byte : bytes)
+            {
+                cpu->GetBus().WriteByte(static_cast<uint16_t>(addr + offset++), byte);
+            }
+        }
+    }
+
+    // Jumps to a program that has reached its end once PC is at end, usually a JR -2.
+    void Start(uint16_t pc, uint16_t end)
+    {
+        Fast().SetReg(sm83::R16::Pc, pc);
+        Interpreted().SetReg(sm83::R16::Pc, pc);
+        end_ = end;
+    }
+
+    // Resets the CPUs, loads the program, which ends in JR -2, and jumps to it.
+    void Load(uint16_t start, std::initializer_list<uint8_t> program)
+    {
+        Reset();
+        Write(start, program);
+        Start(start, static_cast<uint16_t>(start + program.size() - 2));
+    }
+
+    // Runs both CPUs in slices of the budget until the program reaches its end, comparing them
+    // after every slice.
+    void RunToEnd(uint32_t budget)
+    {
+        for (size_t slices = 0; Fast().GetReg(sm83::R16::Pc) != end_; ++slices)
+        {
+            ASSERT_LT(slices, 10000U) << "the program doesn't end";
+            ASSERT_NO_FATAL_FAILURE(RunSlice(budget)) << "slice " << slices;
+        }
+    }
+
+    // Runs both CPUs for the budget, or up to the end of a frame, and compares them.
+    void RunSlice(uint32_t budget)
+    {
+        Fast().GetBus().ppu.SetShouldDrawFrame(false);
+        Interpreted().GetBus().ppu.SetShouldDrawFrame(false);
+        ASSERT_EQ(Fast().Run(budget), Interpreted().Run(budget, tracer_));
+        ASSERT_NO_FATAL_FAILURE(ExpectSameState());
+    }
+
+    void ExpectSameState()
+    {
+        using enum sm83::R8;
+        using enum sm83::R16;
+        const sm83::Cpu& fast = Fast();
+        const sm83::Cpu& interpreted = Interpreted();
+        for (const sm83::R8 r : {A, B, C, D, E, H, L, F})
+        {
+            ASSERT_EQ(fast.GetReg(r), interpreted.GetReg(r)) << "register " << static_cast<int>(r);
+        }
+        ASSERT_EQ(fast.GetReg(Sp), interpreted.GetReg(Sp));
+        ASSERT_EQ(fast.GetReg(Pc), interpreted.GetReg(Pc));
+        ASSERT_EQ(fast.GetBus().scheduler.GetTimestamp(),
+                  interpreted.GetBus().scheduler.GetTimestamp());
+        for (const auto& [start, end] : {std::pair{kVramStart, kVramEnd},
+                                        std::pair{kWorkRamStart, kWorkRamEnd},
+                                        std::pair{kHighRamStart, kHighRamEnd}})
+        {
+            for (uint32_t addr = start; addr <= end; ++addr)
+            {
+                const auto addr16 = static_cast<uint16_t>(addr);
+                ASSERT_EQ(fast.GetBus().ReadByte(addr16), interpreted.GetBus().ReadByte(addr16))
+                    << "address " << addr;
+            }
+        }
+    }
+
+private:
+    std::vector<uint8_t> rom_;
+    std::optional<sm83::Cpu> fast_;
+    std::optional<sm83::Cpu> interpreted_;
+    uint64_t fused_cycles_{};
+    sm83::RingTracer tracer_{"cpu_comparison_test.trace"};
+    uint16_t end_{};
+};
+}  // namespace gb::test
@@ -0,0 +1,146 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <initializer_list>
+#include <vector>
+
+#include "core/util.hpp"
+#include "cpu_comparison.hpp"
+#include "test_rom.hpp"
+
+using namespace gb;
+using enum sm83::R8;
+
+namespace
+{
+void Put(std::vector<uint8_t>& rom, size_t offset, std::initializer_list<uint8_t> bytes)
+{
+    for (const uint8_t byte : bytes) { rom[offset++] = byte; }
+}
+
+// 64KiB with an MBC1, i.e. banks 1-3 can be mapped at 0x4000. The program at 0x0150 calls the
+// routine at 0x4000 of every bank, then the one at 0x4010 of bank 1, which maps bank 2 under its
+// own feet.
+std::vector<uint8_t> MakeBankedRom()
+{
+    std::vector<uint8_t> rom(64_KiB, 0x00);
+    // Cartridge type: MBC1, ROM size: 64KiB
+    rom[0x147] = 0x01;
+    rom[0x148] = 0x01;
+
+    Put(rom, 0x0150,
+        {
+            0x06, 0x00,        // LD B,0
+            0x3e, 0x01,        // LD A,1
+            0xea, 0x00, 0x20,  // LD (0x2000),A
+            0xcd, 0x00, 0x40,  // CALL 0x4000
+            0x3e, 0x02,        // LD A,2
+            0xea, 0x00, 0x20,  // LD (0x2000),A
+            0xcd, 0x00, 0x40,  // CALL 0x4000
+            0x3e, 0x03,        // LD A,3
+            0xea, 0x00, 0x20,  // LD (0x2000),A
+            0xcd, 0x00, 0x40,  // CALL 0x4000
+            0x3e, 0x01,        // LD A,1
+            0xea, 0x00, 0x20,  // LD (0x2000),A
+            0xcd, 0x00, 0x40,  // CALL 0x4000
+            0xcd, 0x10, 0x40,  // CALL 0x4010
+            0x18, 0xfe,        // JR -2
+        });
+    for (uint8_t bank = 1; bank <= 3; ++bank)
+    {
+        const size_t base = bank * 0x4000;
+        Put(rom, base,
+            {
+                0x78,        // LD A,B
+                0xc6, bank,  // ADD A,bank
+                0x47,        // LD B,A
+                0xc9,        // RET
+            });
+        Put(rom, base + 0x15,
+            {
+                0x0e, static_cast<uint8_t>(bank * 0x11),  // LD C,bank * 0x11
+                0xc9,                                     // RET
+            });
+    }
+    Put(rom, 0x4010,
+        {
+            0x3e, 0x02,        // LD A,2
+            0xea, 0x00, 0x20,  // LD (0x2000),A
+        });
+    return rom;
+}
+}  // namespace
+
+// Programs that change the code they run, compared against the interpreter. With
+// GBCXX_DECODE_CACHE, Run() executes them from cached blocks that these changes have to invalidate.
+class DecodeCacheTest : public test::CpuComparisonTest
+{
+protected:
+    DecodeCacheTest() : CpuComparisonTest(test::MakeRom(0x00)) {}
+
+    // Adds 1, 2, ..., 16 to A by incrementing the operand of an ADD A,n through patch_addr.
+    void RunPatchedAddLoop(uint16_t patch_addr)
+    {
+        const auto lo = static_cast<uint8_t>(patch_addr);
+        const auto hi = static_cast<uint8_t>(patch_addr >> 8);
+        Load(0xc000, {
+            0x06, 0x10,    // LD B,16
+            0x21, lo, hi,  // LD HL,patch_addr
+            0x34,          // INC (HL)
+            0x00,          // NOP
+            0x00,          // NOP
+            0xc6, 0x00,    // ADD A,0 (0xc008)
+            0x05,          // DEC B
+            0x20, 0xf8,    // JR NZ,-8
+            0x18, 0xfe,    // JR -2
+        });
+        Fast().SetReg(A, 0);
+        Interpreted().SetReg(A, 0);
+        RunToEnd(24);
+        if (HasFatalFailure()) { return; }
+        EXPECT_EQ(Fast().GetReg(A), 136);
+    }
+};
+
+TEST_F(DecodeCacheTest, SelfModifyingWramCode) { RunPatchedAddLoop(0xc009); }
+
+TEST_F(DecodeCacheTest, SelfModifyingCodeThroughEchoRam) { RunPatchedAddLoop(0xe009); }
+
+TEST_F(DecodeCacheTest, SelfModifyingHramCode)
+{
+    // Replaces the NOP in the loop, which was decoded with the rest of the program, by INC B.
+    Load(0xff80, {
+        0x06, 0x00,  // LD B,0
+        0x3e, 0x04,  // LD A,0x04
+        0xe0, 0x88,  // LDH (0x88),A
+        0x0e, 0x03,  // LD C,3
+        0x00,        // NOP (0xff88)
+        0x0d,        // DEC C
+        0x20, 0xfc,  // JR NZ,-4
+        0x18, 0xfe,  // JR -2
+    });
+    RunToEnd(24);
+    if (HasFatalFailure()) { return; }
+    EXPECT_EQ(Fast().GetReg(B), 3);
+}
+
+class DecodeCacheBankTest : public test::CpuComparisonTest
+{
+protected:
+    DecodeCacheBankTest() : CpuComparisonTest(MakeBankedRom()) {}
+};
+
+TEST_F(DecodeCacheBankTest, CodeSwitchingRomBanks)
+{
+    for (const uint32_t budget : {8U, 100U, 70224U})
+    {
+        SCOPED_TRACE(::testing::Message() << "budget " << budget);
+        Reset();
+        Start(0x0150, 0x0175);
+        RunToEnd(budget);
+        if (HasFatalFailure()) { return; }
+        // 1 + 2 + 3 + 1 from the routines at 0x4000, and bank 2's LD C after switching to it.
+        EXPECT_EQ(Fast().GetReg(B), 7);
+        EXPECT_EQ(Fast().GetReg(C), 0x22);
+    }
+}
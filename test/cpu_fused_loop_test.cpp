@@ -0,0 +1,124 @@
+#include <gtest/gtest.h>
+
+#include <array>
+#include <cstdint>
+#include <initializer_list>
+
+#include "cpu_comparison.hpp"
+#include "test_rom.hpp"
+
+using namespace gb;
+
+namespace
+{
+// The programs run from WRAM, the ROM is empty.
+constexpr uint16_t kProgramStart = 0xc000;
+}  // namespace
+
+class FusedLoopTest : public test::CpuComparisonTest
+{
+protected:
+    FusedLoopTest() : CpuComparisonTest(test::MakeRom(0x00)) {}
+
+    void Load(std::initializer_list<uint8_t> program)
+    {
+        CpuComparisonTest::Load(kProgramStart, program);
+    }
+
+    // Whether the loops were fused at all.
+    void ExpectFused() const
+    {
+#ifdef GBCXX_SUPERINSTRUCTIONS
+        EXPECT_GT(GetFusedCycles(), 0U);
+#endif
+    }
+};
+
+TEST_F(FusedLoopTest, CopyLoop)
+{
+    for (const uint32_t budget : {100U, 1234U, 70224U})
+    {
+        SCOPED_TRACE(::testing::Message() << "budget " << budget);
+        Load({
+            0x21, 0x00, 0xc8,  // LD HL,0xc800
+            0x11, 0x00, 0x88,  // LD DE,0x8800
+            0x01, 0x00, 0x06,  // LD BC,0x0600
+            0x2a,              // LD A,(HL+)
+            0x12,              // LD (DE),A
+            0x13,              // INC DE
+            0x0b,              // DEC BC
+            0x78,              // LD A,B
+            0xb1,              // OR C
+            0x20, 0xf8,        // JR NZ,-8
+            0x18, 0xfe,        // JR -2
+        });
+        for (uint16_t i = 0; i < 0x600; ++i)
+        {
+            Write(static_cast<uint16_t>(0xc800 + i), {static_cast<uint8_t>((i * 7) ^ (i >> 8))});
+        }
+        RunToEnd(budget);
+        if (HasFatalFailure()) { return; }
+    }
+    ExpectFused();
+}
+
+TEST_F(FusedLoopTest, CopyLoopIntoHram)
+{
+    Load({
+        0x21, 0x00, 0xd0,  // LD HL,0xd000
+        0x11, 0x80, 0xff,  // LD DE,0xff80
+        0x01, 0x08, 0x00,  // LD BC,0x0008
+        0x2a, 0x12, 0x13, 0x0b, 0x78, 0xb1, 0x20, 0xf8,
+        0x18, 0xfe,  // JR -2
+    });
+    Write(0xd000, {0x10, 0x20, 0x30, 0x40, 0x50, 0x60, 0x70, 0x80});
+    RunToEnd(70224);
+    ExpectFused();
+}
+
+TEST_F(FusedLoopTest, PollLoop)
+{
+    // Waits for VBlank twice, across a whole frame.
+    for (const uint32_t budget : {100U, 4567U, 70224U})
+    {
+        SCOPED_TRACE(::testing::Message() << "budget " << budget);
+        Load({
+            0xf0, 0x44,  // LDH A,(LY)
+            0xfe, 0x90,  // CP 144
+            0x20, 0xfa,  // JR NZ,-6
+            0xf0, 0x44,  // LDH A,(LY)
+            0xfe, 0x8f,  // CP 143
+            0x20, 0xfa,  // JR NZ,-6
+            0xf0, 0x44,  // LDH A,(LY)
+            0xfe, 0x90,  // CP 144
+            0x20, 0xfa,  // JR NZ,-6
+            0x18, 0xfe,  // JR -2
+        });
+        RunToEnd(budget);
+        if (HasFatalFailure()) { return; }
+    }
+    ExpectFused();
+}
+
+TEST_F(FusedLoopTest, DecLoop)
+{
+    // B, C, D, E, H, L and A, skipping (HL).
+    for (const uint8_t r : std::to_array<uint8_t>({0, 1, 2, 3, 4, 5, 7}))
+    {
+        for (const uint8_t count : std::to_array<uint8_t>({1, 2, 0x80, 0}))
+        {
+            SCOPED_TRACE(::testing::Message() << "register " << int{r} << " count " << int{count});
+            const auto ld = static_cast<uint8_t>(0x06 + (r * 8));
+            const auto dec = static_cast<uint8_t>(0x05 + (r * 8));
+            Load({
+                ld, count,   // LD r,count
+                dec,         // DEC r
+                0x20, 0xfd,  // JR NZ,-3
+                0x18, 0xfe,  // JR -2
+            });
+            RunToEnd(1000);
+            if (HasFatalFailure()) { return; }
+        }
+    }
+    ExpectFused();
+}
@@ -0,0 +1,401 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <initializer_list>
+#include <vector>
+
+#include "core/util.hpp"
+#include "cpu_comparison.hpp"
+#include "test_rom.hpp"
+
+using namespace gb;
+
+namespace
+{
+// The programs start in ROM and end in JR -2.
+constexpr uint16_t kProgramStart = 0x0150;
+
+void Put(std::vector<uint8_t>& rom, size_t offset, std::initializer_list<uint8_t> bytes)
+{
+    for (const uint8_t byte : bytes) { rom[offset++] = byte; }
+}
+
+// Mixes 8-bit arithmetic and logic, flag operations, INC and DEC on (HL), DAA and PUSH AF over
+// 256 bytes of WRAM.
+std::vector<uint8_t> MakeAluRom()
+{
+    std::vector<uint8_t> rom = test::MakeRom(0x00);
+    Put(rom, kProgramStart,
+        {
+            0x21, 0x00, 0xc0,  // LD HL,0xc000
+            0x0e, 0x00,        // LD C,0
+            0xaf,              // XOR A
+            0x86,              // ADD A,(HL)
+            0x8e,              // ADC A,(HL)
+            0x47,              // LD B,A
+            0x96,              // SUB (HL)
+            0x9e,              // SBC A,(HL)
+            0xa0,              // AND B
+            0x27,              // DAA
+            0xb0,              // OR B
+            0xa8,              // XOR B
+            0xb8,              // CP B
+            0xce, 0x13,        // ADC A,0x13
+            0xde, 0x07,        // SBC A,0x07
+            0xc6, 0xf0,        // ADD A,0xf0
+            0xd6, 0x0d,        // SUB 0x0d
+            0xe6, 0xf3,        // AND 0xf3
+            0xee, 0x5a,        // XOR 0x5a
+            0xf6, 0x01,        // OR 0x01
+            0xfe, 0x80,        // CP 0x80
+            0x3c,              // INC A
+            0x05,              // DEC B
+            0x34,              // INC (HL)
+            0x35,              // DEC (HL)
+            0x35,              // DEC (HL)
+            0x2f,              // CPL
+            0x37,              // SCF
+            0x3f,              // CCF
+            0x17,              // RLA
+            0x07,              // RLCA
+            0x1f,              // RRA
+            0x0f,              // RRCA
+            0x88,              // ADC A,B
+            0xf5,              // PUSH AF
+            0xd1,              // POP DE
+            0x7b,              // LD A,E
+            0xaa,              // XOR D
+            0x22,              // LD (HL+),A
+            0x0d,              // DEC C
+            0x20, 0xd1,        // JR NZ,-47
+            0x18, 0xfe,        // JR -2
+        });
+    return rom;
+}
+
+// Every CB operation on registers and (HL), flags carried over in DE.
+std::vector<uint8_t> MakeCbRom()
+{
+    std::vector<uint8_t> rom = test::MakeRom(0x00);
+    Put(rom, kProgramStart,
+        {
+            0x21, 0x00, 0xc0,  // LD HL,0xc000
+            0x0e, 0x00,        // LD C,0
+            0xae,              // XOR (HL)
+            0x47,              // LD B,A
+            0xcb, 0x00,        // RLC B
+            0xcb, 0x10,        // RL B
+            0xcb, 0x1a,        // RR D
+            0xcb, 0x23,        // SLA E
+            0xcb, 0x2f,        // SRA A
+            0xcb, 0x37,        // SWAP A
+            0xcb, 0x38,        // SRL B
+            0xcb, 0x08,        // RRC B
+            0xcb, 0x06,        // RLC (HL)
+            0xcb, 0x0e,        // RRC (HL)
+            0xcb, 0x16,        // RL (HL)
+            0xcb, 0x1e,        // RR (HL)
+            0xcb, 0x26,        // SLA (HL)
+            0xcb, 0x2e,        // SRA (HL)
+            0xcb, 0x36,        // SWAP (HL)
+            0xcb, 0x3e,        // SRL (HL)
+            0xcb, 0x46,        // BIT 0,(HL)
+            0xcb, 0x7f,        // BIT 7,A
+            0xcb, 0x50,        // BIT 2,B
+            0xcb, 0x86,        // RES 0,(HL)
+            0xcb, 0xfe,        // SET 7,(HL)
+            0xcb, 0xa8,        // RES 5,B
+            0xcb, 0xd3,        // SET 2,E
+            0xf5,              // PUSH AF
+            0xd1,              // POP DE
+            0xa8,              // XOR B
+            0xaa,              // XOR D
+            0xab,              // XOR E
+            0x23,              // INC HL
+            0x0d,              // DEC C
+            0x20, 0xc7,        // JR NZ,-57
+            0x18, 0xfe,        // JR -2
+        });
+    return rom;
+}
+
+// Conditional and unconditional CALL, RET, JP, JR and RST, JP HL, the stack, 16-bit arithmetic
+// and every form of load, including DIV and LY, which read differently on every cycle.
+std::vector<uint8_t> MakeBranchRom()
+{
+    std::vector<uint8_t> rom = test::MakeRom(0x00);
+    Put(rom, kProgramStart,
+        {
+            0x31, 0xfe, 0xdf,  // LD SP,0xdffe
+            0x06, 0x40,        // LD B,0x40
+            0x21, 0x00, 0xc1,  // LD HL,0xc100
+            0x78,              // LD A,B
+            0xe6, 0x03,        // AND 3
+            0xcc, 0x00, 0x02,  // CALL Z,0x0200
+            0xc4, 0x10, 0x02,  // CALL NZ,0x0210
+            0xe0, 0x90,        // LDH (0x90),A
+            0xf0, 0x04,        // LDH A,(DIV)
+            0xea, 0x00, 0xc2,  // LD (0xc200),A
+            0xfa, 0x44, 0xff,  // LD A,(LY)
+            0x0e, 0x92,        // LD C,0x92
+            0xe2,              // LDH (C),A
+            0xf2,              // LDH A,(C)
+            0x22,              // LD (HL+),A
+            0x32,              // LD (HL-),A
+            0x2a,              // LD A,(HL+)
+            0x3a,              // LD A,(HL-)
+            0xe5,              // PUSH HL
+            0x11, 0x34, 0x12,  // LD DE,0x1234
+            0x19,              // ADD HL,DE
+            0x29,              // ADD HL,HL
+            0x39,              // ADD HL,SP
+            0xf5,              // PUSH AF
+            0xd1,              // POP DE
+            0x7d,              // LD A,L
+            0xac,              // XOR H
+            0xab,              // XOR E
+            0xe1,              // POP HL
+            0x77,              // LD (HL),A
+            0x23,              // INC HL
+            0x13,              // INC DE
+            0x1b,              // DEC DE
+            0x0b,              // DEC BC
+            0x03,              // INC BC
+            0xc5,              // PUSH BC
+            0xf1,              // POP AF
+            0x1f,              // RRA
+            0xea, 0x02, 0xc2,  // LD (0xc202),A
+            0x05,              // DEC B
+            0xc2, 0x58, 0x01,  // JP NZ,0x0158
+            0xef,              // RST 0x28
+            0xc3, 0xa0, 0x01,  // JP 0x01a0
+        });
+    Put(rom, 0x01a0,
+        {
+            0x21, 0xb0, 0x01,  // LD HL,0x01b0
+            0xe9,              // JP HL
+        });
+    Put(rom, 0x01b0, {0x18, 0xfe});  // JR -2
+    Put(rom, 0x0028, {0xc9});        // RET
+    // Called with A = 0.
+    Put(rom, 0x0200,
+        {
+            0x3c,  // INC A
+            0xc8,  // RET Z
+            0x3d,  // DEC A
+            0xc0,  // RET NZ
+            0xd8,  // RET C
+            0xd0,  // RET NC
+        });
+    // Called with A = 1-3.
+    Put(rom, 0x0210,
+        {
+            0x87,              // ADD A,A
+            0x30, 0x01,        // JR NC,+1
+            0x3c,              // INC A
+            0x38, 0x01,        // JR C,+1
+            0x3c,              // INC A
+            0xca, 0x20, 0x02,  // JP Z,0x0220
+            0xda, 0x20, 0x02,  // JP C,0x0220
+            0xd2, 0x20, 0x02,  // JP NC,0x0220
+        });
+    Put(rom, 0x0220, {0xc9});  // RET
+    return rom;
+}
+
+// Counts in C until the timer interrupt handler has run 32 times, then waits for another 32 in
+// HALT.
+std::vector<uint8_t> MakeInterruptRom()
+{
+    std::vector<uint8_t> rom = test::MakeRom(0x00);
+    Put(rom, kProgramStart,
+        {
+            0x3e, 0xf0,        // LD A,0xf0
+            0xe0, 0x06,        // LDH (TMA),A
+            0x3e, 0x04,        // LD A,4
+            0xe0, 0xff,        // LDH (IE),A
+            0x3e, 0x05,        // LD A,5
+            0xe0, 0x07,        // LDH (TAC),A
+            0xaf,              // XOR A
+            0xe0, 0x0f,        // LDH (IF),A
+            0x21, 0x00, 0xc0,  // LD HL,0xc000
+            0xfb,              // EI
+            0x0c,              // INC C
+            0x7e,              // LD A,(HL)
+            0xfe, 0x20,        // CP 0x20
+            0x20, 0xfa,        // JR NZ,-6
+            0x76,              // HALT
+            0x7e,              // LD A,(HL)
+            0xfe, 0x40,        // CP 0x40
+            0x20, 0xfa,        // JR NZ,-6
+            0xf3,              // DI
+            0xea, 0x01, 0xc0,  // LD (0xc001),A
+            0x18, 0xfe,        // JR -2
+        });
+    Put(rom, 0x0050,
+        {
+            0xe5,              // PUSH HL
+            0x21, 0x00, 0xc0,  // LD HL,0xc000
+            0x34,              // INC (HL)
+            0xe1,              // POP HL
+            0xd9,              // RETI
+        });
+    return rom;
+}
+
+// 64KiB with an MBC1. Bank n holds LD A,n * 0x11 and RET at 0x4000.
+std::vector<uint8_t> MakeBankedRom()
+{
+    std::vector<uint8_t> rom(64_KiB, 0x00);
+    // Cartridge type: MBC1, ROM size: 64KiB
+    rom[0x147] = 0x01;
+    rom[0x148] = 0x01;
+    for (uint8_t bank = 1; bank < 4; ++bank)
+    {
+        Put(rom, bank * 16_KiB, {0x3e, static_cast<uint8_t>(bank * 0x11), 0xc9});
+    }
+    Put(rom, kProgramStart,
+        {
+            0x3e, 0x02,        // LD A,2
+            0xea, 0x00, 0x20,  // LD (0x2000),A
+            0xcd, 0x00, 0x40,  // CALL 0x4000
+            0xea, 0x00, 0xc0,  // LD (0xc000),A
+            0x3e, 0x03,        // LD A,3
+            0xea, 0x00, 0x20,  // LD (0x2000),A
+            0xcd, 0x00, 0x40,  // CALL 0x4000
+            0xea, 0x01, 0xc0,  // LD (0xc001),A
+            0x3e, 0x01,        // LD A,1
+            0xea, 0x00, 0x20,  // LD (0x2000),A
+            0xcd, 0x00, 0x40,  // CALL 0x4000
+            0xea, 0x02, 0xc0,  // LD (0xc002),A
+            0x18, 0xfe,        // JR -2
+        });
+    return rom;
+}
+
+// Copies a routine to WRAM and calls it 16 times. It increments its own LD A,n operand.
+std::vector<uint8_t> MakeSelfModifyingRom()
+{
+    std::vector<uint8_t> rom = test::MakeRom(0x00);
+    Put(rom, kProgramStart,
+        {
+            0x21, 0x00, 0xc1,  // LD HL,0xc100
+            0x11, 0x80, 0x01,  // LD DE,0x0180
+            0x0e, 0x07,        // LD C,7
+            0x1a,              // LD A,(DE)
+            0x22,              // LD (HL+),A
+            0x13,              // INC DE
+            0x0d,              // DEC C
+            0x20, 0xfa,        // JR NZ,-6
+            0x06, 0x10,        // LD B,16
+            0xcd, 0x00, 0xc1,  // CALL 0xc100
+            0x05,              // DEC B
+            0x20, 0xfa,        // JR NZ,-6
+            0xea, 0x00, 0xc0,  // LD (0xc000),A
+            0x18, 0xfe,        // JR -2
+        });
+    Put(rom, 0x0180,
+        {
+            0x3e, 0x00,        // LD A,0
+            0x3c,              // INC A
+            0xea, 0x01, 0xc1,  // LD (0xc101),A
+            0xc9,              // RET
+        });
+    return rom;
+}
+}  // namespace
+
+class JitTest : public test::CpuComparisonTest
+{
+protected:
+    explicit JitTest(std::vector<uint8_t> rom) : CpuComparisonTest(std::move(rom)) {}
+
+    // Runs the program from the start with each budget, WRAM filled with a pattern.
+    void RunProgram(uint16_t end)
+    {
+        for (const uint32_t budget : {24U, 1000U, 70224U})
+        {
+            SCOPED_TRACE(::testing::Message() << "budget " << budget);
+            Reset();
+            for (uint16_t i = 0; i < 0x200; ++i)
+            {
+                Write(static_cast<uint16_t>(kWorkRamStart + i),
+                      {static_cast<uint8_t>((i * 37) ^ (i >> 3))});
+            }
+            Start(kProgramStart, end);
+            RunToEnd(budget);
+            if (HasFatalFailure()) { return; }
+        }
+        ExpectCompiled();
+    }
+
+    // Whether the program ran in compiled code at all.
+    void ExpectCompiled()
+    {
+#ifdef GBCXX_JIT
+        EXPECT_GT(Fast().GetJitCycles(), 0U);
+#endif
+    }
+};
+
+class JitAluTest : public JitTest
+{
+protected:
+    JitAluTest() : JitTest(MakeAluRom()) {}
+};
+
+class JitCbTest : public JitTest
+{
+protected:
+    JitCbTest() : JitTest(MakeCbRom()) {}
+};
+
+class JitBranchTest : public JitTest
+{
+protected:
+    JitBranchTest() : JitTest(MakeBranchRom()) {}
+};
+
+class JitInterruptTest : public JitTest
+{
+protected:
+    JitInterruptTest() : JitTest(MakeInterruptRom()) {}
+};
+
+class JitBankTest : public JitTest
+{
+protected:
+    JitBankTest() : JitTest(MakeBankedRom()) {}
+};
+
+class JitSelfModifyingTest : public JitTest
+{
+protected:
+    JitSelfModifyingTest() : JitTest(MakeSelfModifyingRom()) {}
+};
+
+TEST_F(JitAluTest, ArithmeticAndLogic) { RunProgram(0x0185); }
+
+TEST_F(JitCbTest, CbInstructions) { RunProgram(0x018e); }
+
+TEST_F(JitBranchTest, BranchesStackAndLoads) { RunProgram(0x01b0); }
+
+TEST_F(JitInterruptTest, InterruptsAndHalt)
+{
+    RunProgram(0x0173);
+    EXPECT_EQ(Fast().GetBus().ReadByte(0xc001), 0x40);
+}
+
+TEST_F(JitBankTest, LeavesAfterBankSwitch)
+{
+    RunProgram(0x0171);
+    EXPECT_EQ(Fast().GetBus().ReadByte(0xc000), 0x22);
+    EXPECT_EQ(Fast().GetBus().ReadByte(0xc001), 0x33);
+    EXPECT_EQ(Fast().GetBus().ReadByte(0xc002), 0x11);
+}
+
+TEST_F(JitSelfModifyingTest, RecompilesOverwrittenRam)
+{
+    RunProgram(0x0169);
+    EXPECT_EQ(Fast().GetBus().ReadByte(0xc000), 16);
+}
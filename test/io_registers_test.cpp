@@ -0,0 +1,56 @@
+#include <gtest/gtest.h>
+
+#include "core/constants.hpp"
+#include "core/memory/bus.hpp"
+#include "test_rom.hpp"
+
+using namespace gb;
+
+class IoRegistersTest : public ::testing::Test
+{
+protected:
+    memory::Bus bus{test::MakeRom(0x00)};
+};
+
+TEST_F(IoRegistersTest, WriteOnlyRegistersReadFf)
+{
+    for (const uint16_t addr : {kRegNr13, kRegNr23, kRegNr31, kRegNr33, kRegNr41})
+    {
+        bus.WriteByte(addr, 0x00);
+        EXPECT_EQ(bus.ReadByte(addr), 0xff) << std::hex << addr;
+    }
+}
+
+TEST_F(IoRegistersTest, UnusedBitsReadOne)
+{
+    bus.WriteByte(kRegSc, 0x00);
+    EXPECT_EQ(bus.ReadByte(kRegSc), 0x7e);
+    bus.WriteByte(kRegNr10, 0x00);
+    EXPECT_EQ(bus.ReadByte(kRegNr10), 0x80);
+    // The length timer is write-only, the duty cycle isn't.
+    bus.WriteByte(kRegNr11, 0x80);
+    EXPECT_EQ(bus.ReadByte(kRegNr11), 0xbf);
+    // Only the length enable bit of the control registers reads back.
+    bus.WriteByte(kRegNr14, 0x40);
+    EXPECT_EQ(bus.ReadByte(kRegNr14), 0xff);
+    bus.WriteByte(kRegNr44, 0x00);
+    EXPECT_EQ(bus.ReadByte(kRegNr44), 0xbf);
+}
+
+TEST_F(IoRegistersTest, ReadWriteRegistersReadWhatWasWritten)
+{
+    for (const uint16_t addr : {kRegSb, kRegNr12, kRegNr22, kRegNr42, kRegNr43, kRegNr50,
+                                kRegNr51, kWavePatternStart, kWavePatternEnd})
+    {
+        bus.WriteByte(addr, 0x5a);
+        EXPECT_EQ(bus.ReadByte(addr), 0x5a) << std::hex << addr;
+    }
+}
+
+TEST_F(IoRegistersTest, Nr52ChannelStatusIsntWritable)
+{
+    bus.WriteByte(kRegNr52, 0x8f);
+    EXPECT_EQ(bus.ReadByte(kRegNr52), 0xf0);
+    bus.WriteByte(kRegNr52, 0x0f);
+    EXPECT_EQ(bus.ReadByte(kRegNr52), 0x70);
+}
@@ -0,0 +1,251 @@
+#include <gtest/gtest.h>
+
+#include <array>
+#include <vector>
+
+#include "core/constants.hpp"
+#include "core/memory/bus.hpp"
+#include "cpu_comparison.hpp"
+#include "test_rom.hpp"
+
+using namespace gb;
+
+namespace
+{
+constexpr uint32_t kStartDelay = 4;
+constexpr uint32_t kDuration = 640;
+constexpr size_t kOamSize = kOamEnd - kOamStart + 1;
+
+// What the ROM reads outside of its header.
+constexpr uint8_t kRomByte = 0xee;
+
+uint8_t GetPattern(uint16_t page, size_t idx) { return static_cast<uint8_t>(page + (idx * 3)); }
+
+// INC A up to a RET at 0x02ff.
+std::vector<uint8_t> MakeIncRom()
+{
+    std::vector<uint8_t> rom = test::MakeRom(0x3c);
+    rom[0x02ff] = 0xc9;
+    return rom;
+}
+}  // namespace
+
+class OamDmaTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        // OAM is always accessible with the LCD off.
+        bus.WriteByte(kRegLcdc, 0);
+        Advance(4);
+        for (const uint16_t page : std::to_array<uint16_t>({0xc1, 0xc2, 0x80}))
+        {
+            for (size_t i = 0; i < kOamSize; ++i)
+            {
+                bus.WriteByte(static_cast<uint16_t>((page << 8) + i), GetPattern(page, i));
+            }
+        }
+    }
+
+    void Advance(uint32_t tcycles)
+    {
+        for (; tcycles > 0xffff; tcycles -= 0xffff) { bus.Tick(0xffff); }
+        bus.Tick(static_cast<uint16_t>(tcycles));
+    }
+
+    std::array<uint8_t, kOamSize> ReadOam() const
+    {
+        std::array<uint8_t, kOamSize> oam{};
+        for (size_t i = 0; i < oam.size(); ++i)
+        {
+            oam[i] = bus.ReadByte(static_cast<uint16_t>(kOamStart + i));
+        }
+        return oam;
+    }
+
+    static std::array<uint8_t, kOamSize> GetPage(uint16_t page)
+    {
+        std::array<uint8_t, kOamSize> data{};
+        for (size_t i = 0; i < data.size(); ++i) { data[i] = GetPattern(page, i); }
+        return data;
+    }
+
+    memory::Bus bus{test::MakeRom(kRomByte)};
+};
+
+TEST_F(OamDmaTest, CopiesPageAfterDelayAndDuration)
+{
+    bus.WriteByte(kRegOamDma, 0xc1);
+    EXPECT_EQ(bus.ReadByte(kRegOamDma), 0xc1);
+
+    Advance(kStartDelay + kDuration - 1);
+    EXPECT_TRUE(bus.oam_dma.active);
+
+    Advance(1);
+    EXPECT_FALSE(bus.oam_dma.active);
+    EXPECT_EQ(ReadOam(), GetPage(0xc1));
+}
+
+TEST_F(OamDmaTest, OamReadsFfDuringTransfer)
+{
+    bus.WriteByte(kRegOamDma, 0xc1);
+    Advance(kStartDelay + kDuration - 1);
+    for (uint16_t addr = kOamStart; addr <= kOamEnd; ++addr)
+    {
+        EXPECT_EQ(bus.ReadByte(addr), 0xff);
+    }
+}
+
+TEST_F(OamDmaTest, DmaBusReadsByteBeingTransferred)
+{
+    bus.WriteByte(kRegOamDma, 0xc1);
+
+    // The first byte is copied after the start delay, and keeps being seen until then.
+    EXPECT_EQ(bus.ReadByte(0xc000), GetPattern(0xc1, 0));
+    Advance(kStartDelay + 3);
+    EXPECT_EQ(bus.ReadByte(0xc000), GetPattern(0xc1, 0));
+    Advance(1);
+    EXPECT_EQ(bus.ReadByte(0xc000), GetPattern(0xc1, 1));
+
+    // Any address on the external bus, cartridge included.
+    Advance(4 * 9);
+    EXPECT_EQ(bus.ReadByte(0xd123), GetPattern(0xc1, 10));
+    EXPECT_EQ(bus.ReadByte(0x0150), GetPattern(0xc1, 10));
+    EXPECT_EQ(bus.ReadByte(0x4000), GetPattern(0xc1, 10));
+
+    // The VRAM bus and HRAM aren't affected.
+    EXPECT_EQ(bus.ReadByte(0x8000), GetPattern(0x80, 0));
+    bus.WriteByte(kHighRamStart, 0x42);
+    EXPECT_EQ(bus.ReadByte(kHighRamStart), 0x42);
+
+    Advance(kDuration);
+    EXPECT_EQ(bus.ReadByte(0xc100), GetPattern(0xc1, 0));
+    EXPECT_EQ(bus.ReadByte(0x0150), kRomByte);
+}
+
+TEST_F(OamDmaTest, VramSourceBlocksVramBus)
+{
+    bus.WriteByte(kRegOamDma, 0x80);
+    Advance(kStartDelay + (4 * 5));
+    EXPECT_EQ(bus.ReadByte(0x9abc), GetPattern(0x80, 5));
+    EXPECT_EQ(bus.ReadByte(0xc100), GetPattern(0xc1, 0));
+
+    Advance(kDuration);
+    EXPECT_EQ(ReadOam(), GetPage(0x80));
+}
+
+TEST_F(OamDmaTest, DropsWritesToDmaBusAndOam)
+{
+    bus.WriteByte(0xd000, 0x11);
+    bus.WriteByte(kRegOamDma, 0xc1);
+    Advance(kStartDelay);
+
+    bus.WriteByte(0xc150, 0x42);
+    bus.WriteByte(0xd000, 0x42);
+    bus.WriteByte(kOamStart + 3, 0x42);
+    // Off the DMA bus.
+    bus.WriteByte(0x8000, 0x42);
+
+    Advance(kDuration);
+    EXPECT_EQ(bus.ReadByte(0xc150), GetPattern(0xc1, 0x50));
+    EXPECT_EQ(bus.ReadByte(0xd000), 0x11);
+    EXPECT_EQ(ReadOam(), GetPage(0xc1));
+    EXPECT_EQ(bus.ReadByte(0x8000), 0x42);
+}
+
+TEST_F(OamDmaTest, SourcesPastWramReadWram)
+{
+    bus.WriteByte(kRegOamDma, 0xe1);
+    EXPECT_EQ(bus.ReadByte(kRegOamDma), 0xe1);
+    Advance(kStartDelay + (4 * 7));
+    EXPECT_EQ(bus.ReadByte(0xc000), GetPattern(0xc1, 7));
+
+    Advance(kDuration);
+    EXPECT_EQ(ReadOam(), GetPage(0xc1));
+}
+
+TEST_F(OamDmaTest, RestartDuringTransfer)
+{
+    bus.WriteByte(kRegOamDma, 0xc1);
+    Advance(100);
+    bus.WriteByte(kRegOamDma, 0xc2);
+
+    // Restarted from the new source, with its own delay.
+    EXPECT_EQ(bus.ReadByte(0xc000), GetPattern(0xc2, 0));
+    Advance(kStartDelay + (4 * 2));
+    EXPECT_EQ(bus.ReadByte(0xc000), GetPattern(0xc2, 2));
+
+    // The first transfer would have finished here.
+    Advance(kDuration - 100);
+    EXPECT_TRUE(bus.oam_dma.active);
+
+    Advance(100 - (4 * 2));
+    EXPECT_FALSE(bus.oam_dma.active);
+    EXPECT_EQ(ReadOam(), GetPage(0xc2));
+}
+
+TEST_F(OamDmaTest, RestartFromOtherBus)
+{
+    bus.WriteByte(kRegOamDma, 0x80);
+    Advance(100);
+    bus.WriteByte(kRegOamDma, 0xc1);
+
+    // The VRAM bus is free again.
+    EXPECT_EQ(bus.ReadByte(0x8000), GetPattern(0x80, 0));
+    EXPECT_EQ(bus.ReadByte(0xc000), GetPattern(0xc1, 0));
+
+    Advance(kStartDelay + kDuration);
+    EXPECT_EQ(ReadOam(), GetPage(0xc1));
+}
+
+// Code on the bus of an OAM DMA executes the bytes being transferred, compared against the
+// interpreter. Cached blocks and compiled code must not run the code hidden by them.
+class OamDmaCpuTest : public test::CpuComparisonTest
+{
+protected:
+    OamDmaCpuTest() : CpuComparisonTest(MakeIncRom()) {}
+
+    // Calls the routine once to get it decoded, then again right after starting a DMA from 0xc100,
+    // i.e. INC B.
+    void RunRoutineDuringDma(uint16_t routine, uint32_t budget)
+    {
+        const auto lo = static_cast<uint8_t>(routine);
+        const auto hi = static_cast<uint8_t>(routine >> 8);
+        Load(kHighRamStart, {
+            0xcd, lo, hi,  // CALL routine
+            0x3e, 0xc1,    // LD A,0xc1
+            0xe0, 0x46,    // LDH (0x46),A
+            0xcd, lo, hi,  // CALL routine
+            0x18, 0xfe,    // JR -2
+        });
+        for (uint16_t addr = 0xc000; addr < 0xc0ff; ++addr) { Write(addr, {0x3c}); }
+        Write(0xc0ff, {0xc9});
+        for (size_t i = 0; i < kOamSize; ++i) { Write(static_cast<uint16_t>(0xc100 + i), {0x04}); }
+        Fast().SetReg(sm83::R8::B, 0);
+        Interpreted().SetReg(sm83::R8::B, 0);
+        RunToEnd(budget);
+        if (HasFatalFailure()) { return; }
+        // Most of the transfer is spent in the routine.
+        EXPECT_GT(Fast().GetReg(sm83::R8::B), 100);
+    }
+};
+
+TEST_F(OamDmaCpuTest, RomCodeDuringDma)
+{
+    for (const uint32_t budget : {24U, 70224U})
+    {
+        SCOPED_TRACE(::testing::Message() << "budget " << budget);
+        RunRoutineDuringDma(0x0200, budget);
+        if (HasFatalFailure()) { return; }
+    }
+}
+
+TEST_F(OamDmaCpuTest, WramCodeDuringDma)
+{
+    for (const uint32_t budget : {24U, 70224U})
+    {
+        SCOPED_TRACE(::testing::Message() << "budget " << budget);
+        RunRoutineDuringDma(0xc000, budget);
+        if (HasFatalFailure()) { return; }
+    }
+}
@@ -0,0 +1,564 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <random>
+#include <span>
+#include <vector>
+
+#include "core/constants.hpp"
+#include "core/video/ppu.hpp"
+#include "core/video/sprite_rows.hpp"
+
+using namespace gb;
+using video::Color;
+
+namespace
+{
+using Line = std::array<Color, kLcdWidth>;
+
+constexpr Color kWhite{0xff, 0xff, 0xff};
+constexpr Color kLightGray{0xaa, 0xaa, 0xaa};
+constexpr Color kDarkGray{0x55, 0x55, 0x55};
+constexpr Color kBlack{0x00, 0x00, 0x00};
+constexpr std::array kShades{kWhite, kLightGray, kDarkGray, kBlack};
+
+// Maps colour index i to shade i.
+constexpr uint8_t kIdentityPalette = 0b11'10'01'00;
+
+// The PPU as it was before tiles, tile maps and the sprites on every line were cached: every pixel
+// is fetched from VRAM on its own, and OAM is scanned for the sprites of every line. Reads the
+// PPU's state through its registers, so it must be called for every line the PPU renders, right
+// after it was rendered, to follow the window.
+class ReferenceRenderer
+{
+public:
+    explicit ReferenceRenderer(const video::Ppu& ppu) : ppu_(ppu) {}
+
+    Line RenderLine(uint8_t ly)
+    {
+        const video::LcdControl lcdc{Read(kRegLcdc)};
+        const uint8_t wx = Read(kRegWx);
+        const uint8_t wy = Read(kRegWy);
+
+        // The window's line counter restarts with every frame, and only advances past lines it
+        // was enabled on. The first frame after the LCD is turned on starts at line 1.
+        if (ly != last_ly_ + 1) { window_line_ = 0; }
+        last_ly_ = ly;
+        if (ly > 0 && lcdc.WindowEnabled() && wx - 7 < kLcdWidth && wy < kLcdHeight &&
+            ly - 1 >= wy)
+        {
+            ++window_line_;
+        }
+
+        Line line;
+        std::array<bool, kLcdWidth> bg_transparent{};
+        for (int x = 0; x < kLcdWidth; ++x)
+        {
+            const auto px = static_cast<size_t>(x);
+            if (!lcdc.BgWinEnabled())
+            {
+                line[px] = kWhite;
+                bg_transparent[px] = true;
+                continue;
+            }
+
+            uint8_t color_idx{};
+            if (lcdc.WindowEnabled() && ly >= wy && x >= wx - 7)
+            {
+                const auto win_x = static_cast<uint8_t>(x - (wx - 7));
+                const uint8_t tile_idx = Read(static_cast<uint16_t>(
+                    lcdc.GetWindowTileMapAddress() + ((window_line_ / 8) * 32) + (win_x / 8)));
+                color_idx = GetColorIndex(lcdc.GetTileAddress(tile_idx), (ly - wy) % 8, win_x % 8);
+            }
+            else
+            {
+                const auto bg_x = static_cast<uint8_t>(x + Read(kRegScx));
+                const auto bg_y = static_cast<uint8_t>(ly + Read(kRegScy));
+                const uint8_t tile_idx = Read(static_cast<uint16_t>(
+                    lcdc.GetBackgroundTileMapAddress() + ((bg_y / 8) * 32) + (bg_x / 8)));
+                color_idx = GetColorIndex(lcdc.GetTileAddress(tile_idx), bg_y % 8, bg_x % 8);
+            }
+            line[px] = GetColor(Read(kRegBgp), color_idx);
+            bg_transparent[px] = line[px] == kWhite;
+        }
+
+        if (lcdc.ObjEnabled())
+        {
+            for (const auto& [idx, sprite] : ScanOam(ly, lcdc.GetSpriteHeight()))
+            {
+                const uint8_t tile_idx =
+                    lcdc.ObjTallSize() ? (sprite.tile_index & 0xfe) : sprite.tile_index;
+                auto row = static_cast<uint8_t>(ly + 16 - sprite.y);
+                if (sprite.flags.YFlip())
+                {
+                    row = static_cast<uint8_t>(lcdc.GetSpriteHeight() - 1 - row);
+                }
+
+                for (int px = 0; px < 8; ++px)
+                {
+                    const int x = sprite.x - 8 + px;
+                    if (x < 0 || x >= kLcdWidth) { continue; }
+                    if (sprite.flags.BgWinPriority() && !bg_transparent[static_cast<size_t>(x)])
+                    {
+                        continue;
+                    }
+
+                    const uint8_t color_idx =
+                        GetColorIndex(static_cast<uint16_t>(kVramStart + (tile_idx * 16)), row,
+                                      sprite.flags.XFlip() ? 7 - px : px);
+                    if (color_idx == 0) { continue; }
+                    line[static_cast<size_t>(x)] = GetColor(
+                        Read(sprite.flags.DmgPalette() ? kRegObp1 : kRegObp0), color_idx);
+                }
+            }
+        }
+        return line;
+    }
+
+private:
+    uint8_t Read(uint16_t addr) const { return ppu_.ReadByte(addr); }
+
+    // Colour index of pixel x, from the left, of the row of the tile at the address. Rows of tall
+    // sprites continue into the next tile.
+    uint8_t GetColorIndex(uint16_t tile_addr, int row, int x) const
+    {
+        const auto row_addr = static_cast<uint16_t>(tile_addr + (row * 2));
+        const int bit = 7 - x;
+        return static_cast<uint8_t>((((Read(row_addr + 1) >> bit) & 1) << 1) |
+                                    ((Read(row_addr) >> bit) & 1));
+    }
+
+    static Color GetColor(uint8_t palette, uint8_t color_idx)
+    {
+        return kShades[(palette >> (color_idx * 2)) & 3];
+    }
+
+    // The first 10 sprites in OAM order on the line, in the order they're drawn: decreasing X,
+    // then decreasing OAM index, so the one with the lowest X and then index ends up on top.
+    std::vector<std::pair<size_t, video::Sprite>> ScanOam(uint8_t ly, int height) const
+    {
+        std::vector<std::pair<size_t, video::Sprite>> sprites;
+        for (size_t idx = 0; idx < 40 && sprites.size() < 10; ++idx)
+        {
+            const auto addr = static_cast<uint16_t>(kOamStart + (idx * 4));
+            const video::Sprite sprite{.y = Read(addr),
+                                       .x = Read(addr + 1),
+                                       .tile_index = Read(addr + 2),
+                                       .flags = video::SpriteFlags{Read(addr + 3)}};
+            if (sprite.x > 0 && ly + 16 >= sprite.y && ly + 16 < sprite.y + height)
+            {
+                sprites.emplace_back(idx, sprite);
+            }
+        }
+        std::ranges::sort(sprites, std::ranges::greater{},
+                          [](const auto& entry) { return std::pair{entry.second.x, entry.first}; });
+        return sprites;
+    }
+
+    const video::Ppu& ppu_;
+    int last_ly_{-1};
+    uint8_t window_line_{};
+};
+}  // namespace
+
+class PpuTest : public ::testing::Test
+{
+protected:
+    // The LCD is turned off while VRAM and OAM are set up, turning it on again starts a frame.
+    void SetUp() override { ppu.WriteByte(kRegLcdc, 0); }
+
+    void FillVram(std::mt19937& rng)
+    {
+        for (uint16_t addr = kVramStart; addr <= kVramEnd; ++addr)
+        {
+            ppu.WriteByte(addr, static_cast<uint8_t>(rng()));
+        }
+    }
+    // Leaves some sprites off-screen, and some at X=0.
+    void FillOam(std::mt19937& rng)
+    {
+        for (uint16_t addr = kOamStart; addr <= kOamEnd; ++addr)
+        {
+            ppu.WriteByte(addr, static_cast<uint8_t>(rng() % 176));
+        }
+    }
+
+    // Writes the bit planes of a row of a tile at 0x8000.
+    void WriteTileRow(size_t tile, size_t row, uint8_t lo, uint8_t hi)
+    {
+        const auto addr = static_cast<uint16_t>(kTileDataStart + (tile * 16) + (row * 2));
+        ppu.WriteByte(addr, lo);
+        ppu.WriteByte(addr + 1, hi);
+    }
+
+    // Runs the PPU until it rendered a line, and returns the line.
+    uint8_t RunToNextLine()
+    {
+        do
+        {
+            ppu.Tick(ppu.CyclesUntilModeChange());
+        } while (video::LcdStatus{ppu.ReadByte(kRegStat)}.GetMode() != video::Mode::HBlank);
+        return ppu.ReadByte(kRegLy);
+    }
+
+    std::span<const Color, kLcdWidth> GetLine(uint8_t ly) const
+    {
+        return std::span{ppu.GetLcdBuffer()}.subspan(ly * size_t{kLcdWidth}).first<kLcdWidth>();
+    }
+
+    // Compares the line the PPU just rendered to the reference.
+    ::testing::AssertionResult MatchesReference(uint8_t ly)
+    {
+        const Line expected = reference.RenderLine(ly);
+        const auto line = GetLine(ly);
+        const auto [actual_px, expected_px] = std::ranges::mismatch(line, expected);
+        if (actual_px == line.end()) { return ::testing::AssertionSuccess(); }
+        return ::testing::AssertionFailure()
+               << "line " << int{ly} << " differs from the reference at x "
+               << (actual_px - line.begin());
+    }
+
+    // Renders frames, comparing every line to the reference. Lets the callback write to the PPU
+    // after every line, while it's in HBlank.
+    template <typename F>
+    void CompareFrames(size_t frames, F&& write_between_lines)
+    {
+        // The first frame after the LCD is turned on starts at line 1.
+        for (size_t lines = 0; lines < (frames * kLcdHeight) - 1; ++lines)
+        {
+            const uint8_t ly = RunToNextLine();
+            ASSERT_TRUE(MatchesReference(ly)) << "frame " << (lines + 1) / kLcdHeight;
+            write_between_lines(ly);
+        }
+    }
+
+    // Writes what games write between lines: tile data and maps, LCDC switching tile data areas,
+    // maps, sprite sizes and layers on and off, scrolling, moving the window, OAM and palettes.
+    void WriteRandomly(std::mt19937& rng)
+    {
+        const auto chance = [&](uint32_t n) { return rng() % n == 0; };
+        const auto random_byte = [&](uint32_t end = 0x100)
+        { return static_cast<uint8_t>(rng() % end); };
+
+        for (auto i = rng() % 4; i > 0; --i)
+        {
+            ppu.WriteByte(static_cast<uint16_t>(kTileDataStart + (rng() % 0x1800)), random_byte());
+        }
+        for (auto i = rng() % 3; i > 0; --i)
+        {
+            ppu.WriteByte(static_cast<uint16_t>(kTileMapStart + (rng() % 0x800)), random_byte());
+        }
+        if (chance(16)) { ppu.WriteByte(kRegLcdc, random_byte() | 0x80); }
+        if (chance(16)) { ppu.WriteByte(kRegScx, random_byte()); }
+        if (chance(16)) { ppu.WriteByte(kRegScy, random_byte()); }
+        if (chance(32)) { ppu.WriteByte(kRegWx, chance(4) ? random_byte(7) : random_byte(176)); }
+        if (chance(32)) { ppu.WriteByte(kRegWy, random_byte(160)); }
+        if (chance(32))
+        {
+            ppu.WriteByte(static_cast<uint16_t>(kOamStart + (rng() % 160)), random_byte(176));
+        }
+        if (chance(64)) { ppu.WriteByte(kRegBgp, random_byte()); }
+        if (chance(64)) { ppu.WriteByte(kRegObp0, random_byte()); }
+    }
+
+    video::Ppu ppu;
+    ReferenceRenderer reference{ppu};
+};
+
+TEST_F(PpuTest, ScrollWrapsAround)
+{
+    std::mt19937 rng{1};
+    FillVram(rng);
+    ppu.WriteByte(kRegBgp, kIdentityPalette);
+    ppu.WriteByte(kRegScx, 0xfb);
+    ppu.WriteByte(kRegScy, 0xc3);
+    ppu.WriteByte(kRegLcdc, 0x91);
+
+    // Scrolls right every line, and wraps down past the bottom of the map on line 61, and again
+    // after SCY is changed on line 100.
+    CompareFrames(2,
+                  [&](uint8_t ly)
+                  {
+                      ppu.WriteByte(kRegScx, static_cast<uint8_t>(0xfb + (ly * 3)));
+                      if (ly == 100) { ppu.WriteByte(kRegScy, 0xf0); }
+                  });
+}
+
+TEST_F(PpuTest, WindowLeftOfScreen)
+{
+    std::mt19937 rng{2};
+    FillVram(rng);
+    ppu.WriteByte(kRegBgp, kIdentityPalette);
+    ppu.WriteByte(kRegScx, 0x13);
+    ppu.WriteByte(kRegWy, 20);
+    ppu.WriteByte(kRegLcdc, 0xf1);
+
+    // Every WX left of 7 shifts the window left by 7 - WX pixels.
+    CompareFrames(2, [&](uint8_t ly) { ppu.WriteByte(kRegWx, static_cast<uint8_t>(ly % 7)); });
+}
+
+TEST_F(PpuTest, WindowDisabledMidFrame)
+{
+    std::mt19937 rng{3};
+    FillVram(rng);
+    ppu.WriteByte(kRegBgp, kIdentityPalette);
+    ppu.WriteByte(kRegWx, 30);
+    ppu.WriteByte(kRegWy, 10);
+    ppu.WriteByte(kRegLcdc, 0xb1);
+
+    // The window's line counter stops while it's off.
+    CompareFrames(2,
+                  [&](uint8_t ly)
+                  {
+                      const bool window = ly < 40 || ly >= 80;
+                      ppu.WriteByte(kRegLcdc, window ? 0xb1 : 0x91);
+                  });
+}
+
+TEST_F(PpuTest, MatchesReferenceWithWritesBetweenLines)
+{
+    for (uint32_t seed = 0; seed < 16; ++seed)
+    {
+        SCOPED_TRACE(::testing::Message() << "seed " << seed);
+
+        std::mt19937 rng{seed};
+        ppu.WriteByte(kRegLcdc, 0);
+        FillVram(rng);
+        FillOam(rng);
+        ppu.WriteByte(kRegBgp, static_cast<uint8_t>(rng()));
+        ppu.WriteByte(kRegObp0, static_cast<uint8_t>(rng()));
+        ppu.WriteByte(kRegObp1, static_cast<uint8_t>(rng()));
+        ppu.WriteByte(kRegWx, static_cast<uint8_t>(rng() % 176));
+        ppu.WriteByte(kRegWy, static_cast<uint8_t>(rng() % 160));
+        ppu.WriteByte(kRegLcdc, static_cast<uint8_t>(rng() | 0x80));
+
+        CompareFrames(4, [&](uint8_t) { WriteRandomly(rng); });
+        if (HasFatalFailure()) { return; }
+    }
+}
+
+TEST_F(PpuTest, TileWrittenAfterDrawnIsRedrawn)
+{
+    // Tile 0 fills the background, tile 1 is a sprite at X 40-47 on lines 0-7, X-flipped.
+    for (size_t row = 0; row < 8; ++row)
+    {
+        WriteTileRow(0, row, 0xf0, 0x00);
+        WriteTileRow(1, row, 0xc0, 0xc0);
+    }
+    ppu.WriteByte(kOamStart, 16);
+    ppu.WriteByte(kOamStart + 1, 8 + 40);
+    ppu.WriteByte(kOamStart + 2, 1);
+    ppu.WriteByte(kOamStart + 3, 0x20);
+    ppu.WriteByte(kRegBgp, kIdentityPalette);
+    ppu.WriteByte(kRegObp0, kIdentityPalette);
+    ppu.WriteByte(kRegLcdc, 0x93);
+
+    ASSERT_EQ(RunToNextLine(), 1);
+    ASSERT_TRUE(MatchesReference(1));
+    auto line = GetLine(1);
+    EXPECT_EQ(line[0], kLightGray);
+    EXPECT_EQ(line[4], kWhite);
+    EXPECT_EQ(line[40], kLightGray);
+    EXPECT_EQ(line[46], kBlack);
+    EXPECT_EQ(line[47], kBlack);
+
+    // The whole tile was drawn with the line before, its next row is written.
+    WriteTileRow(0, 2, 0x0f, 0x00);
+    WriteTileRow(1, 2, 0x03, 0x03);
+
+    ASSERT_EQ(RunToNextLine(), 2);
+    ASSERT_TRUE(MatchesReference(2));
+    line = GetLine(2);
+    EXPECT_EQ(line[0], kWhite);
+    EXPECT_EQ(line[4], kLightGray);
+    EXPECT_EQ(line[40], kBlack);
+    EXPECT_EQ(line[41], kBlack);
+    EXPECT_EQ(line[46], kLightGray);
+    EXPECT_EQ(line[47], kLightGray);
+
+    // Rows that weren't written are drawn as before.
+    ASSERT_EQ(RunToNextLine(), 3);
+    ASSERT_TRUE(MatchesReference(3));
+    EXPECT_EQ(GetLine(3)[0], kLightGray);
+    EXPECT_EQ(GetLine(3)[46], kBlack);
+}
+
+namespace
+{
+// Whether each sprite is on the line, as the PPU used to scan OAM for every line on screen.
+uint64_t ScanSpriteRows(const video::detail::SpriteYs& ys, uint8_t y, uint8_t height)
+{
+    uint64_t mask = 0;
+    for (size_t i = 0; i < ys.size(); ++i)
+    {
+        if (y >= ys[i] && y < ys[i] + height) { mask |= uint64_t{1} << i; }
+    }
+    return mask;
+}
+
+// OAM coordinates of the first and last line on screen.
+constexpr uint8_t kFirstLine = 16;
+constexpr uint8_t kLastLine = kFirstLine + kLcdHeight - 1;
+}  // namespace
+
+TEST(MatchSpriteRowsTest, MatchesScanOfOam)
+{
+    std::vector<video::detail::SpriteYs> oams;
+    // Above, at and below the edges of the screen and of the Y range.
+    video::detail::SpriteYs edges{};
+    constexpr auto kEdgeYs = std::to_array<uint8_t>({0,   1,   2,   7,   8,   9,   15,  16,  17,
+                                                     150, 152, 153, 159, 160, 161, 167, 168, 169,
+                                                     175, 176, 239, 240, 241, 247, 248, 249, 254,
+                                                     255, 128, 127});
+    std::ranges::copy(kEdgeYs, edges.begin());
+    oams.push_back(edges);
+    std::mt19937 rng{0};
+    for (size_t i = 0; i < 16; ++i)
+    {
+        video::detail::SpriteYs ys{};
+        std::ranges::generate(std::span{ys}.first(40), [&] { return static_cast<uint8_t>(rng()); });
+        oams.push_back(ys);
+    }
+
+    for (const auto& ys : oams)
+    {
+        for (const uint8_t height : std::to_array<uint8_t>({8, 16}))
+        {
+            for (uint32_t y = 0; y < 0x100; ++y)
+            {
+                SCOPED_TRACE(::testing::Message() << "height " << int{height} << " line " << y);
+                const auto line = static_cast<uint8_t>(y);
+                const uint64_t scalar = video::detail::MatchSpriteRowsScalar(ys, line, height);
+#if defined(__SSE2__)
+                EXPECT_EQ(video::detail::MatchSpriteRowsSse2(ys, line, height), scalar);
+#endif
+                if (line >= kFirstLine && line <= kLastLine)
+                {
+                    EXPECT_EQ(scalar, ScanSpriteRows(ys, line, height));
+                }
+            }
+        }
+    }
+}
+
+TEST_F(PpuTest, TenSpritesPerLineSkippingHiddenOnes)
+{
+    // Tile 1 is solid, the background is blank.
+    for (size_t row = 0; row < 8; ++row) { WriteTileRow(1, row, 0xff, 0xff); }
+    // 2 sprites at X=0, which don't take a slot, then 12 side by side.
+    for (uint16_t idx = 0; idx < 14; ++idx)
+    {
+        const auto addr = static_cast<uint16_t>(kOamStart + (idx * 4));
+        ppu.WriteByte(addr, 16);
+        ppu.WriteByte(addr + 1, static_cast<uint8_t>(idx < 2 ? 0 : 8 + ((idx - 2) * 12)));
+        ppu.WriteByte(addr + 2, 1);
+    }
+    ppu.WriteByte(kRegBgp, kIdentityPalette);
+    ppu.WriteByte(kRegObp0, kIdentityPalette);
+    ppu.WriteByte(kRegLcdc, 0x93);
+
+    ASSERT_EQ(RunToNextLine(), 1);
+    ASSERT_TRUE(MatchesReference(1));
+    const auto line = GetLine(1);
+    for (size_t sprite = 0; sprite < 12; ++sprite)
+    {
+        EXPECT_EQ(line[sprite * 12], sprite < 10 ? kBlack : kWhite) << "sprite " << sprite;
+    }
+}
+
+TEST_F(PpuTest, SpritesDrawnByXThenOamIndex)
+{
+    for (size_t row = 0; row < 8; ++row) { WriteTileRow(1, row, 0xff, 0xff); }
+    // Sprite 0 at X 12-19 with OBP1, sprite 1 at X 8-15 and sprite 2 at X 12-19, with OBP0.
+    const auto write_sprite = [&](uint16_t idx, uint8_t x, uint8_t flags)
+    {
+        const auto addr = static_cast<uint16_t>(kOamStart + (idx * 4));
+        ppu.WriteByte(addr, 16);
+        ppu.WriteByte(addr + 1, x);
+        ppu.WriteByte(addr + 2, 1);
+        ppu.WriteByte(addr + 3, flags);
+    };
+    write_sprite(0, 20, 0x10);
+    write_sprite(1, 16, 0x00);
+    write_sprite(2, 20, 0x00);
+    ppu.WriteByte(kRegBgp, kIdentityPalette);
+    ppu.WriteByte(kRegObp0, kIdentityPalette);
+    ppu.WriteByte(kRegObp1, 0b01'00'00'00);
+    ppu.WriteByte(kRegLcdc, 0x93);
+
+    ASSERT_EQ(RunToNextLine(), 1);
+    ASSERT_TRUE(MatchesReference(1));
+    const auto line = GetLine(1);
+    // The lowest X is on top, then the lowest OAM index.
+    EXPECT_EQ(line[8], kBlack);
+    EXPECT_EQ(line[15], kBlack);
+    EXPECT_EQ(line[16], kLightGray);
+    EXPECT_EQ(line[19], kLightGray);
+}
+
+TEST_F(PpuTest, SpritesAtEdgesOfYRange)
+{
+    std::mt19937 rng{4};
+    FillVram(rng);
+    // Every Y near the top and bottom of the screen, and near 0 and 255.
+    constexpr auto kYs = std::to_array<uint8_t>({0,   1,   2,   7,   8,   9,   15,  16,  17,  150,
+                                                 152, 153, 159, 160, 161, 167, 168, 169, 175, 176,
+                                                 239, 240, 241, 247, 248, 249, 254, 255});
+    for (size_t idx = 0; idx < kYs.size(); ++idx)
+    {
+        const auto addr = static_cast<uint16_t>(kOamStart + (idx * 4));
+        ppu.WriteByte(addr, kYs[idx]);
+        ppu.WriteByte(addr + 1, static_cast<uint8_t>(8 + (idx * 5)));
+        ppu.WriteByte(addr + 2, static_cast<uint8_t>(rng()));
+        ppu.WriteByte(addr + 3, static_cast<uint8_t>(rng() & 0x70));
+    }
+    ppu.WriteByte(kRegBgp, kIdentityPalette);
+    ppu.WriteByte(kRegObp0, kIdentityPalette);
+    ppu.WriteByte(kRegObp1, kIdentityPalette);
+    ppu.WriteByte(kRegLcdc, 0x93);
+
+    // 8x8 for the first frame, 8x16 for the second.
+    CompareFrames(2,
+                  [&](uint8_t ly)
+                  {
+                      if (ly == kLcdHeight - 1) { ppu.WriteByte(kRegLcdc, 0x97); }
+                  });
+}
+
+// LCDC.2 changes which lines every sprite is on without OAM being written.
+TEST_F(PpuTest, SpriteSizeToggledWithoutOamWrites)
+{
+    for (uint32_t seed = 0; seed < 8; ++seed)
+    {
+        SCOPED_TRACE(::testing::Message() << "seed " << seed);
+
+        std::mt19937 rng{seed};
+        ppu.WriteByte(kRegLcdc, 0);
+        FillVram(rng);
+        // Crowded onto the first lines, so that lines are full of sprites.
+        for (size_t idx = 0; idx < 40; ++idx)
+        {
+            const auto addr = static_cast<uint16_t>(kOamStart + (idx * 4));
+            ppu.WriteByte(addr, static_cast<uint8_t>(8 + (rng() % 40)));
+            ppu.WriteByte(addr + 1, static_cast<uint8_t>(rng() % 169));
+            ppu.WriteByte(addr + 2, static_cast<uint8_t>(rng()));
+            ppu.WriteByte(addr + 3, static_cast<uint8_t>(rng()));
+        }
+        ppu.WriteByte(kRegBgp, static_cast<uint8_t>(rng()));
+        ppu.WriteByte(kRegObp0, static_cast<uint8_t>(rng()));
+        ppu.WriteByte(kRegObp1, static_cast<uint8_t>(rng()));
+        ppu.WriteByte(kRegLcdc, 0x93);
+
+        CompareFrames(2,
+                      [&](uint8_t)
+                      {
+                          if (rng() % 4 == 0)
+                          {
+                              ppu.WriteByte(kRegLcdc, ppu.ReadByte(kRegLcdc) ^ 0x04);
+                          }
+                      });
+        if (HasFatalFailure()) { return; }
+    }
+}
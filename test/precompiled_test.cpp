@@ -0,0 +1,48 @@
+#include <gtest/gtest.h>
+
+#include <ranges>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "core/util.hpp"
+#include "cpu_comparison.hpp"
+
+using namespace gb;
+
+namespace
+{
+constexpr uint32_t kCyclesPerFrame = 70224;
+constexpr size_t kFrames = 3000;
+
+// GBCXX_PRECOMPILED_ROMS, separated by commas.
+std::vector<std::string> GetPrecompiledRoms()
+{
+    std::vector<std::string> roms;
+    for (const auto rom : std::views::split(std::string_view{PRECOMPILED_ROMS}, ','))
+    {
+        roms.emplace_back(std::string_view{rom});
+    }
+    return roms;
+}
+}  // namespace
+
+// The ROMs recompiled by gbcxx_recompile into the tests, run with their precompiled code and
+// compared against the interpreter frame by frame.
+class PrecompiledTest : public test::CpuComparisonTest,
+                        public ::testing::WithParamInterface<std::string>
+{
+protected:
+    PrecompiledTest() : CpuComparisonTest(fs::ReadFile(GetParam())) {}
+};
+
+TEST_P(PrecompiledTest, MatchesInterpreter)
+{
+    for (size_t frame = 0; frame < kFrames; ++frame)
+    {
+        ASSERT_NO_FATAL_FAILURE(RunSlice(kCyclesPerFrame)) << "frame " << frame;
+    }
+    EXPECT_GT(Fast().GetPrecompiledCycles(), 0U);
+}
+
+INSTANTIATE_TEST_SUITE_P(Roms, PrecompiledTest, ::testing::ValuesIn(GetPrecompiledRoms()));
@@ -0,0 +1,150 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <initializer_list>
+#include <string>
+#include <vector>
+
+#include "core/util.hpp"
+#include "recompile/recompiler.hpp"
+
+using namespace gb;
+using recompile::Location;
+
+namespace
+{
+// 64KiB with an MBC1, i.e. banks 1-3 can be mapped at 0x4000. Every byte is a RET, so the restart
+// and interrupt vectors end right away, and the entry point jumps to 0x0150.
+std::vector<uint8_t> MakeRom()
+{
+    std::vector<uint8_t> rom(64_KiB, 0xc9);
+    // Cartridge type: MBC1, ROM size: 64KiB
+    rom[0x147] = 0x01;
+    rom[0x148] = 0x01;
+    rom[0x100] = 0x00;  // NOP
+    rom[0x101] = 0xc3;  // JP 0x0150
+    rom[0x102] = 0x50;
+    rom[0x103] = 0x01;
+    return rom;
+}
+
+void Put(std::vector<uint8_t>& rom, size_t offset, std::initializer_list<uint8_t> bytes)
+{
+    for (const uint8_t byte : bytes) { rom[offset++] = byte; }
+}
+
+recompile::Recompiler Walk(std::vector<uint8_t> rom)
+{
+    recompile::Recompiler recompiler{std::move(rom)};
+    recompiler.Walk();
+    return recompiler;
+}
+}  // namespace
+
+TEST(RecompilerTest, FollowsConstantBankSwitches)
+{
+    std::vector<uint8_t> rom = MakeRom();
+    Put(rom, 0x0150,
+        {
+            0x3e, 0x02,        // LD A,2
+            0xea, 0x00, 0x20,  // LD (0x2000),A
+            0xcd, 0x00, 0x40,  // CALL 0x4000
+            // A survives on its way to the MBC.
+            0x3e, 0x03,        // LD A,3
+            0xe0, 0x80,        // LDH (0x80),A
+            0xea, 0x00, 0x21,  // LD (0x2100),A
+            0xcd, 0x00, 0x40,  // CALL 0x4000
+            // Unknown bank, the last one known is kept.
+            0x7e,              // LD A,(HL)
+            0xea, 0x00, 0x20,  // LD (0x2000),A
+            0xcd, 0x10, 0x40,  // CALL 0x4010
+        });
+    const recompile::Recompiler recompiler = Walk(std::move(rom));
+
+    EXPECT_NE(recompiler.FindBlock({.bank = 2, .pc = 0x4000}), nullptr);
+    EXPECT_NE(recompiler.FindBlock({.bank = 3, .pc = 0x4000}), nullptr);
+    EXPECT_NE(recompiler.FindBlock({.bank = 3, .pc = 0x4010}), nullptr);
+    EXPECT_EQ(recompiler.FindBlock({.bank = 1, .pc = 0x4000}), nullptr);
+    EXPECT_EQ(recompiler.FindBlock({.bank = 1, .pc = 0x4010}), nullptr);
+}
+
+TEST(RecompilerTest, LeavesJpHlAndRetToTheInterpreter)
+{
+    std::vector<uint8_t> rom = MakeRom();
+    Put(rom, 0x0150,
+        {
+            0xcd, 0x60, 0x01,  // CALL 0x0160
+            0x21, 0x00, 0x02,  // LD HL,0x0200
+            0xe9,              // JP HL
+        });
+    Put(rom, 0x0160,
+        {
+            0xc9,  // RET
+            0x00,  // NOP
+        });
+    const recompile::Recompiler recompiler = Walk(std::move(rom));
+
+    // Returns land after the CALL, which is reached as its fallthrough.
+    const auto* block = recompiler.FindBlock({.bank = 0, .pc = 0x0153});
+    ASSERT_NE(block, nullptr);
+    EXPECT_EQ(block->back().opcode, 0xe9);
+    ASSERT_NE(recompiler.FindBlock({.bank = 0, .pc = 0x0160}), nullptr);
+    EXPECT_EQ(recompiler.FindBlock({.bank = 0, .pc = 0x0161}), nullptr);
+    EXPECT_EQ(recompiler.FindBlock({.bank = 0, .pc = 0x0200}), nullptr);
+}
+
+TEST(RecompilerTest, SplitsBlocksAt0x4000)
+{
+    std::vector<uint8_t> rom = MakeRom();
+    Put(rom, 0x0150,
+        {
+            0xc3, 0xfc, 0x3f,  // JP 0x3ffc
+        });
+    Put(rom, 0x3ffc,
+        {
+            0x00,  // NOP
+            0x00,  // NOP
+            0x00,  // NOP
+            0x00,  // NOP
+        });
+    // Entry point of bank 1, as mapped on startup.
+    Put(rom, 0x4000,
+        {
+            0x00,  // NOP
+            0xc9,  // RET
+        });
+    const recompile::Recompiler recompiler = Walk(std::move(rom));
+
+    const auto* bank0 = recompiler.FindBlock({.bank = 0, .pc = 0x3ffc});
+    ASSERT_NE(bank0, nullptr);
+    EXPECT_EQ(bank0->size(), 4U);
+    EXPECT_EQ(bank0->back().pc, 0x3fff);
+
+    const auto* bank1 = recompiler.FindBlock({.bank = 1, .pc = 0x4000});
+    ASSERT_NE(bank1, nullptr);
+    EXPECT_EQ(bank1->size(), 2U);
+}
+
+TEST(RecompilerTest, LeavesInstructionsAcross0x4000ToTheInterpreter)
+{
+    std::vector<uint8_t> rom = MakeRom();
+    Put(rom, 0x0150,
+        {
+            0xc3, 0xfd, 0x3f,  // JP 0x3ffd
+        });
+    Put(rom, 0x3ffd,
+        {
+            0x00,              // NOP
+            0x01, 0x34, 0x12,  // LD BC,0x1234 (0x3ffe-0x4000)
+        });
+    const recompile::Recompiler recompiler = Walk(std::move(rom));
+
+    const auto* block = recompiler.FindBlock({.bank = 0, .pc = 0x3ffd});
+    ASSERT_NE(block, nullptr);
+    EXPECT_EQ(block->size(), 1U);
+    // Decoded empty, so never emitted.
+    const auto* across = recompiler.FindBlock({.bank = 0, .pc = 0x3ffe});
+    ASSERT_NE(across, nullptr);
+    EXPECT_TRUE(across->empty());
+    EXPECT_EQ(recompiler.Emit().find("Block_00_3ffe"), std::string::npos);
+}
@@ -0,0 +1,177 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "core/scheduler.hpp"
+
+using namespace gb;
+
+class SchedulerTest : public ::testing::Test
+{
+protected:
+    // Every event starts out due, these tests schedule their own.
+    void SetUp() override
+    {
+        while (scheduler.PopDueEvent()) {}
+    }
+
+    void AdvanceTo(uint64_t timestamp)
+    {
+        ASSERT_GE(timestamp, scheduler.GetTimestamp());
+        scheduler.Advance(static_cast<uint32_t>(timestamp - scheduler.GetTimestamp()));
+    }
+
+    std::vector<EventType> PopDueEvents()
+    {
+        std::vector<EventType> events;
+        while (const auto type = scheduler.PopDueEvent()) { events.push_back(*type); }
+        return events;
+    }
+
+    Scheduler scheduler;
+};
+
+TEST_F(SchedulerTest, InitialEventsAreDue)
+{
+    Scheduler fresh;
+    EXPECT_TRUE(fresh.HasDueEvent());
+
+    std::vector<EventType> events;
+    while (const auto type = fresh.PopDueEvent()) { events.push_back(*type); }
+    std::ranges::sort(events);
+    EXPECT_EQ(events,
+              (std::vector<EventType>{EventType::Timer, EventType::Ppu, EventType::OamDma}));
+    EXPECT_EQ(fresh.GetNextDeadline(), Scheduler::kNever);
+}
+
+TEST_F(SchedulerTest, PopsOnlyOnceDue)
+{
+    scheduler.Schedule(EventType::Timer, 100);
+    EXPECT_EQ(scheduler.GetNextDeadline(), 100);
+
+    AdvanceTo(99);
+    EXPECT_FALSE(scheduler.HasDueEvent());
+    EXPECT_EQ(scheduler.PopDueEvent(), std::nullopt);
+
+    AdvanceTo(100);
+    EXPECT_EQ(PopDueEvents(), std::vector{EventType::Timer});
+    EXPECT_EQ(scheduler.GetNextDeadline(), Scheduler::kNever);
+}
+
+TEST_F(SchedulerTest, RescheduleEarlier)
+{
+    scheduler.Schedule(EventType::Timer, 100);
+    scheduler.Schedule(EventType::Timer, 50);
+    EXPECT_EQ(scheduler.GetNextDeadline(), 50);
+
+    AdvanceTo(50);
+    EXPECT_EQ(PopDueEvents(), std::vector{EventType::Timer});
+
+    // The entry at 100 is stale.
+    EXPECT_EQ(scheduler.GetNextDeadline(), Scheduler::kNever);
+    AdvanceTo(100);
+    EXPECT_EQ(PopDueEvents(), std::vector<EventType>{});
+}
+
+TEST_F(SchedulerTest, RescheduleLater)
+{
+    scheduler.Schedule(EventType::Timer, 50);
+    scheduler.Schedule(EventType::Timer, 100);
+    EXPECT_EQ(scheduler.GetNextDeadline(), 100);
+
+    AdvanceTo(50);
+    EXPECT_FALSE(scheduler.HasDueEvent());
+    EXPECT_EQ(PopDueEvents(), std::vector<EventType>{});
+
+    AdvanceTo(100);
+    EXPECT_EQ(PopDueEvents(), std::vector{EventType::Timer});
+}
+
+TEST_F(SchedulerTest, RescheduleBehindOtherEvent)
+{
+    scheduler.Schedule(EventType::Timer, 50);
+    scheduler.Schedule(EventType::Ppu, 70);
+    scheduler.Schedule(EventType::Timer, 100);
+    EXPECT_EQ(scheduler.GetNextDeadline(), 70);
+
+    AdvanceTo(100);
+    EXPECT_EQ(PopDueEvents(), (std::vector{EventType::Ppu, EventType::Timer}));
+}
+
+TEST_F(SchedulerTest, CancelWithNever)
+{
+    scheduler.Schedule(EventType::Timer, 50);
+    scheduler.Schedule(EventType::Ppu, 70);
+    scheduler.Schedule(EventType::Timer, Scheduler::kNever);
+    EXPECT_EQ(scheduler.GetNextDeadline(), 70);
+
+    AdvanceTo(100);
+    EXPECT_EQ(PopDueEvents(), std::vector{EventType::Ppu});
+
+    scheduler.Schedule(EventType::Ppu, 200);
+    scheduler.Schedule(EventType::Ppu, Scheduler::kNever);
+    EXPECT_EQ(scheduler.GetNextDeadline(), Scheduler::kNever);
+    AdvanceTo(1000);
+    EXPECT_FALSE(scheduler.HasDueEvent());
+}
+
+TEST_F(SchedulerTest, RescheduleSameDeadlineAfterPop)
+{
+    scheduler.Schedule(EventType::Timer, 50);
+    AdvanceTo(50);
+    EXPECT_EQ(PopDueEvents(), std::vector{EventType::Timer});
+
+    // Already passed, due straight away, and only once.
+    scheduler.Schedule(EventType::Timer, 50);
+    EXPECT_TRUE(scheduler.HasDueEvent());
+    EXPECT_EQ(PopDueEvents(), std::vector{EventType::Timer});
+}
+
+TEST_F(SchedulerTest, DuplicateDeadlinesPopOnce)
+{
+    // Leaves two entries at 50 for the timer and a stale one at 80, which stays in the heap behind
+    // the PPU.
+    scheduler.Schedule(EventType::Timer, 50);
+    scheduler.Schedule(EventType::Timer, 80);
+    scheduler.Schedule(EventType::Timer, 50);
+    scheduler.Schedule(EventType::Ppu, 60);
+
+    AdvanceTo(50);
+    EXPECT_EQ(PopDueEvents(), std::vector{EventType::Timer});
+    EXPECT_EQ(scheduler.GetNextDeadline(), 60);
+
+    // The stale entry at 80 matches again, next to the new one, and the timer must pop once.
+    scheduler.Schedule(EventType::Timer, 80);
+    AdvanceTo(80);
+    EXPECT_EQ(PopDueEvents(), (std::vector{EventType::Ppu, EventType::Timer}));
+    EXPECT_EQ(scheduler.GetNextDeadline(), Scheduler::kNever);
+    AdvanceTo(200);
+    EXPECT_EQ(PopDueEvents(), std::vector<EventType>{});
+}
+
+TEST_F(SchedulerTest, SeveralEventsDueAtOnce)
+{
+    scheduler.Schedule(EventType::Ppu, 100);
+    scheduler.Schedule(EventType::OamDma, 100);
+    scheduler.Schedule(EventType::Timer, 100);
+
+    AdvanceTo(100);
+    std::vector<EventType> events = PopDueEvents();
+    std::ranges::sort(events);
+    EXPECT_EQ(events, (std::vector{EventType::Timer, EventType::Ppu, EventType::OamDma}));
+    EXPECT_EQ(scheduler.GetNextDeadline(), Scheduler::kNever);
+}
+
+TEST_F(SchedulerTest, PopsInDeadlineOrder)
+{
+    scheduler.Schedule(EventType::OamDma, 30);
+    scheduler.Schedule(EventType::Timer, 10);
+    scheduler.Schedule(EventType::Ppu, 20);
+
+    AdvanceTo(25);
+    EXPECT_EQ(PopDueEvents(), (std::vector{EventType::Timer, EventType::Ppu}));
+    EXPECT_EQ(scheduler.GetNextDeadline(), 30);
+    AdvanceTo(30);
+    EXPECT_EQ(PopDueEvents(), std::vector{EventType::OamDma});
+}
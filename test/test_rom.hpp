@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "core/util.hpp"
+
+namespace gb::test
+{
+// 32KiB without an MBC. Every byte but the cartridge type reads fill.
+inline std::vector<uint8_t> MakeRom(uint8_t fill)
+{
+    std::vector<uint8_t> rom(32_KiB, fill);
+    // Cartridge type: ROM only
+    rom[0x147] = 0x00;
+    return rom;
+}
+}  // namespace gb::test
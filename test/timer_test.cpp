@@ -0,0 +1,167 @@
+#include <gtest/gtest.h>
+
+#include "core/constants.hpp"
+#include "core/sm83/interrupts.hpp"
+#include "core/sm83/timer.hpp"
+
+using namespace gb;
+
+namespace
+{
+constexpr uint8_t kTacEnabled = 0b100;
+// Input clock of 16 cycles, TIMA increments when counter bit 3 falls.
+constexpr uint8_t kTac16 = kTacEnabled | 0b01;
+constexpr uint8_t kTac1024 = kTacEnabled | 0b00;
+}  // namespace
+
+class TimerTest : public ::testing::Test
+{
+protected:
+    // Clears the counter at kStart, so that it reads t at kStart + t.
+    void ResetCounter() { timer.WriteByte(kRegDiv, 0, kStart); }
+
+    uint8_t Read(uint16_t addr, uint64_t t) const { return timer.ReadByte(addr, kStart + t); }
+    void Write(uint16_t addr, uint8_t val, uint64_t t) { timer.WriteByte(addr, val, kStart + t); }
+
+    // Not a multiple of any input clock.
+    static constexpr uint64_t kStart = 0x12345;
+    sm83::Timer timer;
+};
+
+TEST_F(TimerTest, DivIsUpperByteOfCounter)
+{
+    // The counter starts at 0xab00.
+    EXPECT_EQ(timer.ReadByte(kRegDiv, 0), 0xab);
+    EXPECT_EQ(timer.ReadByte(kRegDiv, 0xff), 0xab);
+    EXPECT_EQ(timer.ReadByte(kRegDiv, 0x100), 0xac);
+    EXPECT_EQ(timer.ReadByte(kRegDiv, 0x5500), 0x00);
+}
+
+TEST_F(TimerTest, DivWriteResetsWholeCounter)
+{
+    ResetCounter();
+    EXPECT_EQ(Read(kRegDiv, 0), 0);
+    EXPECT_EQ(Read(kRegDiv, 0xff), 0);
+    EXPECT_EQ(Read(kRegDiv, 0x100), 1);
+
+    // The lower bits were cleared too, the first increment is a whole input clock away.
+    Write(kRegTac, kTac16, 0);
+    EXPECT_EQ(Read(kRegTima, 15), 0);
+    EXPECT_EQ(Read(kRegTima, 16), 1);
+    EXPECT_EQ(Read(kRegTima, 16 * 5), 5);
+}
+
+TEST_F(TimerTest, DivWriteIncrementsTimaOnFallingEdge)
+{
+    ResetCounter();
+    Write(kRegTac, kTac16, 0);
+
+    // Counter bit 3 is clear, nothing falls.
+    Write(kRegDiv, 0, 4);
+    EXPECT_EQ(Read(kRegTima, 4), 0);
+
+    // Counter bit 3 is set, clearing it increments TIMA.
+    Write(kRegDiv, 0, 4 + 8);
+    EXPECT_EQ(Read(kRegTima, 4 + 8), 1);
+    EXPECT_EQ(Read(kRegTima, 4 + 8 + 15), 1);
+    EXPECT_EQ(Read(kRegTima, 4 + 8 + 16), 2);
+}
+
+TEST_F(TimerTest, TacWriteIncrementsTimaOnFallingEdge)
+{
+    ResetCounter();
+    Write(kRegTac, kTac16, 0);
+
+    // Bit 3 is set and bit 9 isn't, switching from the first to the second is a falling edge.
+    Write(kRegTac, kTac1024, 8);
+    EXPECT_EQ(Read(kRegTima, 8), 1);
+
+    // Back to bit 3, which is still set, the signal rises.
+    Write(kRegTac, kTac16, 9);
+    EXPECT_EQ(Read(kRegTima, 9), 1);
+
+    // Disabling the timer while the signal is high is a falling edge too.
+    Write(kRegTac, kTac16 & 0b11, 10);
+    EXPECT_EQ(Read(kRegTima, 10), 2);
+    EXPECT_EQ(Read(kRegTima, 10 + 1024), 2);
+}
+
+TEST_F(TimerTest, TimaReadsAcrossUnsyncedOverflow)
+{
+    ResetCounter();
+    Write(kRegTma, 0x80, 0);
+    Write(kRegTima, 0xfe, 0);
+    Write(kRegTac, kTac16, 0);
+
+    EXPECT_EQ(Read(kRegTima, 16), 0xff);
+    EXPECT_EQ(Read(kRegTima, 32), 0x80);
+    EXPECT_EQ(Read(kRegTima, 48), 0x81);
+    EXPECT_EQ(timer.ConsumeInterrupts(), 0);
+
+    timer.Sync(kStart + 48);
+    EXPECT_EQ(timer.ConsumeInterrupts(), sm83::IntTimer);
+    EXPECT_EQ(Read(kRegTima, 48), 0x81);
+}
+
+TEST_F(TimerTest, TimaReadsAcrossSeveralUnsyncedOverflows)
+{
+    ResetCounter();
+    Write(kRegTma, 0xfe, 0);
+    Write(kRegTima, 0xff, 0);
+    Write(kRegTac, kTac16, 0);
+
+    EXPECT_EQ(Read(kRegTima, 16), 0xfe);
+    EXPECT_EQ(Read(kRegTima, 32), 0xff);
+    EXPECT_EQ(Read(kRegTima, 48), 0xfe);
+    EXPECT_EQ(Read(kRegTima, 16 * 101), 0xfe);
+    EXPECT_EQ(Read(kRegTima, 16 * 102), 0xff);
+}
+
+TEST_F(TimerTest, NextOverflow)
+{
+    EXPECT_EQ(timer.GetNextOverflow(), sm83::Timer::kNever);
+
+    ResetCounter();
+    Write(kRegTima, 0xfe, 0);
+    Write(kRegTac, kTac16, 0);
+    EXPECT_EQ(timer.GetNextOverflow(), kStart + 32);
+
+    timer.Sync(kStart + 31);
+    EXPECT_EQ(timer.ConsumeInterrupts(), 0);
+    EXPECT_EQ(timer.GetNextOverflow(), kStart + 32);
+
+    timer.Sync(kStart + 32);
+    EXPECT_EQ(timer.ConsumeInterrupts(), sm83::IntTimer);
+    // Reloaded from TMA, 0.
+    EXPECT_EQ(timer.GetNextOverflow(), kStart + 32 + (0x100 * 16));
+}
+
+TEST_F(TimerTest, NextOverflowBetweenEdges)
+{
+    ResetCounter();
+    Write(kRegTac, kTac1024, 0);
+    // Written in the middle of an input clock, the next increment is still at its end.
+    Write(kRegTima, 0xff, 1000);
+    EXPECT_EQ(timer.GetNextOverflow(), kStart + 1024);
+
+    Write(kRegTima, 0xfd, 1024 + 5);
+    EXPECT_EQ(timer.GetNextOverflow(), kStart + (1024 * 4));
+}
+
+TEST_F(TimerTest, NextOverflowFromInitialCounter)
+{
+    // 0xab00 is a multiple of 256, TIMA counts up from 0.
+    timer.WriteByte(kRegTac, kTac16, 0);
+    EXPECT_EQ(timer.GetNextOverflow(), 0x100 * 16);
+    timer.WriteByte(kRegTac, kTacEnabled | 0b11, 0);
+    EXPECT_EQ(timer.GetNextOverflow(), 0x100 * 256);
+}
+
+TEST_F(TimerTest, TacUnusedBitsReadSet)
+{
+    EXPECT_EQ(timer.ReadByte(kRegTac, 0), 0xf8);
+    timer.WriteByte(kRegTac, kTac16, 0);
+    EXPECT_EQ(timer.ReadByte(kRegTac, 0), 0xfd);
+    timer.WriteByte(kRegTac, 0, 0);
+    EXPECT_EQ(timer.ReadByte(kRegTac, 0), 0xf8);
+}
@@ -0,0 +1,32 @@
+#include <fmt/format.h>
+
+#include <fstream>
+#include <span>
+
+#include "core/util.hpp"
+#include "recompiler.hpp"
+
+int main(int argc, char* argv[])
+{
+    const auto args{std::span(argv, static_cast<size_t>(argc))};
+    if (args.size() != 3)
+    {
+        fmt::println(stderr, "Usage: {} <rom> <output.cpp>", args[0]);
+        return EXIT_FAILURE;
+    }
+
+    gb::recompile::Recompiler recompiler{gb::fs::ReadFile(args[1])};
+    recompiler.Walk();
+
+    std::ofstream out{args[2], std::ios::out | std::ios::trunc};
+    if (!out)
+    {
+        fmt::println(stderr, "Could not open {} for writing", args[2]);
+        return EXIT_FAILURE;
+    }
+    out << recompiler.Emit();
+
+    fmt::println("{}: {} blocks, {} instructions", recompiler.GetTitle(),
+                 recompiler.GetBlockCount(), recompiler.GetInstructionCount());
+    return EXIT_SUCCESS;
+}
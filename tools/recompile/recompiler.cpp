@@ -0,0 +1,271 @@
+#include "recompiler.hpp"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <array>
+#include <iterator>
+#include <set>
+#include <tuple>
+
+#include "core/sm83/precompiled.hpp"
+
+namespace gb::recompile
+{
+namespace
+{
+constexpr uint16_t kRomBankSize = 0x4000;
+constexpr uint16_t kEntryPoint = 0x100;
+constexpr uint16_t kLastVector = 0x60;
+constexpr uint16_t kTitleStart = 0x134;
+constexpr uint16_t kTitleEnd = 0x143;
+
+// Instructions that leave A untouched, so a constant loaded into A survives them on the way to a
+// bank switch, e.g. "ld a, BANK(x); ldh [hCurBank], a; ld [$2000], a".
+constexpr auto kPreservesA = std::to_array<uint8_t>({
+    0x00, 0x02, 0x12, 0x22, 0x32, 0x47, 0x4f, 0x57, 0x5f, 0x67, 0x6f, 0x77, 0xe0, 0xe2, 0xea, 0xf5,
+});
+
+std::string FormatBlockName(const Location& location)
+{
+    return fmt::format("Block_{:02x}_{:04x}", location.bank, location.pc);
+}
+}  // namespace
+
+Recompiler::Recompiler(std::vector<uint8_t> rom)
+    : rom_(std::move(rom)),
+      nr_banks_(std::max<size_t>(rom_.size() / kRomBankSize, 2)),
+      has_mbc_(rom_.at(0x147) != 0x00)
+{
+    rom_.resize(nr_banks_ * kRomBankSize);
+}
+
+uint8_t Recompiler::ReadByte(uint16_t bank, uint16_t addr) const
+{
+    const size_t mapped_bank = addr < kRomBankSize ? 0 : bank;
+    return rom_[(mapped_bank * kRomBankSize) + (addr % kRomBankSize)];
+}
+
+std::optional<Location> Recompiler::Resolve(uint16_t addr,
+                                            std::optional<uint16_t> switchable_bank) const
+{
+    if (addr < kRomBankSize) { return Location{.bank = 0, .pc = addr}; }
+    if (addr < 2 * kRomBankSize && switchable_bank)
+    {
+        return Location{.bank = *switchable_bank, .pc = addr};
+    }
+    // RAM or an unknown bank, interpreted at runtime.
+    return std::nullopt;
+}
+
+uint16_t Recompiler::SelectBank(uint8_t val) const
+{
+    // Bank 0 can not be mapped at 0x4000-0x7fff on MBC1-3, selecting it maps bank 1 instead.
+    const auto bank = static_cast<uint16_t>(val % nr_banks_);
+    return bank == 0 ? 1 : bank;
+}
+
+void Recompiler::Walk()
+{
+    std::vector<PendingBlock> worklist;
+    worklist.push_back({.location = {.bank = 0, .pc = kEntryPoint}, .switchable_bank = 1});
+    for (uint16_t vector = 0; vector <= kLastVector; vector += 8)
+    {
+        worklist.push_back({.location = {.bank = 0, .pc = vector}, .switchable_bank = 1});
+    }
+
+    std::set<std::tuple<Location, std::optional<uint16_t>>> visited;
+    while (!worklist.empty())
+    {
+        const PendingBlock pending = worklist.back();
+        worklist.pop_back();
+        if (!visited.emplace(pending.location, pending.switchable_bank).second) { continue; }
+
+        const Location location = pending.location;
+        auto it = blocks_.find(location);
+        if (it == blocks_.end())
+        {
+            const uint32_t region_end =
+                location.pc < kRomBankSize ? kRomBankSize : 2 * kRomBankSize;
+            auto instrs = sm83::DecodeBasicBlock(
+                [&](uint16_t addr) { return ReadByte(location.bank, addr); }, location.pc,
+                region_end);
+            it = blocks_.emplace(location, std::move(instrs)).first;
+        }
+        const auto& instrs = it->second;
+        if (instrs.empty()) { continue; }
+
+        // Follow constant bank switches through the block.
+        std::optional<uint16_t> switchable_bank = pending.switchable_bank;
+        std::optional<uint8_t> a;
+        for (const sm83::DecodedInstruction& instr : instrs)
+        {
+            const auto nn = static_cast<uint16_t>(instr.operands[0] | (instr.operands[1] << 8));
+            if (instr.opcode == 0x3e) { a = instr.operands[0]; }
+            else if (instr.opcode == 0xaf) { a = 0; }
+            else if (instr.opcode == 0xea && has_mbc_ && nn >= 0x2000 && nn <= 0x3fff && a)
+            {
+                switchable_bank = SelectBank(*a);
+            }
+            else if (!std::ranges::contains(kPreservesA, instr.opcode)) { a.reset(); }
+        }
+
+        const auto push = [&](uint16_t addr)
+        {
+            if (const auto target = Resolve(addr, switchable_bank))
+            {
+                worklist.push_back({.location = *target, .switchable_bank = switchable_bank});
+            }
+        };
+
+        const sm83::DecodedInstruction& last = instrs.back();
+        const auto next = static_cast<uint16_t>(last.pc + last.length);
+        const auto nn = static_cast<uint16_t>(last.operands[0] | (last.operands[1] << 8));
+        const auto jr_target = static_cast<uint16_t>(next + static_cast<int8_t>(last.operands[0]));
+
+        switch (last.opcode)
+        {
+        case 0x18: push(jr_target); break;
+        case 0x20:
+        case 0x28:
+        case 0x30:
+        case 0x38:
+            push(jr_target);
+            push(next);
+            break;
+        case 0xc3: push(nn); break;
+        case 0xc2:
+        case 0xca:
+        case 0xd2:
+        case 0xda:
+        case 0xcd:
+        case 0xc4:
+        case 0xcc:
+        case 0xd4:
+        case 0xdc:
+            push(nn);
+            push(next);
+            break;
+        case 0xc7:
+        case 0xcf:
+        case 0xd7:
+        case 0xdf:
+        case 0xe7:
+        case 0xef:
+        case 0xf7:
+        case 0xff:
+            push(last.opcode & 0x38);
+            push(next);
+            break;
+        // Returns and JP HL can not be resolved statically.
+        case 0xc9:
+        case 0xd9:
+        case 0xe9: break;
+        default:
+            // Conditional returns, HALT, STOP, or a block cut at its maximum length.
+            push(next);
+            break;
+        }
+    }
+}
+
+size_t Recompiler::GetInstructionCount() const
+{
+    size_t count = 0;
+    for (const auto& [location, instrs] : blocks_) { count += instrs.size(); }
+    return count;
+}
+
+std::string Recompiler::GetTitle() const
+{
+    std::string title;
+    for (uint16_t addr = kTitleStart; addr <= kTitleEnd; ++addr)
+    {
+        const auto c = static_cast<char>(rom_[addr]);
+        if (c == '\0') { break; }
+        if (c >= ' ' && c <= '~' && c != '"' && c != '\\') { title += c; }
+    }
+    return title;
+}
+
+std::string Recompiler::Emit() const
+{
+    const std::string title = GetTitle();
+    std::string out;
+    auto emit = std::back_inserter(out);
+
+    fmt::format_to(emit,
+                   "// Generated by gbcxx_recompile from \"{}\", do not edit.\n"
+                   "#include <array>\n\n"
+                   "#include \"core/sm83/cpu_execute.hpp\"\n"
+                   "#include \"core/sm83/precompiled.hpp\"\n\n"
+                   "namespace\n{{\n"
+                   "using gb::sm83::Cpu;\n\n",
+                   title);
+
+    std::map<Location, std::pair<Location, uint8_t>> entries;
+    for (const auto& [location, instrs] : blocks_)
+    {
+        if (instrs.empty()) { continue; }
+
+        fmt::format_to(emit, "void {}(Cpu& cpu, uint8_t index)\n{{\n    switch (index)\n    {{\n",
+                       FormatBlockName(location));
+        for (size_t i = 0; i < instrs.size(); ++i)
+        {
+            const sm83::DecodedInstruction& instr = instrs[i];
+            const auto operands =
+                static_cast<uint16_t>(instr.operands[0] | (instr.operands[1] << 8));
+            fmt::format_to(emit, "    case {}:\n", i);
+            if (i + 1 < instrs.size())
+            {
+                fmt::format_to(emit,
+                               "        if (cpu.StepCompiled<0x{:02x}>(0x{:04x})) {{ return; }}\n"
+                               "        [[fallthrough]];\n",
+                               instr.opcode, operands);
+            }
+            else
+            {
+                fmt::format_to(emit,
+                               "        cpu.StepCompiled<0x{:02x}>(0x{:04x});\n"
+                               "        break;\n",
+                               instr.opcode, operands);
+            }
+        }
+        fmt::format_to(emit, "    default: break;\n    }}\n}}\n\n");
+
+        // Block starts take precedence over instructions in the middle of other blocks.
+        entries.insert_or_assign(location, std::pair{location, uint8_t{0}});
+        for (size_t i = 1; i < instrs.size(); ++i)
+        {
+            const Location instr_location{.bank = location.bank, .pc = instrs[i].pc};
+            if (!blocks_.contains(instr_location))
+            {
+                entries.try_emplace(instr_location, location, static_cast<uint8_t>(i));
+            }
+        }
+    }
+
+    fmt::format_to(emit, "constexpr std::array<gb::sm83::PrecompiledEntry, {}> kEntries = {{{{\n",
+                   entries.size());
+    for (const auto& [entry, target] : entries)
+    {
+        fmt::format_to(emit, "    {{0x{:02x}, 0x{:04x}, {}, &{}}},\n", entry.bank, entry.pc,
+                       target.second, FormatBlockName(target.first));
+    }
+    fmt::format_to(emit, "}}}};\n\n");
+
+    fmt::format_to(emit,
+                   "[[maybe_unused]] const bool kRegistered = gb::sm83::RegisterPrecompiledRom({{\n"
+                   "    .title = \"{}\",\n"
+                   "    .header_checksum = 0x{:02x},\n"
+                   "    .global_checksum = 0x{:04x},\n"
+                   "    .entries = kEntries,\n"
+                   "}});\n"
+                   "}}  // namespace\n",
+                   title, rom_[sm83::kHeaderChecksumAddress],
+                   (rom_[sm83::kGlobalChecksumAddress] << 8) |
+                       rom_[sm83::kGlobalChecksumAddress + 1]);
+
+    return out;
+}
+}  // namespace gb::recompile
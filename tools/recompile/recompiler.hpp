@@ -0,0 +1,63 @@
+#pragma once
+
+#include <compare>
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "core/sm83/decode_cache.hpp"
+
+namespace gb::recompile
+{
+struct Location
+{
+    uint16_t bank;
+    uint16_t pc;
+
+    auto operator<=>(const Location&) const = default;
+};
+
+// Statically walks the code reachable from the cartridge entry point and the restart and interrupt
+// vectors, then emits a C++ translation unit with one function per basic block. Blocks are keyed
+// by the bank they were decoded from, so a wrong guess about the mapped bank only produces code
+// that is never looked up. Anything the walk cannot resolve (JP HL, RET, unknown banks) is left
+// to the interpreter at runtime.
+class Recompiler
+{
+public:
+    explicit Recompiler(std::vector<uint8_t> rom);
+
+    void Walk();
+    [[nodiscard]] std::string Emit() const;
+
+    [[nodiscard]] size_t GetBlockCount() const { return blocks_.size(); }
+    // The block decoded at location by Walk(), nullptr if it wasn't reached.
+    [[nodiscard]] const std::vector<sm83::DecodedInstruction>* FindBlock(Location location) const
+    {
+        const auto it = blocks_.find(location);
+        return it != blocks_.end() ? &it->second : nullptr;
+    }
+    [[nodiscard]] size_t GetInstructionCount() const;
+    [[nodiscard]] std::string GetTitle() const;
+
+private:
+    struct PendingBlock
+    {
+        Location location;
+        // Bank mapped at 0x4000-0x7fff when the block is entered, if known.
+        std::optional<uint16_t> switchable_bank;
+    };
+
+    [[nodiscard]] uint8_t ReadByte(uint16_t bank, uint16_t addr) const;
+    [[nodiscard]] std::optional<Location> Resolve(uint16_t addr,
+                                                  std::optional<uint16_t> switchable_bank) const;
+    [[nodiscard]] uint16_t SelectBank(uint8_t val) const;
+
+    std::vector<uint8_t> rom_;
+    size_t nr_banks_;
+    bool has_mbc_;
+    std::map<Location, std::vector<sm83::DecodedInstruction>> blocks_;
+};
+}  // namespace gb::recompile
@@ -0,0 +1,67 @@
+#include <fmt/format.h>
+
+#include <fstream>
+#include <span>
+
+#include "core/sm83/tracer.hpp"
+
+// Converts a trace dumped by RingTracer to the text format written by DoctorTracer.
+int main(int argc, char* argv[])
+{
+    const auto args{std::span(argv, static_cast<size_t>(argc))};
+    if (args.size() != 2 && args.size() != 3)
+    {
+        fmt::println(stderr, "Usage: {} <trace.bin> [<output.log>]", args[0]);
+        return EXIT_FAILURE;
+    }
+
+    std::ifstream in{args[1], std::ios::binary};
+    if (!in)
+    {
+        fmt::println(stderr, "Could not open {}", args[1]);
+        return EXIT_FAILURE;
+    }
+
+    gb::sm83::TraceHeader header{};
+    in.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!in || header.magic != gb::sm83::TraceHeader::kMagic)
+    {
+        fmt::println(stderr, "{} is not a gbcxx trace", args[1]);
+        return EXIT_FAILURE;
+    }
+    if (header.version != gb::sm83::TraceHeader::kVersion ||
+        header.record_size != sizeof(gb::sm83::TraceRecord))
+    {
+        fmt::println(stderr, "Unsupported trace version {} with {}-byte records", header.version,
+                     header.record_size);
+        return EXIT_FAILURE;
+    }
+
+    std::ofstream out;
+    if (args.size() == 3)
+    {
+        out.open(args[2], std::ios::out | std::ios::trunc);
+        if (!out)
+        {
+            fmt::println(stderr, "Could not open {} for writing", args[2]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    uint64_t count = 0;
+    gb::sm83::TraceRecord record{};
+    while (count < header.count && in.read(reinterpret_cast<char*>(&record), sizeof(record)))
+    {
+        const std::string line = gb::sm83::FormatDoctorLine(record);
+        if (out.is_open()) { out << line << '\n'; }
+        else { fmt::println("{}", line); }
+        ++count;
+    }
+
+    if (count != header.count)
+    {
+        fmt::println(stderr, "Trace is truncated, read {} of {} records", count, header.count);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}